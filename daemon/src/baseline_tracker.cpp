@@ -1,34 +1,115 @@
 #include "baseline_tracker.hpp"
 
+#include <cmath>
+
 namespace kpulse {
 
-static constexpr int WindowSeconds = 300;
+namespace {
+
+// Weight of the newest bucket; ~30 minutes of memory at 1-minute buckets.
+constexpr double kAlpha = 0.065;
+
+// Closing more empty buckets than this changes nothing measurable
+// ((1 - kAlpha)^360 < 1e-10), so long gaps cost bounded time.
+constexpr qint64 kMaxCatchUpBuckets = 360;
+
+// Added to the variance so one-off events do not divide by zero and a
+// perfectly regular label still tolerates a little jitter.
+constexpr double kVarianceFloor = 1.0;
+
+} // namespace
+
+BaselineTracker::BaselineTracker(int capacity)
+    : capacity_(qMax(1, capacity))
+{
+    entries_.reserve(capacity_);
+}
 
-void BaselineTracker::observe(const Event &event)
+void BaselineTracker::advance(Entry &e, qint64 index)
 {
-    auto &bucket = buckets_[event.category];
+    if (index <= e.bucketIndex) {
+        return;
+    }
 
-    if (!bucket.windowStart.isValid() || bucket.windowStart.secsTo(event.timestamp) > WindowSeconds) {
-        bucket.windowStart = event.timestamp;
-        bucket.count = 0;
+    // Close the current bucket, then any empty ones after it.
+    const qint64 closing = qMin(index - e.bucketIndex, kMaxCatchUpBuckets);
+    double x = e.count;
+    for (qint64 i = 0; i < closing; ++i) {
+        const double diff = x - e.mean;
+        const double incr = kAlpha * diff;
+        e.mean += incr;
+        e.variance = (1.0 - kAlpha) * (e.variance + diff * incr);
+        x = 0.0;
     }
 
-    bucket.count++;
+    e.bucketIndex = index;
+    e.count = 0;
 }
 
-double BaselineTracker::score(const Event &event) const
+BaselineTracker::Entry &BaselineTracker::entryFor(const Key &key, qint64 index)
 {
-    auto it = buckets_.find(event.category);
-    if (it == buckets_.end()) {
-        return 0.0;
+    auto it = entries_.find(key);
+    if (it != entries_.end()) {
+        lru_.splice(lru_.begin(), lru_, it->lru);
+        return it.value();
     }
 
-    const Bucket &bucket = it->second;
-    if (bucket.count == 0) {
-        return 0.0;
+    if (entries_.size() >= capacity_ && !lru_.empty()) {
+        entries_.remove(lru_.back());
+        lru_.pop_back();
+    }
+
+    lru_.push_front(key);
+    Entry e;
+    e.bucketIndex = index;
+    e.lru = lru_.begin();
+    return entries_.insert(key, e).value();
+}
+
+double BaselineTracker::observe(const Event &ev)
+{
+    const qint64 index = ev.timestamp.toMSecsSinceEpoch() / kBucketMs;
+
+    Entry &e = entryFor(Key{ev.category, ev.label}, index);
+
+    // Late events (clock steps, mixed sources) count towards the current
+    // bucket rather than rewinding it.
+    advance(e, index);
+    ++e.count;
+
+    return (e.count - e.mean) / std::sqrt(e.variance + kVarianceFloor);
+}
+
+std::vector<BaselineState> BaselineTracker::state() const
+{
+    std::vector<BaselineState> out;
+    out.reserve(entries_.size());
+    for (auto it = entries_.cbegin(); it != entries_.cend(); ++it) {
+        BaselineState s;
+        s.category = it.key().category;
+        s.label = it.key().label;
+        s.bucketMs = it->bucketIndex * kBucketMs;
+        s.count = it->count;
+        s.mean = it->mean;
+        s.variance = it->variance;
+        out.push_back(std::move(s));
     }
+    return out;
+}
 
-    return static_cast<double>(bucket.count);
+void BaselineTracker::restore(const std::vector<BaselineState> &states)
+{
+    entries_.clear();
+    lru_.clear();
+
+    for (const BaselineState &s : states) {
+        const qint64 index = s.bucketMs / kBucketMs;
+        Entry &e = entryFor(Key{s.category, s.label}, index);
+        e.bucketIndex = index;
+        e.count = s.count;
+        e.mean = s.mean;
+        e.variance = s.variance;
+    }
 }
 
 } // namespace kpulse
@@ -1,25 +1,73 @@
 #pragma once
 
-#include <QDateTime>
-#include <map>
+#include <QHash>
+#include <QString>
 
+#include <list>
+#include <vector>
+
+#include "kpulse/db.hpp"
 #include "kpulse/event.hpp"
 
 namespace kpulse {
 
+// Streaming "is this unusual?" detector. For every (category, label) it
+// keeps an exponentially weighted mean and variance of the number of
+// events per kBucketMs, updated as buckets close. observe() returns how
+// many standard deviations the current bucket's count lies above that
+// mean, so a label that usually fires twice a minute scores low at two
+// and high at fifty, while a label never seen before scores its count.
+//
+// Memory is constant: at most capacity() labels are tracked and the least
+// recently seen one is forgotten first. state()/restore() let the writer
+// persist the baselines so they survive a restart.
 class BaselineTracker
 {
 public:
-    void observe(const Event &event);
-    double score(const Event &event) const;
+    static constexpr qint64 kBucketMs = 60 * 1000;
+
+    explicit BaselineTracker(int capacity = 2048);
+
+    // Count ev and return its score.
+    double observe(const Event &ev);
+
+    int size() const { return static_cast<int>(entries_.size()); }
+
+    std::vector<BaselineState> state() const;
+    void restore(const std::vector<BaselineState> &states);
 
 private:
-    struct Bucket {
+    struct Key
+    {
+        Category category;
+        QString label;
+
+        bool operator==(const Key &other) const
+        {
+            return category == other.category && label == other.label;
+        }
+    };
+    friend size_t qHash(const Key &key, size_t seed)
+    {
+        return qHashMulti(seed, static_cast<int>(key.category), key.label);
+    }
+
+    struct Entry
+    {
+        qint64 bucketIndex = 0;  // bucket `count` belongs to
         int count = 0;
-        QDateTime windowStart;
+        double mean = 0.0;
+        double variance = 0.0;
+        std::list<Key>::iterator lru;
     };
 
-    std::map<Category, Bucket> buckets_;
+    // Fold the buckets before `index` into the mean/variance.
+    static void advance(Entry &e, qint64 index);
+    Entry &entryFor(const Key &key, qint64 index);
+
+    int capacity_;
+    QHash<Key, Entry> entries_;
+    std::list<Key> lru_;   // most recently seen first
 };
 
 } // namespace kpulse
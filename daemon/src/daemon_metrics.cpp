@@ -0,0 +1,30 @@
+#include "daemon_metrics.hpp"
+
+#include <QMutexLocker>
+
+namespace kpulse {
+
+void DaemonMetrics::set(const QString &name, double value)
+{
+    QMutexLocker lock(&mutex_);
+    values_.insert(name, value);
+}
+
+void DaemonMetrics::add(const QString &name, double delta)
+{
+    QMutexLocker lock(&mutex_);
+    values_[name] += delta;
+}
+
+QJsonObject DaemonMetrics::snapshot() const
+{
+    QMutexLocker lock(&mutex_);
+
+    QJsonObject obj;
+    for (auto it = values_.cbegin(); it != values_.cend(); ++it) {
+        obj.insert(it.key(), it.value());
+    }
+    return obj;
+}
+
+} // namespace kpulse
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QMap>
+#include <QMutex>
+#include <QString>
+
+namespace kpulse {
+
+// Named counters/gauges describing the daemon itself (ingest lag, queue
+// depths, ...). Exposed over DBus through GetMetrics. Components publish
+// aggregated values once per batch, not per journal entry.
+class DaemonMetrics
+{
+public:
+    void set(const QString &name, double value);
+    void add(const QString &name, double delta = 1.0);
+
+    QJsonObject snapshot() const;
+
+private:
+    mutable QMutex mutex_;
+    QMap<QString, double> values_;
+};
+
+} // namespace kpulse
@@ -0,0 +1,177 @@
+#include "event_broadcaster.hpp"
+
+#include "daemon_metrics.hpp"
+
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDebug>
+
+namespace kpulse {
+
+namespace {
+constexpr const char *kObjectPath = "/org/kde/kpulse/Daemon";
+constexpr const char *kInterface  = "org.kde.kpulse.Daemon";
+constexpr const char *kSubscribedSignal = "SubscribedEventsAdded";
+constexpr const char *kSubscribedUpdateSignal = "SubscribedEventsUpdated";
+} // namespace
+
+EventBroadcaster::EventBroadcaster(QObject *parent)
+    : QObject(parent)
+{
+    windowTimer_.setParent(this);
+    windowTimer_.setSingleShot(true);
+    windowTimer_.setInterval(windowMs_);
+    connect(&windowTimer_, &QTimer::timeout, this, &EventBroadcaster::flush);
+
+    watcher_.setParent(this);
+    watcher_.setConnection(QDBusConnection::sessionBus());
+    watcher_.setWatchMode(QDBusServiceWatcher::WatchForUnregistration);
+    connect(&watcher_, &QDBusServiceWatcher::serviceUnregistered,
+            this, &EventBroadcaster::unsubscribe);
+}
+
+void EventBroadcaster::setWindow(int windowMs, int maxEvents)
+{
+    windowMs_ = qMax(0, windowMs);
+    maxEvents_ = qMax(1, maxEvents);
+    windowTimer_.setInterval(windowMs_);
+}
+
+void EventBroadcaster::subscribe(const QString &busName,
+                                 Severity minSeverity,
+                                 quint32 categoryMask)
+{
+    if (busName.isEmpty()) {
+        return;
+    }
+
+    if (!subscribers_.contains(busName)) {
+        watcher_.addWatchedService(busName);
+    }
+    subscribers_.insert(busName, Subscription{minSeverity, categoryMask});
+
+    if (metrics_) {
+        metrics_->set(QStringLiteral("broadcast.subscribers"), subscribers_.size());
+    }
+}
+
+void EventBroadcaster::unsubscribe(const QString &busName)
+{
+    if (subscribers_.remove(busName) == 0) {
+        return;
+    }
+    watcher_.removeWatchedService(busName);
+
+    if (metrics_) {
+        metrics_->set(QStringLiteral("broadcast.subscribers"), subscribers_.size());
+    }
+}
+
+void EventBroadcaster::publish(const EventList &events)
+{
+    if (events.isEmpty()) {
+        return;
+    }
+
+    pending_.append(events);
+    queued();
+}
+
+void EventBroadcaster::publishUpdates(const EventList &events)
+{
+    if (events.isEmpty()) {
+        return;
+    }
+
+    for (const Event &ev : events) {
+        const auto it = pendingUpdateIndex_.constFind(ev.id);
+        if (it != pendingUpdateIndex_.constEnd()) {
+            pendingUpdates_[it.value()] = ev;
+        } else {
+            pendingUpdateIndex_.insert(ev.id, pendingUpdates_.size());
+            pendingUpdates_.push_back(ev);
+        }
+    }
+    queued();
+}
+
+void EventBroadcaster::queued()
+{
+    // The window starts with the first queued event and is not extended by
+    // later ones, so delivery latency stays bounded during a storm.
+    if (pending_.size() + pendingUpdates_.size() >= maxEvents_) {
+        flush();
+    } else if (!windowTimer_.isActive()) {
+        windowTimer_.start();
+    }
+}
+
+void EventBroadcaster::flush()
+{
+    windowTimer_.stop();
+    if (pending_.isEmpty() && pendingUpdates_.isEmpty()) {
+        return;
+    }
+
+    EventList batch;
+    batch.swap(pending_);
+    EventList updates;
+    updates.swap(pendingUpdates_);
+    pendingUpdateIndex_.clear();
+
+    if (!batch.isEmpty()) {
+        emit batchReady(batch);
+    }
+    if (!updates.isEmpty()) {
+        emit updatesReady(updates);
+    }
+
+    int targeted = 0;
+    for (auto it = subscribers_.cbegin(); it != subscribers_.cend(); ++it) {
+        targeted += sendTargeted(it.key(), it.value(), kSubscribedSignal, batch);
+        targeted += sendTargeted(it.key(), it.value(), kSubscribedUpdateSignal, updates);
+    }
+
+    if (metrics_) {
+        metrics_->add(QStringLiteral("broadcast.batches"));
+        metrics_->add(QStringLiteral("broadcast.events"), batch.size());
+        metrics_->add(QStringLiteral("broadcast.updates"), updates.size());
+        metrics_->add(QStringLiteral("broadcast.targeted_signals"), targeted);
+    }
+}
+
+bool EventBroadcaster::sendTargeted(const QString &busName,
+                                    const Subscription &sub,
+                                    const char *signal,
+                                    const EventList &events)
+{
+    EventList filtered;
+    for (const Event &ev : events) {
+        if (accepts(sub, ev)) {
+            filtered.push_back(ev);
+        }
+    }
+    if (filtered.isEmpty()) {
+        return false;
+    }
+
+    QDBusMessage msg = QDBusMessage::createTargetedSignal(
+        busName,
+        QString::fromUtf8(kObjectPath),
+        QString::fromUtf8(kInterface),
+        QString::fromUtf8(signal));
+    msg << QVariant::fromValue(filtered);
+    if (!QDBusConnection::sessionBus().send(msg)) {
+        qWarning() << "EventBroadcaster: failed to signal subscriber" << busName;
+        return false;
+    }
+    return true;
+}
+
+bool EventBroadcaster::accepts(const Subscription &sub, const Event &ev) const
+{
+    return static_cast<int>(ev.severity) >= static_cast<int>(sub.minSeverity)
+        && (sub.categoryMask & categoryBit(ev.category)) != 0;
+}
+
+} // namespace kpulse
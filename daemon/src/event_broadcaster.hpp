@@ -0,0 +1,87 @@
+#pragma once
+
+#include <QDBusServiceWatcher>
+#include <QHash>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+#include "kpulse/dbus_types.hpp"
+#include "kpulse/event.hpp"
+
+namespace kpulse {
+
+class DaemonMetrics;
+
+// Coalesces stored events into batched DBus signals. Events handed to
+// publish() are held for at most window() milliseconds (or until
+// maxEvents() are queued) and then sent as one signal:
+//
+//  - batchReady() carries every event; KPulseDaemon relays it as the
+//    broadcast "EventsAdded" signal.
+//  - every subscriber (see subscribe()) gets a "SubscribedEventsAdded"
+//    signal addressed only to its bus name, containing just the events
+//    that pass its filter. Subscribers with nothing to receive are not
+//    woken at all.
+//
+// Repeat-count updates handed to publishUpdates() travel the same way as
+// updatesReady() / "SubscribedEventsUpdated"; several updates of one event
+// within a window are sent once, with its latest state.
+class EventBroadcaster : public QObject
+{
+    Q_OBJECT
+public:
+    explicit EventBroadcaster(QObject *parent = nullptr);
+
+    void setWindow(int windowMs, int maxEvents);
+    int window() const { return windowMs_; }
+    int maxEvents() const { return maxEvents_; }
+
+    void setMetrics(DaemonMetrics *metrics) { metrics_ = metrics; }
+
+    // Subscribe `busName` to events of at least `minSeverity` whose category
+    // bit (1 << Category) is set in `categoryMask`. Re-subscribing replaces
+    // the previous filter. Subscriptions end when the name leaves the bus.
+    void subscribe(const QString &busName, Severity minSeverity, quint32 categoryMask);
+    void unsubscribe(const QString &busName);
+
+    void publish(const EventList &events);
+    void publishUpdates(const EventList &events);
+
+    // Send whatever is queued right away.
+    void flush();
+
+    static quint32 categoryBit(Category c) { return 1u << static_cast<int>(c); }
+
+signals:
+    void batchReady(const kpulse::EventList &events);
+    void updatesReady(const kpulse::EventList &events);
+
+private:
+    struct Subscription
+    {
+        Severity minSeverity = Severity::Info;
+        quint32  categoryMask = ~0u;
+    };
+
+    bool accepts(const Subscription &sub, const Event &ev) const;
+    void queued();
+
+    // Send the part of `events` that `busName` subscribed to as `signal`.
+    bool sendTargeted(const QString &busName, const Subscription &sub,
+                      const char *signal, const EventList &events);
+
+    EventList pending_;
+    EventList pendingUpdates_;
+    QHash<qint64, qsizetype> pendingUpdateIndex_;
+    QTimer    windowTimer_;
+    int       windowMs_ = 200;
+    int       maxEvents_ = 1000;
+
+    QHash<QString, Subscription> subscribers_;
+    QDBusServiceWatcher watcher_;
+
+    DaemonMetrics *metrics_ = nullptr;
+};
+
+} // namespace kpulse
@@ -0,0 +1,162 @@
+#include "event_classifier.hpp"
+
+#include <QJsonObject>
+#include <QTimeZone>
+
+#include "kpulse/common.hpp"
+
+#include "daemon_metrics.hpp"
+
+namespace kpulse {
+
+EventClassifier::EventClassifier(BoundedQueue<JournalBatch> *input,
+                                 BoundedQueue<EventBatch> *output,
+                                 QObject *parent)
+    : QObject(parent)
+    , input_(input)
+    , output_(output)
+{
+}
+
+void EventClassifier::drain()
+{
+    std::vector<JournalBatch> batches = input_->pop();
+    if (batches.empty()) {
+        return;
+    }
+
+    for (JournalBatch &in : batches) {
+        EventBatch out;
+        out.cursor = std::move(in.cursor);
+        for (const JournalEntry &entry : in.entries) {
+            Event ev;
+            if (classifyEntry(entry, ev)) {
+                out.events.push_back(std::move(ev));
+            }
+        }
+
+        // Batches without events still carry the cursor forward.
+        if (!output_->push(std::move(out))) {
+            break;
+        }
+    }
+
+    publishBatchStats();
+}
+
+void EventClassifier::publishBatchStats()
+{
+    if (!metrics_) {
+        return;
+    }
+
+    metrics_->set(QStringLiteral("journal.ingest_lag_ms"), double(batchLagMs_));
+    metrics_->set(QStringLiteral("journal.ingest_lag_max_ms"), double(batchMaxLagMs_));
+    batchMaxLagMs_ = 0;
+}
+
+Severity EventClassifier::severityFromPriority(int prio)
+{
+    // systemd priorities: 0..7 (emerg..debug)
+    if (prio <= 2) {
+        return Severity::Critical;
+    }
+    if (prio <= 3) {
+        return Severity::Error;
+    }
+    if (prio <= 4) {
+        return Severity::Warning;
+    }
+    return Severity::Info;
+}
+
+qint64 EventClassifier::entryTimestampMs(const JournalEntry &entry)
+{
+    if (entry.realtimeUs == 0) {
+        return 0;
+    }
+
+    quint64 realtimeUs = entry.realtimeUs;
+
+    // A wall clock stepped backwards (NTP, manual change) while the
+    // monotonic clock moved forward: keep the journal's order instead of
+    // the clock's. Monotonic time restarts with every boot, so this only
+    // applies between entries of the same boot; a backlog replay crosses
+    // boots all the time.
+    const bool sameBoot = !entry.bootId.isEmpty() && entry.bootId == lastBootId_;
+    if (sameBoot && realtimeUs < lastRealtimeUs_ && entry.monotonicUs >= lastMonotonicUs_ &&
+        lastMonotonicUs_ != 0) {
+        realtimeUs = lastRealtimeUs_ + (entry.monotonicUs - lastMonotonicUs_);
+    }
+
+    lastRealtimeUs_ = realtimeUs;
+    lastMonotonicUs_ = entry.monotonicUs;
+    lastBootId_ = entry.bootId;
+
+    const qint64 ms = static_cast<qint64>(realtimeUs / 1000);
+
+    // Ingest lag: how far behind the journal writer we are reading.
+    const qint64 lagMs = QDateTime::currentMSecsSinceEpoch() - ms;
+    batchLagMs_ = lagMs;
+    batchMaxLagMs_ = qMax(batchMaxLagMs_, lagMs);
+
+    return ms;
+}
+
+bool EventClassifier::classifyEntry(const JournalEntry &entry, Event &ev)
+{
+    const QString &message = entry.message;
+    const QString &unit = entry.unit;
+    const QString &ident = entry.identifier;
+    const int prio = entry.priority;
+    const qint64 timestampMs = entryTimestampMs(entry);
+
+    Category cat = Category::System;
+    Severity sev = severityFromPriority(prio);
+    QString label;
+
+    RuleMatch rule;
+    if (rules_.match(entry, rule)) {
+        if (rule.drop) {
+            return false; // known noise, ignore completely
+        }
+        cat = rule.category;
+        if (rule.severity) {
+            sev = *rule.severity;
+        }
+        label = rule.label;
+    } else {
+        // Fallback: generic mapping, but with gating:
+        // we DROP generic system/info noise.
+        cat = Category::System;
+        label = message.left(120);
+
+        if (sev == Severity::Info && cat == Category::System) {
+            // too chatty, skip this event entirely
+            return false;
+        }
+    }
+
+    // Journal time, not read time: during backlog replay or under pipe
+    // backpressure the two can be minutes apart.
+    ev.timestamp = timestampMs > 0
+        ? QDateTime::fromMSecsSinceEpoch(timestampMs, QTimeZone::utc())
+        : nowUtc();
+    ev.category = cat;
+    ev.severity = sev;
+    ev.label = label;
+
+    QJsonObject details;
+    if (!message.isEmpty())
+        details.insert(QStringLiteral("message"), message);
+    if (!unit.isEmpty())
+        details.insert(QStringLiteral("unit"), unit);
+    if (!ident.isEmpty())
+        details.insert(QStringLiteral("identifier"), ident);
+    details.insert(QStringLiteral("priority"), prio);
+
+    ev.details = details;
+    return true;
+}
+
+} // namespace kpulse
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <QObject>
+#include <QString>
+
+#include "kpulse/event.hpp"
+
+#include "pipeline.hpp"
+#include "rule_engine.hpp"
+
+namespace kpulse {
+
+class DaemonMetrics;
+
+// Pipeline stage between JournaldReader and EventWriter: turns journal
+// entries into KPulse events (or drops them as noise). Lives on its own
+// thread; drain() is invoked whenever the input queue fills up again.
+class EventClassifier : public QObject
+{
+    Q_OBJECT
+public:
+    EventClassifier(BoundedQueue<JournalBatch> *input,
+                    BoundedQueue<EventBatch> *output,
+                    QObject *parent = nullptr);
+
+    // Where ingest lag is published. Optional.
+    void setMetrics(DaemonMetrics *metrics) { metrics_ = metrics; }
+
+    // Rules used by classifyEntry(). Set before the stage starts running.
+    void setRules(const RuleSet &rules) { rules_ = rules; }
+
+    // Classify everything queued. Blocks while the output queue is full.
+    void drain();
+
+private:
+    bool classifyEntry(const JournalEntry &entry, Event &out);
+
+    // Journal time of an entry in ms since epoch, kept monotonic within a
+    // boot so wall-clock steps cannot reorder events.
+    qint64 entryTimestampMs(const JournalEntry &entry);
+    void publishBatchStats();
+
+    static Severity severityFromPriority(int prio);
+
+    BoundedQueue<JournalBatch> *input_;
+    BoundedQueue<EventBatch> *output_;
+    RuleSet rules_ = RuleSet::defaults();
+
+    DaemonMetrics *metrics_ = nullptr;
+    quint64 lastRealtimeUs_ = 0;
+    quint64 lastMonotonicUs_ = 0;
+    QByteArray lastBootId_;
+    qint64 batchLagMs_ = 0;
+    qint64 batchMaxLagMs_ = 0;
+};
+
+} // namespace kpulse
@@ -0,0 +1,188 @@
+#include "event_deduplicator.hpp"
+
+#include <QJsonValue>
+#include <QTimeZone>
+
+namespace kpulse {
+
+namespace {
+
+// A collapsed event reports the highest anomaly score of its occurrences
+// (EventWriter scores every occurrence before admitting it).
+void foldBaselineScore(Event &into, const Event &occurrence)
+{
+    const QString key = QStringLiteral("baseline_score");
+    const QJsonValue score = occurrence.details.value(key);
+    if (score.isDouble() && score.toDouble() > into.details.value(key).toDouble()) {
+        into.details.insert(key, score);
+    }
+}
+
+} // namespace
+
+EventDeduplicator::EventDeduplicator(qint64 windowMs, int capacity)
+    : windowMs_(qMax<qint64>(0, windowMs))
+    , capacity_(qMax(1, capacity))
+{
+    slots_.reserve(capacity_);
+}
+
+EventDeduplicator::Key EventDeduplicator::keyOf(const Event &ev)
+{
+    return Key{ev.category, ev.severity, ev.label,
+               ev.details.value(QStringLiteral("unit")).toString()};
+}
+
+quint64 EventDeduplicator::takeCollapsed()
+{
+    const quint64 n = collapsed_;
+    collapsed_ = 0;
+    return n;
+}
+
+void EventDeduplicator::admit(Event &&ev, std::vector<Event> &pending)
+{
+    if (windowMs_ == 0) {
+        pending.push_back(std::move(ev));
+        return;
+    }
+
+    const qint64 ts = ev.timestamp.toMSecsSinceEpoch();
+    Key key = keyOf(ev);
+
+    auto it = slots_.find(key);
+    if (it != slots_.end()) {
+        Slot &slot = it.value();
+        const qint64 firstMs = slot.event.timestamp.toMSecsSinceEpoch();
+
+        // Older than the first occurrence: entries of merged journals can
+        // arrive slightly out of order.
+        if (ts < firstMs) {
+            // An event not stored yet can still start earlier.
+            if (slot.pendingIndex >= 0 && firstMs - ts <= windowMs_
+                && slot.lastMs - ts <= kMaxSpanMs) {
+                slot.event.timestamp = ev.timestamp;
+                ++slot.event.count;
+                slot.event.lastSeen = QDateTime::fromMSecsSinceEpoch(slot.lastMs, QTimeZone::utc());
+                foldBaselineScore(slot.event, ev);
+                lru_.splice(lru_.begin(), lru_, slot.lru);
+                ++collapsed_;
+
+                Event &first = pending[static_cast<std::size_t>(slot.pendingIndex)];
+                first.timestamp = slot.event.timestamp;
+                first.count = slot.event.count;
+                first.lastSeen = slot.event.lastSeen;
+                first.details = slot.event.details;
+                return;
+            }
+
+            // A stored one was announced with its time; the straggler is
+            // stored on its own and the open event stays as it is.
+            pending.push_back(std::move(ev));
+            return;
+        }
+
+        if (ts - slot.lastMs <= windowMs_ && ts - firstMs <= kMaxSpanMs) {
+            slot.lastMs = qMax(slot.lastMs, ts);
+            ++slot.event.count;
+            slot.event.lastSeen = QDateTime::fromMSecsSinceEpoch(slot.lastMs, QTimeZone::utc());
+            foldBaselineScore(slot.event, ev);
+            lru_.splice(lru_.begin(), lru_, slot.lru);
+            ++collapsed_;
+
+            if (slot.pendingIndex >= 0) {
+                Event &first = pending[static_cast<std::size_t>(slot.pendingIndex)];
+                first.count = slot.event.count;
+                first.lastSeen = slot.event.lastSeen;
+                first.details = slot.event.details;
+            } else {
+                repeats_.insert(slot.event.id, slot.event);
+                ++repeatDeltas_[slot.event.id];
+            }
+            return;
+        }
+
+        // Too long since the last occurrence, or open for too long: this
+        // one starts a new event.
+        lru_.erase(slot.lru);
+        slots_.erase(it);
+    } else if (slots_.size() >= capacity_) {
+        evictOldest();
+    }
+
+    Slot slot;
+    slot.event = ev;
+    slot.pendingIndex = static_cast<int>(pending.size());
+    slot.lastMs = ts;
+    lru_.push_front(key);
+    slot.lru = lru_.begin();
+    slots_.insert(std::move(key), std::move(slot));
+
+    pending.push_back(std::move(ev));
+}
+
+void EventDeduplicator::evictOldest()
+{
+    if (lru_.empty()) {
+        return;
+    }
+    slots_.remove(lru_.back());
+    lru_.pop_back();
+}
+
+void EventDeduplicator::stored(const std::vector<Event> &pending,
+                               const std::vector<qint64> &ids)
+{
+    for (std::size_t i = 0; i < pending.size() && i < ids.size(); ++i) {
+        auto it = slots_.find(keyOf(pending[i]));
+        if (it == slots_.end() || it->pendingIndex != static_cast<int>(i)) {
+            continue; // evicted or superseded meanwhile
+        }
+        it->event.id = ids[i];
+        it->pendingIndex = -1;
+    }
+}
+
+void EventDeduplicator::forgetPending()
+{
+    for (auto it = slots_.begin(); it != slots_.end();) {
+        if (it->pendingIndex >= 0) {
+            lru_.erase(it->lru);
+            it = slots_.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void EventDeduplicator::takeRepeats(std::vector<Event> &events, QList<int> &newOccurrences)
+{
+    events.clear();
+    newOccurrences.clear();
+    events.reserve(static_cast<std::size_t>(repeats_.size()));
+    newOccurrences.reserve(repeats_.size());
+
+    for (auto it = repeats_.cbegin(); it != repeats_.cend(); ++it) {
+        events.push_back(it.value());
+        newOccurrences << repeatDeltas_.value(it.key());
+    }
+    repeats_.clear();
+    repeatDeltas_.clear();
+}
+
+void EventDeduplicator::restoreRepeats(const std::vector<Event> &events,
+                                       const QList<int> &newOccurrences)
+{
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        const Event &ev = events[i];
+        // A repeat seen since then carries the newer count.
+        if (!repeats_.contains(ev.id)) {
+            repeats_.insert(ev.id, ev);
+        }
+        if (qsizetype(i) < newOccurrences.size()) {
+            repeatDeltas_[ev.id] += newOccurrences.at(qsizetype(i));
+        }
+    }
+}
+
+} // namespace kpulse
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include <list>
+#include <vector>
+
+#include "kpulse/event.hpp"
+
+namespace kpulse {
+
+// Collapses bursts of identical events before they are stored. Events
+// with the same (category, severity, label, unit) that arrive within
+// window() of the previous occurrence become one event with a count and
+// a lastSeen time instead of one row each. A collapsed event is closed
+// after kMaxSpanMs so a storm lasting hours still shows up as a series of
+// events over time.
+//
+// Open events live in a hash table of at most capacity() entries; when it
+// is full the least recently seen one is closed. Memory therefore stays
+// constant no matter how many distinct events a storm produces.
+//
+// Used by EventWriter on the writer thread:
+//
+//   admit() every event; new ones are appended to `pending`, repeats of a
+//   pending event are folded into it. After inserting `pending`, report
+//   the row ids with stored() (or forgetPending() on failure), then
+//   takeRepeats() yields stored events whose count grew.
+class EventDeduplicator
+{
+public:
+    static constexpr qint64 kMaxSpanMs = 10 * 60 * 1000;
+
+    explicit EventDeduplicator(qint64 windowMs = 60 * 1000, int capacity = 4096);
+
+    // 0 disables collapsing.
+    void setWindow(qint64 windowMs) { windowMs_ = qMax<qint64>(0, windowMs); }
+    qint64 window() const { return windowMs_; }
+    int capacity() const { return capacity_; }
+    int size() const { return static_cast<int>(slots_.size()); }
+
+    // Occurrences folded into an earlier event since the last call.
+    quint64 takeCollapsed();
+
+    void admit(Event &&ev, std::vector<Event> &pending);
+    void stored(const std::vector<Event> &pending, const std::vector<qint64> &ids);
+    void forgetPending();
+
+    // Stored events whose count grew since they were last reported, and
+    // for each the number of new occurrences.
+    void takeRepeats(std::vector<Event> &events, QList<int> &newOccurrences);
+
+    // Give back what takeRepeats() returned when storing it failed; it is
+    // merged with repeats seen since and returned again next time.
+    void restoreRepeats(const std::vector<Event> &events, const QList<int> &newOccurrences);
+
+private:
+    struct Key
+    {
+        Category category;
+        Severity severity;
+        QString label;
+        QString unit;
+
+        bool operator==(const Key &other) const
+        {
+            return category == other.category && severity == other.severity
+                && label == other.label && unit == other.unit;
+        }
+    };
+    friend size_t qHash(const Key &key, size_t seed)
+    {
+        return qHashMulti(seed, static_cast<int>(key.category),
+                          static_cast<int>(key.severity), key.label, key.unit);
+    }
+
+    struct Slot
+    {
+        Event event;            // first occurrence; count/lastSeen kept current
+        int pendingIndex = -1;  // index in `pending` until stored
+        qint64 lastMs = 0;
+        std::list<Key>::iterator lru;
+    };
+
+    static Key keyOf(const Event &ev);
+    void evictOldest();
+
+    qint64 windowMs_;
+    int capacity_;
+    QHash<Key, Slot> slots_;
+    std::list<Key> lru_;            // most recently seen first
+    QHash<qint64, Event> repeats_;  // by row id, latest state
+    QHash<qint64, int> repeatDeltas_;
+    quint64 collapsed_ = 0;
+};
+
+} // namespace kpulse
@@ -0,0 +1,311 @@
+#include "event_writer.hpp"
+
+#include <QDateTime>
+#include <QDebug>
+
+#include <cmath>
+#include <iterator>
+
+#include "daemon_metrics.hpp"
+
+namespace kpulse {
+
+namespace {
+constexpr const char *kJournalCursorKey = "journal_cursor";
+
+// How often the journal read position is persisted. A restart replays at
+// most this much of the journal.
+constexpr qint64 kCursorSaveIntervalMs = 5000;
+
+// Write-behind: events are committed once this many are pending or this
+// long after the first of them arrived, so a trickle of events does not
+// cost one transaction each.
+constexpr std::size_t kFlushEvents = 256;
+constexpr int kFlushDelayMs = 250;
+
+// Upper bound on events per insert transaction, so one commit never holds
+// the write lock for long while a backlog is being stored.
+constexpr std::size_t kMaxBatchEvents = 1024;
+
+// Retention runs in small steps: one step per idle interval, and while a
+// backlog of expired rows exists, a step every busy interval.
+constexpr int kRetentionIdleIntervalMs = 60 * 1000;
+constexpr int kRetentionBusyIntervalMs = 200;
+
+// How often anomaly baselines are persisted; a crash loses at most this
+// much learning.
+constexpr int kBaselineSaveIntervalMs = 5 * 60 * 1000;
+
+// Backoff between attempts to store a commit that failed (disk full,
+// database locked by another process, ...).
+constexpr int kRetryMinDelayMs = 500;
+constexpr int kRetryMaxDelayMs = 30 * 1000;
+} // namespace
+
+EventWriter::EventWriter(const QString &dbPath,
+                         BoundedQueue<EventBatch> *input,
+                         QObject *parent)
+    : QObject(parent)
+    , store_(dbPath)
+    , input_(input)
+{
+    retentionTimer_.setParent(this);
+    retentionTimer_.setSingleShot(true);
+    connect(&retentionTimer_, &QTimer::timeout,
+            this, &EventWriter::runRetention);
+
+    // A quiet journal produces no batches; this picks up a cursor that is
+    // only waiting for its save interval to pass.
+    cursorTimer_.setParent(this);
+    cursorTimer_.setInterval(kCursorSaveIntervalMs);
+    connect(&cursorTimer_, &QTimer::timeout, this, [this]() { saveCursor(false); });
+
+    baselineTimer_.setParent(this);
+    baselineTimer_.setInterval(kBaselineSaveIntervalMs);
+    connect(&baselineTimer_, &QTimer::timeout, this, &EventWriter::saveBaselines);
+
+    retryTimer_.setParent(this);
+    retryTimer_.setSingleShot(true);
+    connect(&retryTimer_, &QTimer::timeout, this, &EventWriter::drain);
+
+    flushTimer_.setParent(this);
+    flushTimer_.setSingleShot(true);
+    flushTimer_.setInterval(kFlushDelayMs);
+    connect(&flushTimer_, &QTimer::timeout, this, &EventWriter::commitPending);
+}
+
+bool EventWriter::open(QString *outCursor)
+{
+    if (!store_.open()) {
+        qWarning() << "EventWriter: failed to open event store";
+        return false;
+    }
+    if (!store_.initSchema()) {
+        qWarning() << "EventWriter: failed to initialise schema";
+        return false;
+    }
+
+    savedCursor_ = store_.metaValue(QString::fromUtf8(kJournalCursorKey));
+    cursor_ = savedCursor_;
+    if (outCursor) {
+        *outCursor = savedCursor_;
+    }
+    sinceCursorSave_.start();
+    cursorTimer_.start();
+
+    baseline_.restore(store_.loadBaselines());
+    baselineTimer_.start();
+
+    retentionTimer_.start(kRetentionBusyIntervalMs);
+    return true;
+}
+
+void EventWriter::drain()
+{
+    // A failed commit is retried first, on its backoff schedule. Until it
+    // is stored the input stays queued, so the reader is throttled rather
+    // than entries piling up here.
+    if (holding_ && (retryTimer_.isActive() || !retryHeld())) {
+        return;
+    }
+
+    std::vector<EventBatch> batches = input_->pop();
+    if (batches.empty()) {
+        return;
+    }
+
+    for (EventBatch &batch : batches) {
+        for (Event &ev : batch.events) {
+            // Scored before collapsing: every repeat moves the baseline, and
+            // the collapsed event keeps the highest score.
+            const double score = baseline_.observe(ev);
+            ev.details.insert(QStringLiteral("baseline_score"),
+                              std::round(score * 100.0) / 100.0);
+            dedup_.admit(std::move(ev), pending_);
+        }
+        if (!batch.cursor.isEmpty()) {
+            pendingCursor_ = batch.cursor;
+        }
+        if (pending_.size() >= kMaxBatchEvents) {
+            commitPending();
+        }
+    }
+
+    if (metrics_) {
+        metrics_->add(QStringLiteral("writer.events_collapsed"), double(dedup_.takeCollapsed()));
+        metrics_->set(QStringLiteral("writer.dedup_open_events"), dedup_.size());
+        metrics_->set(QStringLiteral("writer.baseline_labels"), baseline_.size());
+    }
+
+    // Repeats and cursor-only batches wait for the timer as well.
+    if (pending_.size() >= kFlushEvents) {
+        commitPending();
+    } else if (!flushTimer_.isActive()) {
+        flushTimer_.start();
+    }
+}
+
+void EventWriter::commitPending()
+{
+    flushTimer_.stop();
+
+    // Once a commit failed, everything after it is held behind it.
+    if (!holding_ && (pending_.empty() || storeEvents(pending_)) && storeRepeats()) {
+        // Only now are all entries up to this cursor safely stored.
+        if (!pendingCursor_.isEmpty()) {
+            cursor_ = pendingCursor_;
+        }
+    } else {
+        hold(pending_, pendingCursor_);
+    }
+    pending_.clear();
+    pendingCursor_.clear();
+
+    saveCursor(false);
+}
+
+bool EventWriter::storeEvents(std::vector<Event> &events)
+{
+    std::vector<qint64> ids;
+    if (!store_.insertEvents(events, &ids)) {
+        qWarning() << "EventWriter: failed to store" << events.size() << "events";
+        if (metrics_) {
+            metrics_->add(QStringLiteral("writer.failed_commits"));
+        }
+        return false;
+    }
+    if (!holding_) {
+        dedup_.stored(events, ids);
+    }
+
+    EventList stored;
+    stored.reserve(static_cast<qsizetype>(events.size()));
+    for (std::size_t i = 0; i < events.size(); ++i) {
+        events[i].id = ids[i];
+        stored.push_back(std::move(events[i]));
+    }
+    events.clear();
+
+    if (metrics_) {
+        metrics_->add(QStringLiteral("writer.transactions"));
+        metrics_->add(QStringLiteral("writer.events_stored"), stored.size());
+    }
+    emit eventsStored(stored);
+    return true;
+}
+
+bool EventWriter::storeRepeats()
+{
+    // Repeats of events stored by earlier commits.
+    std::vector<Event> repeats;
+    QList<int> newOccurrences;
+    dedup_.takeRepeats(repeats, newOccurrences);
+    if (repeats.empty()) {
+        return true;
+    }
+
+    if (!store_.updateRepeats(repeats)) {
+        qWarning() << "EventWriter: failed to update" << repeats.size()
+                   << "repeated events";
+        dedup_.restoreRepeats(repeats, newOccurrences);
+        if (metrics_) {
+            metrics_->add(QStringLiteral("writer.failed_commits"));
+        }
+        return false;
+    }
+    emit eventsUpdated(EventList(repeats.begin(), repeats.end()), newOccurrences);
+    return true;
+}
+
+void EventWriter::hold(std::vector<Event> &events, const QString &cursor)
+{
+    // Held events are no longer pending in the deduplicator; later
+    // occurrences start new events.
+    dedup_.forgetPending();
+
+    heldEvents_.insert(heldEvents_.end(),
+                       std::make_move_iterator(events.begin()),
+                       std::make_move_iterator(events.end()));
+    if (!cursor.isEmpty()) {
+        heldCursor_ = cursor;
+    }
+
+    if (metrics_) {
+        metrics_->set(QStringLiteral("writer.held_events"), double(heldEvents_.size()));
+    }
+
+    if (!holding_) {
+        holding_ = true;
+        retryDelayMs_ = kRetryMinDelayMs;
+        retryTimer_.start(retryDelayMs_);
+    }
+}
+
+bool EventWriter::retryHeld()
+{
+    if ((!heldEvents_.empty() && !storeEvents(heldEvents_)) || !storeRepeats()) {
+        retryDelayMs_ = qMin(retryDelayMs_ * 2, kRetryMaxDelayMs);
+        qWarning() << "EventWriter: retrying in" << retryDelayMs_ << "ms";
+        retryTimer_.start(retryDelayMs_);
+        return false;
+    }
+
+    holding_ = false;
+    if (!heldCursor_.isEmpty()) {
+        cursor_ = heldCursor_;
+        heldCursor_.clear();
+    }
+    if (metrics_) {
+        metrics_->set(QStringLiteral("writer.held_events"), 0.0);
+    }
+    saveCursor(false);
+    return true;
+}
+
+void EventWriter::finish()
+{
+    retentionTimer_.stop();
+    cursorTimer_.stop();
+    baselineTimer_.stop();
+    retryTimer_.stop();
+    drain();
+    commitPending();
+    if (holding_) {
+        // The saved cursor stays before them, so the next start re-reads
+        // the journal entries behind these.
+        qWarning() << "EventWriter: stopping with" << heldEvents_.size()
+                   << "events not stored";
+    }
+    saveCursor(true);
+    saveBaselines();
+}
+
+void EventWriter::saveBaselines()
+{
+    if (!store_.saveBaselines(baseline_.state())) {
+        qWarning() << "EventWriter: failed to save anomaly baselines";
+    }
+}
+
+void EventWriter::saveCursor(bool force)
+{
+    if (cursor_.isEmpty() || cursor_ == savedCursor_) {
+        return;
+    }
+    if (!force && sinceCursorSave_.elapsed() < kCursorSaveIntervalMs) {
+        return;
+    }
+
+    if (store_.setMetaValue(QString::fromUtf8(kJournalCursorKey), cursor_)) {
+        savedCursor_ = cursor_;
+        sinceCursorSave_.restart();
+    }
+}
+
+void EventWriter::runRetention()
+{
+    const bool more = store_.runRetentionStep(QDateTime::currentMSecsSinceEpoch());
+    retentionTimer_.start(more ? kRetentionBusyIntervalMs : kRetentionIdleIntervalMs);
+}
+
+} // namespace kpulse
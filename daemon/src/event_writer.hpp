@@ -0,0 +1,111 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QObject>
+#include <QString>
+#include <QTimer>
+
+#include <vector>
+
+#include "kpulse/db.hpp"
+#include "kpulse/dbus_types.hpp"
+
+#include "baseline_tracker.hpp"
+#include "event_deduplicator.hpp"
+#include "pipeline.hpp"
+
+namespace kpulse {
+
+class DaemonMetrics;
+
+// Last pipeline stage: owns the EventStore writer connection and is the
+// only thing that writes to the database. Lives on its own thread, so
+// inserts, cursor saves and retention never hold up the main loop.
+class EventWriter : public QObject
+{
+    Q_OBJECT
+public:
+    EventWriter(const QString &dbPath,
+                BoundedQueue<EventBatch> *input,
+                QObject *parent = nullptr);
+
+    // Must be called before open().
+    void setTuning(const StoreTuning &tuning) { store_.setTuning(tuning); }
+    void setRetentionPolicy(const RetentionPolicy &policy) { store_.setRetentionPolicy(policy); }
+    void setMetrics(DaemonMetrics *metrics) { metrics_ = metrics; }
+
+    // Identical events closer together than this are stored as one event
+    // with a repeat count (see EventDeduplicator). 0 stores every event.
+    // Must be called before open().
+    void setDedupWindow(qint64 windowMs) { dedup_.setWindow(windowMs); }
+
+    // Open the store, migrate the schema and start retention. Must run on
+    // the writer thread. outCursor receives the saved journal cursor.
+    bool open(QString *outCursor);
+
+    // Take everything queued. Events are committed once 256 are pending
+    // or 250 ms after the first arrived, at most kMaxBatchEvents per
+    // transaction. A commit that fails is held and retried with backoff;
+    // nothing more is taken from the input, and the cursor does not move
+    // past it, until it is stored.
+    void drain();
+
+    // Store everything queued and persist the latest cursor. Called once,
+    // right before the writer thread stops.
+    void finish();
+
+signals:
+    // Events committed to the database, with their ids set.
+    void eventsStored(const kpulse::EventList &events);
+
+    // Stored events whose count/lastSeen grew, with the number of new
+    // occurrences of each.
+    void eventsUpdated(const kpulse::EventList &events, const QList<int> &newOccurrences);
+
+private:
+    // Commit pending_ and the repeats collected so far, or hold them.
+    void commitPending();
+
+    // Insert events (emptying it) or update the repeats the deduplicator
+    // collected. Return false if the database refused them.
+    bool storeEvents(std::vector<Event> &events);
+    bool storeRepeats();
+
+    // Keep a failed commit for retryHeld(), which runs from retryTimer_.
+    void hold(std::vector<Event> &events, const QString &cursor);
+    bool retryHeld();
+
+    void saveCursor(bool force);
+    void saveBaselines();
+    void runRetention();
+
+    EventStore store_;
+    BoundedQueue<EventBatch> *input_;
+    EventDeduplicator dedup_;
+    BaselineTracker baseline_;
+    QTimer baselineTimer_;
+    DaemonMetrics *metrics_ = nullptr;
+
+    // Latest cursor whose events are stored, and the one in the database.
+    QString cursor_;
+    QString savedCursor_;
+    QElapsedTimer sinceCursorSave_;
+    QTimer cursorTimer_;
+
+    QTimer retentionTimer_;
+
+    // Admitted events not yet committed, and the cursor they reach.
+    std::vector<Event> pending_;
+    QString pendingCursor_;
+    QTimer flushTimer_;
+
+    // A failed commit: its events, already collapsed, and the cursor they
+    // reach. Repeat updates that failed wait in dedup_.
+    bool holding_ = false;
+    std::vector<Event> heldEvents_;
+    QString heldCursor_;
+    int retryDelayMs_ = 0;
+    QTimer retryTimer_;
+};
+
+} // namespace kpulse
@@ -0,0 +1,104 @@
+#include "health_tracker.hpp"
+
+namespace kpulse {
+
+HealthTracker::HealthTracker()
+    : windows_(kCategoryCount, HealthWindow(kMaxWindowMs, kBucketCount))
+{
+}
+
+void HealthTracker::add(const Event &ev, int occurrences)
+{
+    const int cat = static_cast<int>(ev.category);
+    if (cat < 0 || cat >= kCategoryCount) {
+        return;
+    }
+    windows_[cat].add(ev, occurrences);
+}
+
+void HealthTracker::advance(qint64 nowMs)
+{
+    for (HealthWindow &w : windows_) {
+        w.advance(nowMs);
+    }
+}
+
+qint64 HealthTracker::clampWindow(qint64 windowMs)
+{
+    return qBound<qint64>(kMaxWindowMs / kBucketCount, windowMs, kMaxWindowMs);
+}
+
+QJsonObject HealthTracker::summary(qint64 windowMs) const
+{
+    windowMs = clampWindow(windowMs);
+
+    std::array<int, HealthWindow::kSeverityCount> severityTotals {};
+    Severity worst = Severity::Info;
+    QJsonObject categories;
+
+    for (int cat = 0; cat < kCategoryCount; ++cat) {
+        const HealthWindow &w = windows_[cat];
+
+        QJsonObject entry;
+        for (int sev = 0; sev < HealthWindow::kSeverityCount; ++sev) {
+            const int n = w.count(static_cast<Severity>(sev), windowMs);
+            severityTotals[sev] += n;
+            entry.insert(severityToString(static_cast<Severity>(sev)), n);
+        }
+
+        const Severity catWorst = w.worst(windowMs);
+        entry.insert(QStringLiteral("worstSeverity"), severityToString(catWorst));
+        categories.insert(categoryToString(static_cast<Category>(cat)), entry);
+
+        if (static_cast<int>(catWorst) > static_cast<int>(worst)) {
+            worst = catWorst;
+        }
+    }
+
+    QJsonObject severities;
+    int total = 0;
+    for (int sev = 0; sev < HealthWindow::kSeverityCount; ++sev) {
+        severities.insert(severityToString(static_cast<Severity>(sev)), severityTotals[sev]);
+        total += severityTotals[sev];
+    }
+
+    QJsonObject obj;
+    obj.insert(QStringLiteral("windowMs"), windowMs);
+    obj.insert(QStringLiteral("worstSeverity"), severityToString(worst));
+    obj.insert(QStringLiteral("total"), total);
+    obj.insert(QStringLiteral("severities"), severities);
+    obj.insert(QStringLiteral("categories"), categories);
+
+    if (worst != Severity::Info) {
+        qint64 latestMs = -1;
+        QJsonObject latest;
+        for (int cat = 0; cat < kCategoryCount; ++cat) {
+            qint64 atMs = -1;
+            const QString label = windows_[cat].latestLabel(worst, windowMs, &atMs);
+            if (atMs > latestMs) {
+                latestMs = atMs;
+                latest.insert(QStringLiteral("category"),
+                              categoryToString(static_cast<Category>(cat)));
+                latest.insert(QStringLiteral("label"), label);
+            }
+        }
+        latest.insert(QStringLiteral("severity"), severityToString(worst));
+        latest.insert(QStringLiteral("timestampMs"), latestMs);
+        obj.insert(QStringLiteral("latest"), latest);
+    }
+
+    return obj;
+}
+
+HealthTracker::State HealthTracker::state(qint64 windowMs) const
+{
+    windowMs = clampWindow(windowMs);
+
+    State s;
+    for (int cat = 0; cat < kCategoryCount; ++cat) {
+        s[cat] = windows_[cat].worst(windowMs);
+    }
+    return s;
+}
+
+} // namespace kpulse
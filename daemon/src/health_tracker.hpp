@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QtGlobal>
+
+#include <array>
+#include <vector>
+
+#include "kpulse/event.hpp"
+#include "kpulse/health.hpp"
+
+namespace kpulse {
+
+// Rolling per-(category, severity) counters behind GetHealthSummary and
+// HealthChanged. Updated as events arrive, so a summary costs the same
+// no matter how many events fall in the window.
+class HealthTracker
+{
+public:
+    static constexpr int kCategoryCount = 6;
+
+    // Longest window a summary can cover, and its resolution.
+    static constexpr qint64 kMaxWindowMs = 60 * 60 * 1000;
+    static constexpr int kBucketCount = 360;
+
+    using State = std::array<Severity, kCategoryCount>;
+
+    HealthTracker();
+
+    void add(const Event &ev, int occurrences = 1);
+    void advance(qint64 nowMs);
+
+    // windowMs clamped to [bucket width, kMaxWindowMs].
+    static qint64 clampWindow(qint64 windowMs);
+
+    // {"windowMs", "worstSeverity", "total", "severities": {name: n},
+    //  "categories": {name: {"worstSeverity", severity name: n}},
+    //  "latest": {"category", "severity", "label", "timestampMs"}}
+    // "latest" describes the newest event of the worst severity and is
+    // omitted when the window holds nothing above info.
+    QJsonObject summary(qint64 windowMs) const;
+
+    // Worst severity per category: the part of the summary whose change
+    // is worth a HealthChanged signal.
+    State state(qint64 windowMs) const;
+
+private:
+    std::vector<HealthWindow> windows_;
+};
+
+} // namespace kpulse
@@ -0,0 +1,174 @@
+#include "journal_filter.hpp"
+
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <iterator>
+
+namespace kpulse {
+
+namespace {
+
+// Every value journald writes for _TRANSPORT (see systemd.journal-fields(7)).
+constexpr const char *kTransports[] = {
+    "audit", "driver", "syslog", "journal", "stdout", "kernel"};
+
+bool fieldFromName(const QString &name, JournalFilter::Field &out)
+{
+    for (auto f : {JournalFilter::Field::Priority, JournalFilter::Field::Identifier,
+                   JournalFilter::Field::Unit, JournalFilter::Field::Transport}) {
+        if (name == QLatin1String(JournalFilter::fieldName(f))) {
+            out = f;
+            return true;
+        }
+    }
+    return false;
+}
+
+} // namespace
+
+const char *JournalFilter::fieldName(Field field)
+{
+    switch (field) {
+    case Field::Priority:   return "PRIORITY";
+    case Field::Identifier: return "SYSLOG_IDENTIFIER";
+    case Field::Unit:       return "_SYSTEMD_UNIT";
+    case Field::Transport:  return "_TRANSPORT";
+    }
+    return "";
+}
+
+bool JournalFilter::loadFile(const QString &path, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = QStringLiteral("%1: %2").arg(path, file.errorString());
+        }
+        return false;
+    }
+
+    QString parseError;
+    if (!loadJson(file.readAll(), &parseError)) {
+        if (error) {
+            *error = QStringLiteral("%1: %2").arg(path, parseError);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool JournalFilter::loadJson(const QByteArray &json, QString *error)
+{
+    auto fail = [error](const QString &message) {
+        if (error) {
+            *error = message;
+        }
+        return false;
+    };
+
+    QJsonParseError err{};
+    const QJsonDocument doc = QJsonDocument::fromJson(json, &err);
+    if (err.error != QJsonParseError::NoError) {
+        return fail(err.errorString());
+    }
+    if (!doc.isObject()) {
+        return fail(QStringLiteral("top level is not an object"));
+    }
+
+    std::vector<Filter> filters;
+    unsigned mask = 0;
+
+    const QJsonArray array = doc.object().value(QStringLiteral("filters")).toArray();
+    for (int i = 0; i < array.size(); ++i) {
+        const QJsonObject obj = array.at(i).toObject();
+
+        Filter filter;
+        filter.name = obj.value(QStringLiteral("name")).toString();
+        if (filter.name.isEmpty()) {
+            filter.name = QStringLiteral("filter%1").arg(i);
+        }
+
+        const QString field = obj.value(QStringLiteral("field")).toString();
+        if (!fieldFromName(field, filter.field)) {
+            return fail(QStringLiteral("filter %1: cannot filter on field \"%2\"")
+                            .arg(i).arg(field));
+        }
+
+        for (const QJsonValue &v : obj.value(QStringLiteral("values")).toArray()) {
+            // PRIORITY may be given as a number as well.
+            const QByteArray value = v.isDouble()
+                ? QByteArray::number(v.toInt())
+                : v.toString().toUtf8();
+            if (value.isEmpty()) {
+                continue;
+            }
+            if (filter.field == Field::Priority
+                && (value.size() != 1 || value[0] < '0' || value[0] > '7')) {
+                return fail(QStringLiteral("filter %1: invalid priority \"%2\"")
+                                .arg(i).arg(QString::fromUtf8(value)));
+            }
+            filter.values << value;
+        }
+        if (filter.values.isEmpty()) {
+            return fail(QStringLiteral("filter %1: no values").arg(i));
+        }
+
+        mask |= bit(filter.field);
+        filters.push_back(std::move(filter));
+    }
+
+    filters_ = std::move(filters);
+    fieldMask_ = mask;
+    return true;
+}
+
+int JournalFilter::rejects(Field field, QByteArrayView value) const
+{
+    if (!filters(field) || value.isEmpty()) {
+        return -1;
+    }
+
+    for (std::size_t i = 0; i < filters_.size(); ++i) {
+        const Filter &filter = filters_[i];
+        if (filter.field != field) {
+            continue;
+        }
+        for (const QByteArray &v : filter.values) {
+            if (value == v) {
+                return static_cast<int>(i);
+            }
+        }
+    }
+    return -1;
+}
+
+QList<QByteArray> JournalFilter::journalMatches() const
+{
+    // Only _TRANSPORT is pushed down: journald sets it on every entry, so
+    // the positive matches exclude nothing the in-process check would let
+    // through. PRIORITY is missing on some entries (audit records, for
+    // one), and "PRIORITY=..." matches would drop those too.
+    if (!filters(Field::Transport)) {
+        return {};
+    }
+
+    QList<QByteArray> allowed;
+    for (const char *value : kTransports) {
+        if (rejects(Field::Transport, QByteArrayView(value)) < 0) {
+            allowed << QByteArray(fieldName(Field::Transport)) + '=' + value;
+        }
+    }
+
+    // Nothing to gain if every known value passes. Dropping every value is
+    // left to the in-process check; an empty match list would mean "no
+    // filter" instead.
+    if (allowed.isEmpty() || allowed.size() == qsizetype(std::size(kTransports))) {
+        return {};
+    }
+    return allowed;
+}
+
+} // namespace kpulse
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QList>
+#include <QString>
+
+#include <vector>
+
+namespace kpulse {
+
+// Field-level pre-filters, applied by JournaldReader before an entry's
+// MESSAGE is decoded. Read from the "filters" section of the rules file:
+//
+//   {"filters": [
+//     {"name": "debug", "field": "PRIORITY", "values": ["7"]},
+//     {"name": "audit", "field": "_TRANSPORT", "values": ["audit"]},
+//     {"name": "baloo", "field": "SYSLOG_IDENTIFIER", "values": ["baloo_file"]}
+//   ]}
+//
+// An entry is dropped when the field equals one of the values (exact,
+// byte-wise). PRIORITY, SYSLOG_IDENTIFIER, _SYSTEMD_UNIT and _TRANSPORT
+// can be filtered.
+//
+// _TRANSPORT, which journald sets on every entry, has a small fixed value
+// set, so its filters are also pushed down to the journal as the
+// complementary positive matches (see journalMatches()); such entries
+// never reach the daemon. Entries without a filtered field are never
+// dropped by that filter.
+class JournalFilter
+{
+public:
+    enum class Field { Priority, Identifier, Unit, Transport };
+
+    // Replace the filters with those in json. A missing "filters" section
+    // means no filters. On error the filters are left unchanged.
+    bool loadJson(const QByteArray &json, QString *error = nullptr);
+    bool loadFile(const QString &path, QString *error = nullptr);
+
+    bool isEmpty() const { return filters_.empty(); }
+    int size() const { return static_cast<int>(filters_.size()); }
+    const QString &name(int index) const { return filters_[index].name; }
+
+    // Whether any filter looks at `field`; callers skip fetching it if not.
+    bool filters(Field field) const { return (fieldMask_ & bit(field)) != 0; }
+
+    // Index of the first filter that drops an entry with this field value,
+    // or -1.
+    int rejects(Field field, QByteArrayView value) const;
+
+    // "_TRANSPORT=value" journal matches that let through exactly what the
+    // _TRANSPORT filters let through; empty when there is nothing to push
+    // down. sd-journal and journalctl OR matches on the same field.
+    QList<QByteArray> journalMatches() const;
+
+    static const char *fieldName(Field field);
+
+private:
+    struct Filter
+    {
+        QString name;
+        Field field = Field::Priority;
+        QList<QByteArray> values;
+    };
+
+    static unsigned bit(Field field) { return 1u << static_cast<int>(field); }
+
+    std::vector<Filter> filters_;
+    unsigned fieldMask_ = 0;
+};
+
+} // namespace kpulse
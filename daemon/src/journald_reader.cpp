@@ -1,18 +1,36 @@
 #include "journald_reader.hpp"
 
 #include <QDebug>
+#include <QFile>
 #include <QJsonDocument>
 #include <QJsonObject>
-#include <QRegularExpression>
-#include <QTimeZone>
+#include <QSocketNotifier>
 
-#include "kpulse/common.hpp"
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <systemd/sd-journal.h>
+
+#include "daemon_metrics.hpp"
 
 namespace kpulse {
 
 JournaldReader::JournaldReader(QObject *parent)
     : QObject(parent)
 {
+    pollTimer_.setParent(this);
+    connect(&pollTimer_, &QTimer::timeout,
+            this, &JournaldReader::handleJournalChanged);
+
+    drainTimer_.setParent(this);
+    drainTimer_.setSingleShot(true);
+    drainTimer_.setInterval(50);
+    connect(&drainTimer_, &QTimer::timeout,
+            this, &JournaldReader::continueDraining);
 }
 
 JournaldReader::~JournaldReader()
@@ -20,44 +38,269 @@ JournaldReader::~JournaldReader()
     stop();
 }
 
+bool JournaldReader::backendFromString(const QString &name, Backend &out)
+{
+    const QString lower = name.trimmed().toLower();
+
+    if (lower.isEmpty() || lower == QLatin1String("auto")) {
+        out = Backend::Auto;
+        return true;
+    }
+    if (lower == QLatin1String("native")) {
+        out = Backend::Native;
+        return true;
+    }
+    if (lower == QLatin1String("journalctl")) {
+        out = Backend::Journalctl;
+        return true;
+    }
+    return false;
+}
+
+void JournaldReader::setFilter(const JournalFilter &filter)
+{
+    filter_ = filter;
+    filterDrops_.assign(static_cast<std::size_t>(filter_.size()), 0);
+}
+
+void JournaldReader::setCatchUpThrottle(int batchSize, int intervalMs)
+{
+    batchSize_ = qMax(1, batchSize);
+    drainTimer_.setInterval(qMax(0, intervalMs));
+}
+
 bool JournaldReader::start()
 {
-    if (process_) {
+    if (journal_ || process_) {
+        return true;
+    }
+
+    switch (backend_) {
+    case Backend::Native:
+        return startNative();
+    case Backend::Journalctl:
+        return startJournalctl();
+    case Backend::Auto:
+        break;
+    }
+
+    if (startNative()) {
         return true;
     }
 
+    qWarning() << "JournaldReader: native journal access unavailable,"
+               << "falling back to journalctl";
+    return startJournalctl();
+}
+
+bool JournaldReader::startNative()
+{
+    int r = 0;
+    if (journalFiles_.isEmpty()) {
+        r = sd_journal_open(&journal_, SD_JOURNAL_LOCAL_ONLY);
+    } else {
+        std::vector<QByteArray> encoded;
+        std::vector<const char *> paths;
+        for (const QString &path : journalFiles_) {
+            encoded.push_back(QFile::encodeName(path));
+        }
+        for (const QByteArray &path : encoded) {
+            paths.push_back(path.constData());
+        }
+        paths.push_back(nullptr);
+        r = sd_journal_open_files(&journal_, paths.data(), 0);
+    }
+    if (r < 0) {
+        qWarning() << "JournaldReader: sd_journal_open failed:" << strerror(-r);
+        journal_ = nullptr;
+        return false;
+    }
+
+    // Matches must be in place before seeking; without them the reader
+    // still works, only with the in-process filter check alone.
+    for (const QByteArray &match : filter_.journalMatches()) {
+        r = sd_journal_add_match(journal_, match.constData(), std::size_t(match.size()));
+        if (r < 0) {
+            qWarning() << "JournaldReader: cannot push down filter" << match
+                       << "to the journal:" << strerror(-r);
+            sd_journal_flush_matches(journal_);
+            break;
+        }
+    }
+
+    if (!seekStart()) {
+        sd_journal_close(journal_);
+        journal_ = nullptr;
+        return false;
+    }
+
+    const int fd = sd_journal_get_fd(journal_);
+    if (fd < 0) {
+        qWarning() << "JournaldReader: sd_journal_get_fd failed:" << strerror(-fd);
+        sd_journal_close(journal_);
+        journal_ = nullptr;
+        return false;
+    }
+
+    // This is the event-loop equivalent of sd_journal_wait(): wake up when
+    // the journal's inotify fd becomes readable, then sd_journal_process().
+    notifier_ = new QSocketNotifier(fd, QSocketNotifier::Read, this);
+    connect(notifier_, &QSocketNotifier::activated,
+            this, &JournaldReader::handleJournalChanged);
+
+    // Some file systems cannot deliver inotify events; the journal then
+    // has to be polled instead.
+    if (sd_journal_reliable_fd(journal_) <= 0) {
+        pollTimer_.start(1000);
+    }
+
+    qInfo() << "JournaldReader: reading journal via sd-journal";
+
+    // Work through whatever was logged since the resume cursor.
+    drainJournal();
+    return true;
+}
+
+bool JournaldReader::seekStart()
+{
+    if (!resumeCursor_.isEmpty()) {
+        const QByteArray c = resumeCursor_.toUtf8();
+        int r = sd_journal_seek_cursor(journal_, c.constData());
+        if (r >= 0) {
+            r = sd_journal_next(journal_);
+        }
+        if (r > 0 && sd_journal_test_cursor(journal_, c.constData()) <= 0) {
+            // The cursor entry itself was rotated away; we landed on the
+            // first entry after it, which has not been processed yet.
+            // Stepping back is not an option: when that entry is now the
+            // head there is nothing before it to step to.
+            entryPending_ = true;
+        }
+        if (r >= 0) {
+            qInfo() << "JournaldReader: resuming after saved journal cursor";
+            cursor_ = resumeCursor_;
+            return true;
+        }
+        qWarning() << "JournaldReader: cannot seek to saved cursor:" << strerror(-r)
+                   << "- starting at the tail";
+    }
+
+    // Journal files given explicitly are read in full.
+    if (!journalFiles_.isEmpty()) {
+        const int r = sd_journal_seek_head(journal_);
+        if (r < 0) {
+            qWarning() << "JournaldReader: failed to seek journal head:" << strerror(-r);
+            return false;
+        }
+        return true;
+    }
+
+    // Same semantics as `journalctl -f`: only entries written from now on.
+    // seek_tail positions after the last entry; stepping back once makes
+    // the next sd_journal_next() return the first new entry.
+    int r = sd_journal_seek_tail(journal_);
+    if (r >= 0) {
+        r = sd_journal_previous(journal_);
+    }
+    if (r < 0) {
+        qWarning() << "JournaldReader: failed to seek journal tail:" << strerror(-r);
+        return false;
+    }
+    return true;
+}
+
+bool JournaldReader::startJournalctl()
+{
     process_ = new QProcess(this);
 
     // journalctl -f -o json : follow journal as JSON lines
     QStringList args;
     args << QStringLiteral("-f")
          << QStringLiteral("-o") << QStringLiteral("json");
+    if (!resumeCursor_.isEmpty()) {
+        args << QStringLiteral("--after-cursor=%1").arg(resumeCursor_);
+        cursor_ = resumeCursor_;
+    } else if (!journalFiles_.isEmpty()) {
+        args << QStringLiteral("--no-tail");
+    }
+    for (const QString &path : journalFiles_) {
+        args << QStringLiteral("--file=%1").arg(path);
+    }
+    for (const QByteArray &match : filter_.journalMatches()) {
+        args << QString::fromUtf8(match);
+    }
+
+    int fds[2];
+    if (::pipe2(fds, O_CLOEXEC) != 0) {
+        qWarning() << "JournaldReader: cannot create pipe for journalctl:" << strerror(errno);
+        delete process_;
+        process_ = nullptr;
+        return false;
+    }
+    pipeFd_ = fds[0];
+    ::fcntl(pipeFd_, F_SETFL, ::fcntl(pipeFd_, F_GETFL) | O_NONBLOCK);
 
     process_->setProgram(QStringLiteral("journalctl"));
     process_->setArguments(args);
-    process_->setProcessChannelMode(QProcess::MergedChannels);
+    process_->setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    process_->setStandardOutputFile(QProcess::nullDevice());
+    const int writeFd = fds[1];
+    process_->setChildProcessModifier([writeFd]() {
+        // Runs after QProcess set up the standard channels; dup2() clears
+        // O_CLOEXEC on the copy.
+        ::dup2(writeFd, STDOUT_FILENO);
+    });
 
-    connect(process_, &QProcess::readyReadStandardOutput,
-            this, &JournaldReader::handleReadyRead);
     connect(process_,
             QOverload<int, QProcess::ExitStatus>::of(&QProcess::finished),
             this,
             &JournaldReader::handleFinished);
 
     process_->start();
+    ::close(writeFd);
     if (!process_->waitForStarted(3000)) {
         qWarning() << "JournaldReader: failed to start journalctl process";
         delete process_;
         process_ = nullptr;
+        ::close(pipeFd_);
+        pipeFd_ = -1;
         return false;
     }
 
+    pipeNotifier_ = new QSocketNotifier(pipeFd_, QSocketNotifier::Read, this);
+    connect(pipeNotifier_, &QSocketNotifier::activated,
+            this, &JournaldReader::handleReadyRead);
+
     qInfo() << "JournaldReader: started journalctl -f -o json";
     return true;
 }
 
 void JournaldReader::stop()
 {
+    pollTimer_.stop();
+    drainTimer_.stop();
+
+    if (notifier_) {
+        delete notifier_;
+        notifier_ = nullptr;
+    }
+    if (journal_) {
+        sd_journal_close(journal_);
+        journal_ = nullptr;
+    }
+    entryPending_ = false;
+
+    if (pipeNotifier_) {
+        delete pipeNotifier_;
+        pipeNotifier_ = nullptr;
+    }
+    if (pipeFd_ >= 0) {
+        ::close(pipeFd_);
+        pipeFd_ = -1;
+    }
+    pipeBuffer_.clear();
+    pipeOffset_ = 0;
+
     if (!process_) {
         return;
     }
@@ -65,152 +308,268 @@ void JournaldReader::stop()
     process_->waitForFinished(1000);
     delete process_;
     process_ = nullptr;
-    buffer_.clear();
 }
 
-void JournaldReader::handleReadyRead()
+void JournaldReader::handleJournalChanged()
 {
-    if (!process_) {
+    if (!journal_) {
         return;
     }
 
-    buffer_.append(process_->readAllStandardOutput());
+    const int r = sd_journal_process(journal_);
+    if (r < 0) {
+        qWarning() << "JournaldReader: sd_journal_process failed:" << strerror(-r);
+        return;
+    }
 
-    int index = 0;
-    while (true) {
-        int newline = buffer_.indexOf('\n', index);
-        if (newline < 0) {
-            // No complete line yet.
+    // While a backlog batch is pending the continuation picks up the new
+    // entries as well; do not bypass the throttle.
+    if (!drainTimer_.isActive()) {
+        drainJournal();
+    }
+}
+
+void JournaldReader::continueDraining()
+{
+    if (journal_) {
+        drainJournal();
+    } else if (process_) {
+        drainProcess();
+    }
+}
+
+void JournaldReader::drainJournal()
+{
+    int processed = 0;
+    bool more = false;
+
+    while (journal_) {
+        if (processed >= batchSize_) {
+            more = true;
             break;
         }
 
-        QByteArray line = buffer_.mid(index, newline - index).trimmed();
-        if (!line.isEmpty()) {
-            processLine(line);
+        int r = 1;
+        if (entryPending_) {
+            entryPending_ = false;
+        } else {
+            r = sd_journal_next(journal_);
+        }
+        if (r < 0) {
+            qWarning() << "JournaldReader: sd_journal_next failed:" << strerror(-r);
+            break;
+        }
+        if (r == 0) {
+            // Caught up with the writer.
+            break;
+        }
+
+        JournalEntry entry;
+        if (readEntry(entry)) {
+            batch_.entries.push_back(std::move(entry));
         }
+        ++processed;
+    }
+
+    publishBatchStats(processed);
 
-        index = newline + 1;
+    // The cursor is only needed for persistence, so fetch it once per batch
+    // rather than once per entry.
+    if (journal_ && processed > 0) {
+        char *c = nullptr;
+        if (sd_journal_get_cursor(journal_, &c) >= 0 && c) {
+            cursor_ = QString::fromUtf8(c);
+            std::free(c);
+        }
     }
+    flushBatch();
 
-    // Keep any partial line for next time.
-    if (index > 0) {
-        buffer_ = buffer_.mid(index);
+    if (more) {
+        drainTimer_.start();
     }
 }
 
-void JournaldReader::handleFinished(int exitCode, QProcess::ExitStatus status)
+namespace {
+
+// sd_journal_get_data() hands back "FIELD=value" without copying; only the
+// value part is converted.
+bool journalField(sd_journal *j, const char *field, const char *&value, qsizetype &length)
 {
-    Q_UNUSED(exitCode);
-    Q_UNUSED(status);
-    qWarning() << "JournaldReader: journalctl exited; stopping reader";
-    stop();
+    const void *data = nullptr;
+    size_t size = 0;
+    if (sd_journal_get_data(j, field, &data, &size) < 0) {
+        return false;
+    }
+
+    const size_t prefix = std::strlen(field) + 1;
+    if (size < prefix) {
+        return false;
+    }
+
+    value  = static_cast<const char *>(data) + prefix;
+    length = static_cast<qsizetype>(size - prefix);
+    return true;
 }
 
-Severity JournaldReader::severityFromPriority(int prio)
+QString journalString(sd_journal *j, const char *field)
 {
-    // systemd priorities: 0..7 (emerg..debug)
-    if (prio <= 2) {
-        return Severity::Critical;
+    const char *value = nullptr;
+    qsizetype length = 0;
+    if (!journalField(j, field, value, length)) {
+        return QString();
     }
-    if (prio <= 3) {
-        return Severity::Error;
+    return QString::fromUtf8(value, length);
+}
+
+} // namespace
+
+bool JournaldReader::filteredOut(JournalFilter::Field field, QByteArrayView value)
+{
+    const int index = filter_.rejects(field, value);
+    if (index < 0) {
+        return false;
     }
-    if (prio <= 4) {
-        return Severity::Warning;
+    ++filterDrops_[static_cast<std::size_t>(index)];
+    return true;
+}
+
+bool JournaldReader::readEntry(JournalEntry &entry)
+{
+    const char *value = nullptr;
+    qsizetype length = 0;
+
+    if (journalField(journal_, "PRIORITY", value, length)) {
+        if (filteredOut(JournalFilter::Field::Priority, QByteArrayView(value, length))) {
+            return false;
+        }
+        if (length == 1 && value[0] >= '0' && value[0] <= '7') {
+            entry.priority = value[0] - '0';
+        }
+    }
+
+    // Pre-filters look at the raw field bytes, so a dropped entry costs a
+    // few lookups and no decoding.
+    for (auto field : {JournalFilter::Field::Identifier, JournalFilter::Field::Unit,
+                       JournalFilter::Field::Transport}) {
+        if (filter_.filters(field)
+            && journalField(journal_, JournalFilter::fieldName(field), value, length)
+            && filteredOut(field, QByteArrayView(value, length))) {
+            return false;
+        }
+    }
+
+    uint64_t usec = 0;
+    if (sd_journal_get_realtime_usec(journal_, &usec) >= 0) {
+        entry.realtimeUs = usec;
+    }
+    sd_id128_t bootId;
+    if (sd_journal_get_monotonic_usec(journal_, &usec, &bootId) >= 0) {
+        entry.monotonicUs = usec;
+
+        // Format the id once per boot rather than once per entry.
+        if (bootId.qwords[0] != bootIdKey_[0] || bootId.qwords[1] != bootIdKey_[1]
+            || bootId_.isEmpty()) {
+            char hex[SD_ID128_STRING_MAX];
+            bootId_ = QByteArray(sd_id128_to_string(bootId, hex));
+            bootIdKey_[0] = bootId.qwords[0];
+            bootIdKey_[1] = bootId.qwords[1];
+        }
+        entry.bootId = bootId_;
     }
-    return Severity::Info;
+
+    entry.message    = journalString(journal_, "MESSAGE");
+    entry.unit       = journalString(journal_, "_SYSTEMD_UNIT");
+    entry.identifier = journalString(journal_, "SYSLOG_IDENTIFIER");
+    return true;
 }
 
-// Classifier with special-cases + gating
-bool JournaldReader::classifyMessage(const QString &message,
-                                     Category &outCategory,
-                                     Severity &outSeverity,
-                                     QString &outLabel)
+void JournaldReader::handleReadyRead()
 {
-    const QString lower = message.toLower();
-
-    // HTTP 429 / rate limiting (from requests / services)
-    if (lower.contains("httperror") &&
-        (lower.contains("429 client error") ||
-         lower.contains("too many requests"))) {
-        outCategory = Category::Network;
-        outSeverity = Severity::Warning;
-        outLabel = QStringLiteral("HTTP 429 (rate limited)");
-        return true;
+    if (!drainTimer_.isActive()) {
+        drainProcess();
     }
+}
 
-    // GPU hangs / resets / timeouts
-    if ((lower.contains("gpu") || lower.contains("amdgpu") || lower.contains("nvidia")) &&
-        (lower.contains("hang") || lower.contains("reset") ||
-         lower.contains("fault") || lower.contains("timeout"))) {
-        outCategory = Category::GPU;
-        outSeverity = Severity::Error;
-        outLabel = QStringLiteral("GPU hang/reset");
-        return true;
+void JournaldReader::drainProcess()
+{
+    if (!process_ || pipeFd_ < 0) {
+        return;
     }
 
-    // Thermal throttling
-    if (lower.contains("thermal") ||
-        lower.contains("throttle") ||
-        lower.contains("temperature above threshold")) {
-        outCategory = Category::Thermal;
-        outSeverity = Severity::Warning;
-        outLabel = QStringLiteral("Thermal throttling");
-        return true;
+    int processed = 0;
+    bool eof = false;
+    QByteArray line;
+    while (processed < batchSize_ && readPipeLine(line, eof)) {
+        line = line.trimmed();
+        if (!line.isEmpty()) {
+            processLine(line);
+        }
+        ++processed;
     }
 
-    // OOM killer / out of memory
-    if (lower.contains("oom-killer") ||
-        lower.contains("out of memory")) {
-        outCategory = Category::System;
-        outSeverity = Severity::Critical;
-        outLabel = QStringLiteral("Out-of-memory condition");
-        return true;
+    // Keep the buffer to the unparsed tail.
+    if (pipeOffset_ > 0) {
+        pipeBuffer_.remove(0, pipeOffset_);
+        pipeOffset_ = 0;
     }
 
-    // Soft lockups / watchdog
-    if (lower.contains("soft lockup") ||
-        lower.contains("watchdog: bug: soft lockup")) {
-        outCategory = Category::System;
-        outSeverity = Severity::Error;
-        outLabel = QStringLiteral("CPU soft lockup");
-        return true;
+    publishBatchStats(processed);
+    flushBatch();
+
+    // Behind: stop reading until the next paced batch, so the backlog stays
+    // in the pipe and in journalctl instead of in our memory.
+    const bool behind = processed >= batchSize_;
+    if (pipeNotifier_) {
+        pipeNotifier_->setEnabled(!behind && !eof);
     }
+    if (behind) {
+        drainTimer_.start();
+    }
+}
+
+bool JournaldReader::readPipeLine(QByteArray &line, bool &eof)
+{
+    constexpr qsizetype kChunkSize = 64 * 1024;
+
+    for (;;) {
+        const qsizetype newline = pipeBuffer_.indexOf('\n', pipeOffset_);
+        if (newline >= 0) {
+            line = pipeBuffer_.mid(pipeOffset_, newline - pipeOffset_);
+            pipeOffset_ = newline + 1;
+            return true;
+        }
+        if (eof) {
+            return false;
+        }
 
-    // systemd resource accounting:
-    // "Consumed 1.690s CPU time over 8.269s wall clock time, 274.1M memory peak."
-    if (lower.contains("consumed") &&
-        lower.contains("cpu time over") &&
-        lower.contains("memory peak")) {
-
-        static QRegularExpression re(
-            R"(Consumed\s+([0-9\.]+)s CPU time over\s+([0-9\.]+)s wall clock time,\s+([0-9\.]+)M memory peak\.)",
-            QRegularExpression::CaseInsensitiveOption
-        );
-
-        const QRegularExpressionMatch m = re.match(message);
-        if (m.hasMatch()) {
-            const double cpuSec = m.captured(1).toDouble();
-            const double wallSec = m.captured(2).toDouble();
-            const double memMB  = m.captured(3).toDouble();
-
-            // Thresholds: only surface if meaningfully heavy
-            const double CPU_THRESHOLD  = 5.0;    // seconds
-            const double MEM_THRESHOLD  = 1024.0; // ~1 GiB
-
-            if (cpuSec >= CPU_THRESHOLD || memMB >= MEM_THRESHOLD) {
-                outCategory = Category::Process;
-                outSeverity = Severity::Warning;
-                outLabel = QStringLiteral("High resource usage (systemd)");
-                return true;
-            } else {
-                // Below threshold: treat as noise, do NOT classify
-                return false;
+        const qsizetype used = pipeBuffer_.size();
+        pipeBuffer_.resize(used + kChunkSize);
+        const ssize_t n = ::read(pipeFd_, pipeBuffer_.data() + used, std::size_t(kChunkSize));
+        const int error = errno;
+        pipeBuffer_.resize(used + qMax<ssize_t>(0, n));
+
+        if (n == 0) {
+            eof = true;
+        } else if (n < 0) {
+            if (error == EINTR) {
+                continue;
             }
+            if (error != EAGAIN && error != EWOULDBLOCK) {
+                qWarning() << "JournaldReader: reading journalctl output failed:"
+                           << strerror(error);
+                eof = true;
+            }
+            return false;
         }
     }
+}
 
-    return false;
+void JournaldReader::handleFinished(int exitCode, QProcess::ExitStatus status)
+{
+    Q_UNUSED(exitCode);
+    Q_UNUSED(status);
+    qWarning() << "JournaldReader: journalctl exited; stopping reader";
+    stop();
 }
 
 void JournaldReader::processLine(const QByteArray &line)
@@ -223,66 +582,88 @@ void JournaldReader::processLine(const QByteArray &line)
 
     const QJsonObject obj = doc.object();
 
-    // MESSAGE
-    const QString message = obj.value(QStringLiteral("MESSAGE")).toString();
+    JournalEntry entry;
+
+    // The cursor advances past dropped entries too.
+    entry.cursor = obj.value(QStringLiteral("__CURSOR")).toString();
+    if (!entry.cursor.isEmpty()) {
+        cursor_ = entry.cursor;
+    }
 
     // PRIORITY (string or int)
-    int prio = 5;
     const QJsonValue prioVal = obj.value(QStringLiteral("PRIORITY"));
     if (prioVal.isString()) {
         bool ok = false;
         int tmp = prioVal.toString().toInt(&ok);
-        if (ok) prio = tmp;
+        if (ok) entry.priority = tmp;
     } else if (prioVal.isDouble()) {
-        prio = prioVal.toInt();
+        entry.priority = prioVal.toInt();
     }
 
     // UNIT / IDENTIFIER
-    const QString unit = obj.value(QStringLiteral("_SYSTEMD_UNIT")).toString();
-    const QString ident = obj.value(QStringLiteral("SYSLOG_IDENTIFIER")).toString();
-
-    // 🔇 Filter: kioworker AppImage thumbnail spam
-    if (ident == QStringLiteral("kioworker") &&
-        message.contains(QStringLiteral("thumbcreator/appimagethumbnail.so"))) {
-        return; // ignore completely
+    entry.unit = obj.value(QStringLiteral("_SYSTEMD_UNIT")).toString();
+    entry.identifier = obj.value(QStringLiteral("SYSLOG_IDENTIFIER")).toString();
+
+    // Pre-filters run before MESSAGE, the largest field, is converted.
+    auto dropped = [this](JournalFilter::Field field, const QString &value) {
+        return filter_.filters(field) && filteredOut(field, value.toUtf8());
+    };
+    if (((prioVal.isString() || prioVal.isDouble())
+         && dropped(JournalFilter::Field::Priority, QString::number(entry.priority)))
+        || dropped(JournalFilter::Field::Identifier, entry.identifier)
+        || dropped(JournalFilter::Field::Unit, entry.unit)
+        || dropped(JournalFilter::Field::Transport,
+                   obj.value(QStringLiteral("_TRANSPORT")).toString())) {
+        return;
     }
 
-    Category cat = Category::System;
-    Severity sev = severityFromPriority(prio);
-    QString label;
+    // MESSAGE
+    entry.message = obj.value(QStringLiteral("MESSAGE")).toString();
 
-    const bool matched = classifyMessage(message, cat, sev, label);
+    // journalctl prints the timestamps as decimal strings (µs)
+    entry.realtimeUs = obj.value(QStringLiteral("__REALTIME_TIMESTAMP"))
+                           .toString().toULongLong();
+    entry.monotonicUs = obj.value(QStringLiteral("__MONOTONIC_TIMESTAMP"))
+                            .toString().toULongLong();
+    entry.bootId = obj.value(QStringLiteral("_BOOT_ID")).toString().toLatin1();
 
-    if (!matched) {
-        // Fallback: generic mapping, but with gating:
-        // we DROP generic system/info noise.
-        cat = Category::System;
-        label = message.left(120);
+    batch_.entries.push_back(std::move(entry));
+}
 
-        if (sev == Severity::Info && cat == Category::System) {
-            // too chatty, skip this event entirely
-            return;
-        }
+void JournaldReader::flushBatch()
+{
+    // A batch whose entries were all filtered out still has to move the
+    // saved cursor forward.
+    if (batch_.entries.empty() && cursor_ == flushedCursor_) {
+        return;
     }
 
-    Event ev;
-    ev.timestamp = nowUtc();  // journalctl already ordered; approximate is fine
-    ev.category = cat;
-    ev.severity = sev;
-    ev.label = label;
+    batch_.cursor = cursor_;
+    flushedCursor_ = cursor_;
+    if (output_) {
+        output_->push(std::move(batch_));
+    }
+    batch_ = JournalBatch();
+}
 
-    QJsonObject details;
-    if (!message.isEmpty())
-        details.insert(QStringLiteral("message"), message);
-    if (!unit.isEmpty())
-        details.insert(QStringLiteral("unit"), unit);
-    if (!ident.isEmpty())
-        details.insert(QStringLiteral("identifier"), ident);
-    details.insert(QStringLiteral("priority"), prio);
+void JournaldReader::publishBatchStats(int entries)
+{
+    if (!metrics_ || entries == 0) {
+        return;
+    }
 
-    ev.details = details;
+    metrics_->add(QStringLiteral("journal.entries_read"), entries);
 
-    emit eventDetected(ev);
+    // Entries dropped by a pushed-down filter never get here and are not
+    // counted.
+    for (std::size_t i = 0; i < filterDrops_.size(); ++i) {
+        if (filterDrops_[i] == 0) {
+            continue;
+        }
+        metrics_->add(QStringLiteral("journal.filter.%1.dropped").arg(filter_.name(int(i))),
+                      double(filterDrops_[i]));
+        filterDrops_[i] = 0;
+    }
 }
 
 } // namespace kpulse
@@ -2,44 +2,146 @@
 
 #include <QObject>
 #include <QProcess>
+#include <QString>
+#include <QStringList>
+#include <QTimer>
 
-#include "kpulse/event.hpp"
+#include <vector>
+
+#include "journal_filter.hpp"
+#include "pipeline.hpp"
+
+struct sd_journal;
+class QSocketNotifier;
 
 namespace kpulse {
 
+class DaemonMetrics;
+
 class JournaldReader : public QObject
 {
     Q_OBJECT
 public:
+    enum class Backend {
+        Auto,       // native sd-journal, falling back to journalctl
+        Native,     // sd_journal_* API only
+        Journalctl  // spawn `journalctl -f -o json`
+    };
+
     explicit JournaldReader(QObject *parent = nullptr);
     ~JournaldReader() override;
 
-    // Start tailing the systemd journal via `journalctl -f -o json`.
-    // Returns false if the process cannot be started.
+    // Select which backend start() uses. Must be called before start().
+    void setBackend(Backend backend) { backend_ = backend; }
+
+    // Start tailing the systemd journal. With Backend::Auto the native
+    // sd-journal reader is tried first and journalctl is only spawned if
+    // the journal cannot be opened directly.
+    // Returns false if no backend could be started.
     bool start();
 
     // Stop reading and release resources.
     void stop();
 
-signals:
-    // Emitted whenever we detect an interesting event in the journal.
-    void eventDetected(const kpulse::Event &event);
+    // Resume after this journal cursor instead of starting at the tail.
+    // Must be called before start(). An empty cursor means "tail".
+    void setResumeCursor(const QString &cursor) { resumeCursor_ = cursor; }
+
+    // Read these journal files (e.g. a recorded one) instead of the system
+    // journal, from their first entry unless a resume cursor is set. Must
+    // be called before start().
+    void setJournalFiles(const QStringList &paths) { journalFiles_ = paths; }
+
+    // Where every drained batch of entries goes, together with the journal
+    // cursor after it. Pushing blocks while the queue is full. Must be set
+    // before start().
+    void setOutput(BoundedQueue<JournalBatch> *queue) { output_ = queue; }
+
+    // Entries to drop before their message is decoded. Filters that can be
+    // expressed as journal matches are pushed down to the journal (or
+    // journalctl) as well. Must be called before start().
+    void setFilter(const JournalFilter &filter);
+
+    // Where read counters are published. Optional.
+    void setMetrics(DaemonMetrics *metrics) { metrics_ = metrics; }
+
+    // Backlog pacing: at most batchSize entries are processed per event-loop
+    // turn, with intervalMs between batches while more entries are pending.
+    void setCatchUpThrottle(int batchSize, int intervalMs);
+
+    static bool backendFromString(const QString &name, Backend &out);
 
 private slots:
     void handleReadyRead();
     void handleFinished(int exitCode, QProcess::ExitStatus status);
+    void handleJournalChanged();
+    void continueDraining();
 
 private:
+    bool startNative();
+    bool startJournalctl();
+
+    // Native backend: position the read pointer at the resume cursor, or
+    // at the tail when there is none (or it cannot be found).
+    bool seekStart();
+
+    // Consume up to one batch of pending entries. If more remain, a
+    // continuation is scheduled on drainTimer_.
+    void drainJournal();
+    void drainProcess();
+
+    // journalctl backend: next complete line from the pipe, reading at most
+    // one chunk if none is buffered. False when no full line is available.
+    bool readPipeLine(QByteArray &line, bool &eof);
+    bool readEntry(JournalEntry &entry);
+
+    // Check one field against the pre-filters, counting a drop.
+    bool filteredOut(JournalFilter::Field field, QByteArrayView value);
+
+    // journalctl backend: decode one JSON line.
     void processLine(const QByteArray &line);
 
-    static Severity severityFromPriority(int prio);
-    static bool classifyMessage(const QString &message,
-                                Category &outCategory,
-                                Severity &outSeverity,
-                                QString &outLabel);
+    // Hand the entries collected so far to the classifier stage.
+    void flushBatch();
+    void publishBatchStats(int entries);
+
+    Backend backend_ = Backend::Auto;
+
+    QString resumeCursor_;
+    QStringList journalFiles_;
+    QString cursor_;
+    QString flushedCursor_;
+    int batchSize_ = 500;
+    QTimer drainTimer_;
 
+    BoundedQueue<JournalBatch> *output_ = nullptr;
+    JournalBatch batch_;
+
+    JournalFilter filter_;
+    std::vector<quint64> filterDrops_;   // per filter, since last publish
+
+    DaemonMetrics *metrics_ = nullptr;
+
+    // Native backend state
+    sd_journal *journal_ = nullptr;
+    quint64 bootIdKey_[2] = {0, 0};   // raw _BOOT_ID of bootId_
+    QByteArray bootId_;               // shared by all entries of that boot
+    QSocketNotifier *notifier_ = nullptr;
+    QTimer pollTimer_;
+
+    // journalctl backend state. Its stdout is a pipe read directly rather
+    // than through QProcess, which would drain it into an unbounded buffer
+    // whenever the event loop runs: while a backlog is paced the notifier
+    // is disabled, the pipe fills up and journalctl blocks.
     QProcess *process_ = nullptr;
-    QByteArray buffer_;
+    int pipeFd_ = -1;
+    QSocketNotifier *pipeNotifier_ = nullptr;
+    QByteArray pipeBuffer_;     // bytes read but not yet parsed
+    qsizetype pipeOffset_ = 0;  // start of the first unparsed line
+
+    // Native backend: the read pointer already sits on an unprocessed
+    // entry, so the next drain must not step past it first.
+    bool entryPending_ = false;
 };
 
 } // namespace kpulse
@@ -3,29 +3,197 @@
 #include "kpulse/common.hpp"
 
 #include <QDBusConnection>
+#include <QDBusError>
+#include <QDBusMessage>
 #include <QDebug>
 #include <QJsonArray>
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QTimeZone>
 
+#include <optional>
+#include <utility>
+
 #include "kpulse_daemon_adaptor.h"
 
 namespace kpulse {
 
+namespace {
+// Queue capacities between pipeline stages. Journal batches hold up to
+// one drain (500 entries) each.
+constexpr std::size_t kJournalQueueBatches = 16;
+constexpr std::size_t kEventQueueBatches = 64;
+
+// Threads (and so read-only SQLite connections) answering DBus queries.
+constexpr int kReadPoolThreads = 2;
+
+// Window whose state changes are signalled via HealthChanged, and how
+// often it is re-evaluated as old events age out.
+constexpr qint64 kHealthSignalWindowMs = 5 * 60 * 1000;
+constexpr int kHealthCheckIntervalMs = 10 * 1000;
+
+// /proc and /sys sampling period.
+constexpr int kMetricsIntervalMs = 1000;
+
+// Bounds for GetEventsPage's limit argument.
+constexpr int kMaxPageSize = 5000;
+
+// Page tokens are "<timestamp_ms>:<id>" of the last event returned. They
+// are opaque to clients.
+QString encodePageToken(const Event &last)
+{
+    return QStringLiteral("%1:%2")
+        .arg(last.timestamp.toMSecsSinceEpoch())
+        .arg(last.id);
+}
+
+std::optional<EventKey> decodePageToken(const QString &token)
+{
+    const int sep = token.indexOf(QLatin1Char(':'));
+    if (sep <= 0) {
+        return std::nullopt;
+    }
+
+    bool okTs = false;
+    bool okId = false;
+    EventKey key;
+    key.timestampMs = token.left(sep).toLongLong(&okTs);
+    key.id = token.mid(sep + 1).toLongLong(&okId);
+    if (!okTs || !okId) {
+        return std::nullopt;
+    }
+    return key;
+}
+
+std::vector<Category> categoriesFromNames(const QStringList &names)
+{
+    std::vector<Category> cats;
+    cats.reserve(names.size());
+    for (const QString &name : names) {
+        cats.push_back(categoryFromString(name));
+    }
+    return cats;
+}
+
+std::vector<Event> queryPage(EventStore &store,
+                             qlonglong fromMs,
+                             qlonglong toMs,
+                             const QStringList &categories,
+                             const std::optional<EventKey> &after,
+                             int limit,
+                             QString &nextPageToken)
+{
+    const QDateTime from = QDateTime::fromMSecsSinceEpoch(fromMs, QTimeZone::utc());
+    const QDateTime to   = QDateTime::fromMSecsSinceEpoch(toMs,   QTimeZone::utc());
+
+    bool hasMore = false;
+    auto events = store.queryEventsPage(from, to,
+                                        categoriesFromNames(categories),
+                                        after,
+                                        qBound(1, limit, kMaxPageSize),
+                                        &hasMore);
+
+    nextPageToken = (hasMore && !events.empty())
+        ? encodePageToken(events.back())
+        : QString();
+
+    return events;
+}
+
+// Run lastWork on the stage's own thread, then stop the thread. The stage
+// deletes itself when its thread finishes; a stage whose thread never ran
+// is deleted right here.
+void stopStage(QThread &thread, QObject *stage, const std::function<void()> &lastWork)
+{
+    if (!thread.isRunning()) {
+        delete stage;
+        return;
+    }
+
+    if (lastWork) {
+        QMetaObject::invokeMethod(stage, lastWork, Qt::BlockingQueuedConnection);
+    }
+    thread.quit();
+    thread.wait();
+}
+
+QString eventsToJsonString(const std::vector<Event> &events)
+{
+    QJsonArray arr;
+    for (const auto &ev : events) {
+        arr.push_back(eventToJson(ev));
+    }
+
+    QJsonDocument doc(arr);
+    return QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
+}
+} // namespace
+
 KPulseDaemon::KPulseDaemon(const QString &dbPath, QObject *parent)
     : QObject(parent)
     , dbPath_(dbPath)
-    , store_(dbPath)
-    , journald_(this)
+    , journalQueue_(kJournalQueueBatches)
+    , eventQueue_(kEventQueueBatches)
     , metrics_(this)
+    , broadcaster_(this)
 {
-    // Wire daemon to sources of events
-    connect(&journald_, &JournaldReader::eventDetected,
-            this, &KPulseDaemon::handleEventDetected);
+    registerDBusTypes();
+
+    // Ingestion pipeline: reader -> classifier -> writer, one thread each.
+    journald_ = new JournaldReader();
+    journald_->setOutput(&journalQueue_);
+    journald_->setMetrics(&daemonMetrics_);
+
+    classifier_ = new EventClassifier(&journalQueue_, &eventQueue_);
+    classifier_->setMetrics(&daemonMetrics_);
+
+    writer_ = new EventWriter(dbPath, &eventQueue_);
+    writer_->setMetrics(&daemonMetrics_);
+
+    const std::pair<QThread *, QObject *> stages[] = {
+        {&readerThread_, journald_},
+        {&classifierThread_, classifier_},
+        {&writerThread_, writer_},
+    };
+    for (const auto &[thread, stage] : stages) {
+        stage->moveToThread(thread);
+        connect(thread, &QThread::finished, stage, &QObject::deleteLater);
+    }
+    readerThread_.setObjectName(QStringLiteral("kpulse-reader"));
+    classifierThread_.setObjectName(QStringLiteral("kpulse-classifier"));
+    writerThread_.setObjectName(QStringLiteral("kpulse-writer"));
+
+    journalQueue_.setNotify([this]() {
+        QMetaObject::invokeMethod(classifier_, &EventClassifier::drain, Qt::QueuedConnection);
+    });
+    eventQueue_.setNotify([this]() {
+        QMetaObject::invokeMethod(writer_, &EventWriter::drain, Qt::QueuedConnection);
+    });
+
+    connect(writer_, &EventWriter::eventsStored,
+            this, &KPulseDaemon::handleEventsStored);
+    connect(writer_, &EventWriter::eventsUpdated,
+            this, &KPulseDaemon::handleEventsUpdated);
+
+    // Other sources feed the writer directly.
+    metrics_.setMetrics(&daemonMetrics_);
     connect(&metrics_, &MetricsCollector::eventDetected,
             this, &KPulseDaemon::handleEventDetected);
 
+    broadcaster_.setMetrics(&daemonMetrics_);
+    connect(&broadcaster_, &EventBroadcaster::batchReady,
+            this, &KPulseDaemon::handleBatchReady);
+    connect(&broadcaster_, &EventBroadcaster::updatesReady,
+            this, &KPulseDaemon::EventsUpdated);
+
+    healthTimer_.setParent(this);
+    connect(&healthTimer_, &QTimer::timeout,
+            this, &KPulseDaemon::checkHealth);
+
+    // Keep the query threads (and their connections) around.
+    readPool_.setMaxThreadCount(kReadPoolThreads);
+    readPool_.setExpiryTimeout(-1);
+
     // Set up DBus adaptor and object registration.
     auto *adaptor = new DaemonAdaptor(this);
     Q_UNUSED(adaptor);
@@ -39,24 +207,106 @@ KPulseDaemon::KPulseDaemon(const QString &dbPath, QObject *parent)
     }
 }
 
+KPulseDaemon::~KPulseDaemon()
+{
+    metrics_.stop();
+    readPool_.waitForDone();
+
+    // Stop upstream first and let each stage finish what it was handed, so
+    // the last saved cursor covers everything that was read.
+    stopStage(readerThread_, journald_, [this]() { journald_->stop(); });
+    stopStage(classifierThread_, classifier_, [this]() { classifier_->drain(); });
+    stopStage(writerThread_, writer_, [this]() { writer_->finish(); });
+
+    journalQueue_.close();
+    eventQueue_.close();
+}
+
+void KPulseDaemon::setJournalBackend(JournaldReader::Backend backend)
+{
+    journald_->setBackend(backend);
+}
+
+void KPulseDaemon::setStoreTuning(const StoreTuning &tuning)
+{
+    tuning_ = tuning;
+    writer_->setTuning(tuning);
+}
+
+void KPulseDaemon::setRetentionPolicy(const RetentionPolicy &policy)
+{
+    writer_->setRetentionPolicy(policy);
+}
+
+void KPulseDaemon::setBroadcastWindow(int windowMs, int maxEvents)
+{
+    broadcaster_.setWindow(windowMs, maxEvents);
+}
+
+void KPulseDaemon::setDedupWindow(qint64 windowMs)
+{
+    writer_->setDedupWindow(windowMs);
+}
+
+void KPulseDaemon::setRules(const RuleSet &rules)
+{
+    classifier_->setRules(rules);
+}
+
+void KPulseDaemon::setJournalFilter(const JournalFilter &filter)
+{
+    journald_->setFilter(filter);
+}
+
 bool KPulseDaemon::init()
 {
-    if (!store_.open()) {
+    writerThread_.start();
+    classifierThread_.start();
+    readerThread_.start();
+
+    // The writer owns the database; it opens and migrates it on its own
+    // thread and hands back the saved journal cursor.
+    bool opened = false;
+    QString cursor;
+    QMetaObject::invokeMethod(writer_, [this, &opened, &cursor]() {
+        opened = writer_->open(&cursor);
+    }, Qt::BlockingQueuedConnection);
+    if (!opened) {
         qWarning() << "KPulseDaemon: failed to open event store at" << dbPath_;
         return false;
     }
-    if (!store_.initSchema()) {
-        qWarning() << "KPulseDaemon: failed to initialise schema";
-        return false;
+
+    // Seed the health counters with what is already stored; from here on
+    // they are maintained as events are stored.
+    {
+        EventStore seedStore(dbPath_);
+        seedStore.setTuning(tuning_);
+        if (seedStore.openReadOnly()) {
+            const QDateTime now = nowUtc();
+            const auto recent = seedStore.queryEvents(
+                now.addMSecs(-HealthTracker::kMaxWindowMs), now, {});
+            for (const Event &ev : recent) {
+                health_.add(ev, ev.count);
+            }
+        }
     }
+    checkHealth();
+    healthTimer_.start(kHealthCheckIntervalMs);
 
+    // Resume where the previous run stopped so nothing logged while the
+    // daemon was down is lost.
     // Phase 19: start journald tailing so real system events feed into KPulse.
-    if (!journald_.start()) {
+    bool started = false;
+    QMetaObject::invokeMethod(journald_, [this, &started, &cursor]() {
+        journald_->setResumeCursor(cursor);
+        started = journald_->start();
+    }, Qt::BlockingQueuedConnection);
+    if (!started) {
         qWarning() << "KPulseDaemon: journald reader failed to start";
         // Not fatal: KPulse still works via InjectTestEvent/other sources.
     }
 
-    // MetricsCollector can be wired up later.
+    metrics_.start(kMetricsIntervalMs);
     return true;
 }
 
@@ -64,30 +314,222 @@ QString KPulseDaemon::GetEvents(qlonglong fromMs,
                                 qlonglong toMs,
                                 const QStringList &categories)
 {
-    // Convert from/to to UTC QDateTime
-    QDateTime from = QDateTime::fromMSecsSinceEpoch(fromMs, QTimeZone::utc());
-    QDateTime to   = QDateTime::fromMSecsSinceEpoch(toMs,   QTimeZone::utc());
+    replyFromReadPool([=](EventStore &store) {
+        // Convert from/to to UTC QDateTime
+        const QDateTime from = QDateTime::fromMSecsSinceEpoch(fromMs, QTimeZone::utc());
+        const QDateTime to   = QDateTime::fromMSecsSinceEpoch(toMs,   QTimeZone::utc());
 
-    // Map category names (strings) to enum Category
-    std::vector<Category> cats;
-    cats.reserve(categories.size());
-    for (const QString &name : categories) {
-        cats.push_back(categoryFromString(name));
+        // Query the event store and serialize events as a JSON array
+        const auto events = store.queryEvents(from, to, categoriesFromNames(categories));
+        return QVariantList{eventsToJsonString(events)};
+    });
+    return QString();
+}
+
+QString KPulseDaemon::GetEventsPage(qlonglong fromMs,
+                                    qlonglong toMs,
+                                    const QStringList &categories,
+                                    const QString &pageToken,
+                                    int limit,
+                                    QString &nextPageToken)
+{
+    Q_UNUSED(nextPageToken);
+    std::optional<EventKey> after;
+    if (!decodePageTokenArg(pageToken, after)) {
+        return QString();
     }
+    replyFromReadPool([=](EventStore &store) {
+        QString next;
+        const auto events =
+            queryPage(store, fromMs, toMs, categories, after, limit, next);
+        return QVariantList{eventsToJsonString(events), next};
+    });
+    return QString();
+}
 
-    // Query the event store
-    const auto events = store_.queryEvents(from, to, cats);
+EventList KPulseDaemon::GetEventsBinary(qlonglong fromMs,
+                                        qlonglong toMs,
+                                        const QStringList &categories)
+{
+    replyFromReadPool([=](EventStore &store) {
+        const QDateTime from = QDateTime::fromMSecsSinceEpoch(fromMs, QTimeZone::utc());
+        const QDateTime to   = QDateTime::fromMSecsSinceEpoch(toMs,   QTimeZone::utc());
 
-    // Serialize events as a JSON array
-    QJsonArray arr;
-    for (const auto &ev : events) {
-        arr.push_back(eventToJson(ev));
+        const auto events = store.queryEvents(from, to, categoriesFromNames(categories));
+        return QVariantList{QVariant::fromValue(EventList(events.begin(), events.end()))};
+    });
+    return EventList();
+}
+
+EventList KPulseDaemon::GetEventsPageBinary(qlonglong fromMs,
+                                            qlonglong toMs,
+                                            const QStringList &categories,
+                                            const QString &pageToken,
+                                            int limit,
+                                            QString &nextPageToken)
+{
+    Q_UNUSED(nextPageToken);
+    std::optional<EventKey> after;
+    if (!decodePageTokenArg(pageToken, after)) {
+        return EventList();
     }
+    replyFromReadPool([=](EventStore &store) {
+        QString next;
+        const auto events =
+            queryPage(store, fromMs, toMs, categories, after, limit, next);
+        return QVariantList{QVariant::fromValue(EventList(events.begin(), events.end())),
+                            next};
+    });
+    return EventList();
+}
 
-    QJsonDocument doc(arr);
+QList<uint> KPulseDaemon::GetEventHistogram(qlonglong fromMs,
+                                            qlonglong toMs,
+                                            qlonglong bucketMs,
+                                            const QStringList &categories,
+                                            qlonglong &usedBucketMs)
+{
+    Q_UNUSED(usedBucketMs);
+
+    if (!EventHistogram::isValidRange(fromMs, toMs)) {
+        if (calledFromDBus()) {
+            sendErrorReply(QDBusError::InvalidArgs,
+                           QStringLiteral("GetEventHistogram needs 0 <= fromMs < toMs <= %1")
+                               .arg(EventHistogram::kMaxTimestampMs));
+        }
+        return QList<uint>();
+    }
+
+    // Keep the reply (and the work) bounded whatever the caller asks for.
+    const qint64 bucket = EventHistogram::effectiveBucketMs(fromMs, toMs, bucketMs);
+
+    replyFromReadPool([=](EventStore &store) -> std::optional<QVariantList> {
+        EventHistogram histogram;
+        if (!store.histogram(fromMs, toMs, bucket, categoriesFromNames(categories), histogram)) {
+            return std::nullopt;
+        }
+        const QList<uint> counts(histogram.counts.begin(), histogram.counts.end());
+        return QVariantList{QVariant::fromValue(counts), qlonglong(bucket)};
+    });
+    return QList<uint>();
+}
+
+bool KPulseDaemon::decodePageTokenArg(const QString &pageToken,
+                                      std::optional<EventKey> &after)
+{
+    if (pageToken.isEmpty()) {
+        after.reset();
+        return true;
+    }
+
+    after = decodePageToken(pageToken);
+    if (!after) {
+        // Starting over would hand a paging client rows it already has.
+        if (calledFromDBus()) {
+            sendErrorReply(QDBusError::InvalidArgs,
+                           QStringLiteral("Malformed page token \"%1\"").arg(pageToken));
+        }
+        return false;
+    }
+    return true;
+}
+
+void KPulseDaemon::replyFromReadPool(std::function<std::optional<QVariantList>(EventStore &)> query)
+{
+    if (!calledFromDBus()) {
+        return;
+    }
+
+    setDelayedReply(true);
+    const QDBusMessage call = message();
+    QDBusConnection bus = connection();
+
+    readPool_.start([this, call, bus, query]() mutable {
+        EventStore *store = readStore();
+        if (!store) {
+            bus.send(call.createErrorReply(QDBusError::Failed,
+                                           QStringLiteral("Event store unavailable")));
+            return;
+        }
+        const std::optional<QVariantList> reply = query(*store);
+        if (!reply) {
+            bus.send(call.createErrorReply(QDBusError::Failed,
+                                           QStringLiteral("Event store query failed")));
+            return;
+        }
+        bus.send(call.createReply(*reply));
+    });
+}
+
+EventStore *KPulseDaemon::readStore()
+{
+    if (!readStores_.hasLocalData()) {
+        auto *store = new EventStore(dbPath_);
+        store->setTuning(tuning_);
+        if (!store->openReadOnly()) {
+            delete store;
+            return nullptr;
+        }
+        readStores_.setLocalData(store);
+    }
+    return readStores_.localData();
+}
+
+void KPulseDaemon::publishPipelineMetrics()
+{
+    const auto publishQueue = [this](const QString &name, auto &queue) {
+        daemonMetrics_.set(name + QStringLiteral(".depth"), double(queue.size()));
+        daemonMetrics_.set(name + QStringLiteral(".capacity"), double(queue.capacity()));
+        daemonMetrics_.set(name + QStringLiteral(".high_water"), double(queue.takeHighWater()));
+        daemonMetrics_.set(name + QStringLiteral(".blocked_pushes"), double(queue.blockedPushes()));
+        daemonMetrics_.set(name + QStringLiteral(".dropped_pushes"), double(queue.droppedPushes()));
+    };
+    publishQueue(QStringLiteral("pipeline.journal_queue"), journalQueue_);
+    publishQueue(QStringLiteral("pipeline.event_queue"), eventQueue_);
+
+    daemonMetrics_.set(QStringLiteral("pipeline.read_pool.active"),
+                       double(readPool_.activeThreadCount()));
+}
+
+QString KPulseDaemon::GetMetrics()
+{
+    publishPipelineMetrics();
+    QJsonDocument doc(daemonMetrics_.snapshot());
     return QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
 }
 
+QString KPulseDaemon::GetHealthSummary(qlonglong windowMs)
+{
+    health_.advance(QDateTime::currentMSecsSinceEpoch());
+    QJsonDocument doc(health_.summary(windowMs));
+    return QString::fromUtf8(doc.toJson(QJsonDocument::Compact));
+}
+
+void KPulseDaemon::Subscribe(const QString &minSeverity, const QStringList &categories)
+{
+    if (!calledFromDBus()) {
+        return;
+    }
+
+    quint32 mask = 0;
+    for (const QString &name : categories) {
+        mask |= EventBroadcaster::categoryBit(categoryFromString(name));
+    }
+    if (categories.isEmpty()) {
+        mask = ~0u;
+    }
+
+    broadcaster_.subscribe(message().service(), severityFromString(minSeverity), mask);
+}
+
+void KPulseDaemon::Unsubscribe()
+{
+    if (!calledFromDBus()) {
+        return;
+    }
+    broadcaster_.unsubscribe(message().service());
+}
+
 void KPulseDaemon::InjectTestEvent(const QString &category,
                                    const QString &severity,
                                    const QString &label,
@@ -106,29 +548,90 @@ void KPulseDaemon::InjectTestEvent(const QString &category,
         }
     }
 
-    handleEventDetected(ev);
+    if (!enqueueEvent(ev) && calledFromDBus()) {
+        sendErrorReply(QDBusError::LimitsExceeded,
+                       QStringLiteral("Event queue is full; the event was dropped"));
+    }
 }
 
 void KPulseDaemon::handleEventDetected(const kpulse::Event &event)
 {
-    Event eventCopy = event;
-    if (!eventCopy.timestamp.isValid()) {
-        eventCopy.timestamp = nowUtc();
+    enqueueEvent(event);
+}
+
+bool KPulseDaemon::enqueueEvent(const Event &event)
+{
+    EventBatch batch;
+    batch.events.push_back(event);
+    if (!batch.events.back().timestamp.isValid()) {
+        batch.events.back().timestamp = nowUtc();
+    }
+
+    // This runs on the main thread, which also answers DBus; it must not
+    // wait for a busy writer, so these events are dropped instead. Each
+    // run of drops is logged when it starts and when it ends.
+    if (!eventQueue_.tryPush(std::move(batch))) {
+        if (droppedInBurst_++ == 0) {
+            qWarning() << "KPulseDaemon: writer is behind, dropping events";
+        }
+        return false;
+    }
+    if (droppedInBurst_ > 0) {
+        qWarning() << "KPulseDaemon: writer caught up after dropping"
+                   << droppedInBurst_ << "events";
+        droppedInBurst_ = 0;
+    }
+    return true;
+}
+
+void KPulseDaemon::handleEventsStored(const EventList &events)
+{
+    for (const Event &ev : events) {
+        health_.add(ev, ev.count);
     }
 
-    qint64 id = 0;
-    if (!store_.insertEvent(eventCopy, &id)) {
-        qWarning() << "KPulseDaemon: failed to store event";
+    broadcaster_.publish(events);
+    checkHealth();
+}
+
+void KPulseDaemon::handleBatchReady(const EventList &events)
+{
+    emit EventsAdded(events);
+
+    // Listeners of the old per-event JSON signal get the same batch.
+    for (const Event &ev : events) {
+        emit EventAdded(eventToJsonString(ev));
+    }
+}
+
+void KPulseDaemon::handleEventsUpdated(const EventList &events,
+                                       const QList<int> &newOccurrences)
+{
+    // The new occurrences happened around lastSeen, not at the first one.
+    for (qsizetype i = 0; i < events.size() && i < newOccurrences.size(); ++i) {
+        Event latest = events.at(i);
+        if (latest.lastSeen.isValid()) {
+            latest.timestamp = latest.lastSeen;
+        }
+        health_.add(latest, newOccurrences.at(i));
+    }
+
+    broadcaster_.publishUpdates(events);
+    checkHealth();
+}
+
+void KPulseDaemon::checkHealth()
+{
+    health_.advance(QDateTime::currentMSecsSinceEpoch());
+
+    const HealthTracker::State state = health_.state(kHealthSignalWindowMs);
+    if (state == healthState_) {
         return;
     }
+    healthState_ = state;
 
-    // Emit DBus-visible signal with the stored event JSON.
-    QJsonObject obj = eventToJson(eventCopy);
-    QJsonDocument doc(obj);
-    const QString json = QString::fromUtf8(
-        doc.toJson(QJsonDocument::Compact)
-    );
-    emit EventAdded(json);
+    QJsonDocument doc(health_.summary(kHealthSignalWindowMs));
+    emit HealthChanged(QString::fromUtf8(doc.toJson(QJsonDocument::Compact)));
 }
 
 } // namespace kpulse
@@ -1,27 +1,71 @@
 #pragma once
 
+#include <QDBusContext>
 #include <QObject>
 #include <QString>
 #include <QStringList>
 #include <QDateTime>
+#include <QThread>
+#include <QThreadPool>
+#include <QThreadStorage>
+#include <QTimer>
+#include <QVariantList>
+
+#include <functional>
+#include <optional>
+#include <vector>
 
 #include "kpulse/db.hpp"
+#include "kpulse/dbus_types.hpp"
 #include "kpulse/event.hpp"
 
+#include "daemon_metrics.hpp"
+#include "event_broadcaster.hpp"
+#include "event_classifier.hpp"
+#include "event_writer.hpp"
+#include "health_tracker.hpp"
 #include "journald_reader.hpp"
 #include "metrics_collector.hpp"
+#include "pipeline.hpp"
+#include "rule_engine.hpp"
 
 namespace kpulse {
 
-class KPulseDaemon : public QObject
+class KPulseDaemon : public QObject, protected QDBusContext
 {
     Q_OBJECT
 public:
     explicit KPulseDaemon(const QString &dbPath, QObject *parent = nullptr);
+    ~KPulseDaemon() override;
+
+    // Select the journal reader backend. Must be called before init().
+    void setJournalBackend(JournaldReader::Backend backend);
+
+    // Select the SQLite tuning profile. Must be called before init().
+    void setStoreTuning(const StoreTuning &tuning);
+
+    // Configure how long raw events are kept. Must be called before init().
+    void setRetentionPolicy(const RetentionPolicy &policy);
+
+    // Coalescing window for live event signals. Must be called before init().
+    void setBroadcastWindow(int windowMs, int maxEvents);
+
+    // Gap below which identical events are collapsed into one stored event
+    // (0 = keep every event). Must be called before init().
+    void setDedupWindow(qint64 windowMs);
+
+    // Journal classification rules. Must be called before init().
+    void setRules(const RuleSet &rules);
+
+    // Journal field pre-filters. Must be called before init().
+    void setJournalFilter(const JournalFilter &filter);
 
     // Initialise the event store and any other resources.
     bool init();
 
+    // The GetEvents* methods are answered from a pool of query threads:
+    // they mark the call for a delayed reply and return a dummy value.
+
     // DBus-exposed method used by the generated DaemonAdaptor.
     // Returns a JSON array (as a compact string) of events that fall within
     // the given time range and category filter.
@@ -29,8 +73,51 @@ public:
                       qlonglong toMs,
                       const QStringList &categories);
 
+    // DBus-exposed: one page (at most `limit` events) of GetEvents.
+    // nextPageToken is empty once the range is exhausted.
+    QString GetEventsPage(qlonglong fromMs,
+                          qlonglong toMs,
+                          const QStringList &categories,
+                          const QString &pageToken,
+                          int limit,
+                          QString &nextPageToken);
+
+    // DBus-exposed binary counterparts of GetEvents/GetEventsPage.
+    EventList GetEventsBinary(qlonglong fromMs,
+                              qlonglong toMs,
+                              const QStringList &categories);
+    EventList GetEventsPageBinary(qlonglong fromMs,
+                                  qlonglong toMs,
+                                  const QStringList &categories,
+                                  const QString &pageToken,
+                                  int limit,
+                                  QString &nextPageToken);
+
+    // DBus-exposed: dense per-bucket occurrence counts, see
+    // EventHistogram for the layout. usedBucketMs is bucketMs after
+    // clamping the number of buckets.
+    QList<uint> GetEventHistogram(qlonglong fromMs,
+                                  qlonglong toMs,
+                                  qlonglong bucketMs,
+                                  const QStringList &categories,
+                                  qlonglong &usedBucketMs);
+
+    // DBus-exposed: JSON object of daemon self-metrics (ingest lag, ...).
+    QString GetMetrics();
+
+    // DBus-exposed: JSON summary (worst severity, per-category and
+    // per-severity counts) of the last windowMs, answered from in-memory
+    // rolling counters. See HealthTracker::summary() for the layout.
+    QString GetHealthSummary(qlonglong windowMs);
+
+    // DBus-exposed: deliver live events to the calling bus name through the
+    // targeted SubscribedEventsAdded signal, restricted to events of at
+    // least minSeverity in the given categories (empty = all).
+    void Subscribe(const QString &minSeverity, const QStringList &categories);
+    void Unsubscribe();
+
     // DBus-exposed test helper: inject a synthetic event into the store and
-    // broadcast it via EventAdded. Useful for testing the UI without relying
+    // broadcast it via EventsAdded. Useful for testing the UI without relying
     // on real journald/metrics sources.
     void InjectTestEvent(const QString &category,
                          const QString &severity,
@@ -38,18 +125,74 @@ public:
                          const QString &detailsJson);
 
 signals:
-    // Emitted whenever a new event is stored. The DBus adaptor maps this
-    // to the "EventAdded" signal defined in dbus_interface.xml.
+    // Coalesced batch of newly stored events. The DBus adaptor maps this to
+    // the "EventsAdded" signal defined in dbus_interface.xml.
+    void EventsAdded(const kpulse::EventList &events);
+
+    // Deprecated "EventAdded" DBus signal: each event of an EventsAdded
+    // batch again, as JSON.
     void EventAdded(const QString &eventJson);
 
+    // Coalesced repeat-count updates of already announced events; the
+    // "EventsUpdated" DBus signal.
+    void EventsUpdated(const kpulse::EventList &events);
+
+    // Emitted with a fresh 5-minute GetHealthSummary whenever the worst
+    // severity of any category in that window changes.
+    void HealthChanged(const QString &summaryJson);
+
 private slots:
     void handleEventDetected(const kpulse::Event &event);
+    void handleEventsStored(const kpulse::EventList &events);
+    void handleBatchReady(const kpulse::EventList &events);
+    void handleEventsUpdated(const kpulse::EventList &events,
+                             const QList<int> &newOccurrences);
+    void checkHealth();
 
 private:
+    // Decode a GetEventsPage token (empty = first page). A malformed one is
+    // answered with InvalidArgs and false is returned.
+    bool decodePageTokenArg(const QString &pageToken, std::optional<EventKey> &after);
+
+    // Hand an event to the writer without blocking. Returns false if the
+    // queue was full and the event was dropped.
+    bool enqueueEvent(const kpulse::Event &event);
+
+    // Answer the DBus call being handled with query(store) run on
+    // readPool_, against that thread's read-only EventStore. A query
+    // returning nullopt is answered with an error.
+    void replyFromReadPool(std::function<std::optional<QVariantList>(EventStore &)> query);
+    EventStore *readStore();
+
+    void publishPipelineMetrics();
+
     QString         dbPath_;
-    EventStore      store_;
-    JournaldReader  journald_;
+    StoreTuning     tuning_;
+    DaemonMetrics   daemonMetrics_;
+
+    // Ingestion pipeline (see pipeline.hpp). Each stage object lives on its
+    // own thread and is deleted there when the thread finishes.
+    BoundedQueue<JournalBatch> journalQueue_;
+    BoundedQueue<EventBatch> eventQueue_;
+    QThread          readerThread_;
+    QThread          classifierThread_;
+    QThread          writerThread_;
+    JournaldReader  *journald_ = nullptr;
+    EventClassifier *classifier_ = nullptr;
+    EventWriter     *writer_ = nullptr;
+    quint64          droppedInBurst_ = 0;
+
     MetricsCollector metrics_;
+    EventBroadcaster broadcaster_;
+
+    HealthTracker   health_;
+    HealthTracker::State healthState_ {};
+    QTimer          healthTimer_;
+
+    // DBus queries. Declared in this order so the pool (and with it every
+    // thread's store) is gone before the storage.
+    QThreadStorage<EventStore *> readStores_;
+    QThreadPool     readPool_;
 };
 
 } // namespace kpulse
@@ -3,9 +3,50 @@
 #include <QStandardPaths>
 #include <QDir>
 #include <QDebug>
+#include <QSocketNotifier>
+
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
 
 #include "kpulse_daemon.hpp"
 
+namespace {
+
+int quitPipe[2] = {-1, -1};
+
+void handleQuitSignal(int)
+{
+    const char c = 1;
+    [[maybe_unused]] const ssize_t n = ::write(quitPipe[1], &c, 1);
+}
+
+// Turn SIGTERM/SIGINT into a normal event-loop exit so the daemon's
+// destructor gets to persist its journal cursor.
+void installQuitOnSignals(QCoreApplication &app)
+{
+    if (::pipe2(quitPipe, O_CLOEXEC | O_NONBLOCK) != 0) {
+        return;
+    }
+
+    auto *notifier = new QSocketNotifier(quitPipe[0], QSocketNotifier::Read, &app);
+    QObject::connect(notifier, &QSocketNotifier::activated, &app, []() {
+        char buf[16];
+        while (::read(quitPipe[0], buf, sizeof(buf)) > 0) {
+        }
+        QCoreApplication::quit();
+    });
+
+    struct sigaction sa {};
+    sa.sa_handler = handleQuitSignal;
+    sigemptyset(&sa.sa_mask);
+    sa.sa_flags = SA_RESTART;
+    sigaction(SIGTERM, &sa, nullptr);
+    sigaction(SIGINT, &sa, nullptr);
+}
+
+} // namespace
+
 int main(int argc, char *argv[])
 {
     QCoreApplication app(argc, argv);
@@ -24,8 +65,74 @@ int main(int argc, char *argv[])
     );
     parser.addOption(dbOpt);
 
+    QCommandLineOption journalOpt(
+        QStringList() << QStringLiteral("journal-backend"),
+        QStringLiteral("Journal reader backend: auto, native or journalctl."),
+        QStringLiteral("backend"),
+        QStringLiteral("auto")
+    );
+    parser.addOption(journalOpt);
+
+    QCommandLineOption dbProfileOpt(
+        QStringList() << QStringLiteral("db-profile"),
+        QStringLiteral("SQLite tuning profile: balanced, durable or compact."),
+        QStringLiteral("profile"),
+        QStringLiteral("balanced")
+    );
+    parser.addOption(dbProfileOpt);
+
+    QCommandLineOption vacuumOpt(
+        QStringList() << QStringLiteral("vacuum-db"),
+        QStringLiteral("Rewrite an older database once so retention can shrink it "
+                       "(slow on large files, needs free disk space of its size).")
+    );
+    parser.addOption(vacuumOpt);
+
+    QCommandLineOption retentionOpt(
+        QStringList() << QStringLiteral("retention-days"),
+        QStringLiteral("Days raw events are kept before being aggregated."),
+        QStringLiteral("days"),
+        QStringLiteral("14")
+    );
+    parser.addOption(retentionOpt);
+
+    QCommandLineOption broadcastWindowOpt(
+        QStringList() << QStringLiteral("broadcast-window-ms"),
+        QStringLiteral("Milliseconds new events are coalesced before being signalled."),
+        QStringLiteral("ms"),
+        QStringLiteral("200")
+    );
+    parser.addOption(broadcastWindowOpt);
+
+    QCommandLineOption broadcastMaxOpt(
+        QStringList() << QStringLiteral("broadcast-max-events"),
+        QStringLiteral("Signal early once this many new events are queued."),
+        QStringLiteral("count"),
+        QStringLiteral("1000")
+    );
+    parser.addOption(broadcastMaxOpt);
+
+    QCommandLineOption dedupWindowOpt(
+        QStringList() << QStringLiteral("dedup-window-ms"),
+        QStringLiteral("Identical events closer together than this are stored "
+                       "once with a repeat count (0 = off)."),
+        QStringLiteral("ms"),
+        QStringLiteral("60000")
+    );
+    parser.addOption(dedupWindowOpt);
+
+    QCommandLineOption rulesOpt(
+        QStringList() << QStringLiteral("rules"),
+        QStringLiteral("JSON file with journal classification rules and filters "
+                       "(default: rules.json in the config directory, if present)."),
+        QStringLiteral("path")
+    );
+    parser.addOption(rulesOpt);
+
     parser.process(app);
 
+    installQuitOnSignals(app);
+
     QString dbPath = parser.value(dbOpt);
     if (dbPath.isEmpty()) {
         QString dataDir =
@@ -37,7 +144,82 @@ int main(int argc, char *argv[])
         dbPath = dataDir + QStringLiteral("/events.sqlite");
     }
 
+    kpulse::JournaldReader::Backend backend = kpulse::JournaldReader::Backend::Auto;
+    if (!kpulse::JournaldReader::backendFromString(parser.value(journalOpt), backend)) {
+        qCritical() << "KPulse daemon: unknown journal backend" << parser.value(journalOpt);
+        return 1;
+    }
+
+    kpulse::StoreTuning tuning;
+    if (!kpulse::StoreTuning::fromProfile(parser.value(dbProfileOpt), tuning)) {
+        qCritical() << "KPulse daemon: unknown database profile" << parser.value(dbProfileOpt);
+        return 1;
+    }
+    tuning.vacuumOnOpen = parser.isSet(vacuumOpt);
+
+    bool retentionOk = false;
+    const int retentionDays = parser.value(retentionOpt).toInt(&retentionOk);
+    if (!retentionOk || retentionDays <= 0) {
+        qCritical() << "KPulse daemon: invalid retention" << parser.value(retentionOpt);
+        return 1;
+    }
+
+    kpulse::RetentionPolicy retention;
+    retention.rawRetentionMs = qint64(retentionDays) * 24 * 60 * 60 * 1000;
+    retention.minuteRetentionMs = qMax(retention.minuteRetentionMs,
+                                       retention.rawRetentionMs);
+
+    bool windowOk = false;
+    bool maxOk = false;
+    const int broadcastWindowMs = parser.value(broadcastWindowOpt).toInt(&windowOk);
+    const int broadcastMax = parser.value(broadcastMaxOpt).toInt(&maxOk);
+    if (!windowOk || broadcastWindowMs < 0 || !maxOk || broadcastMax <= 0) {
+        qCritical() << "KPulse daemon: invalid broadcast window"
+                    << parser.value(broadcastWindowOpt) << parser.value(broadcastMaxOpt);
+        return 1;
+    }
+
+    bool dedupOk = false;
+    const qint64 dedupWindowMs = parser.value(dedupWindowOpt).toLongLong(&dedupOk);
+    if (!dedupOk || dedupWindowMs < 0) {
+        qCritical() << "KPulse daemon: invalid dedup window" << parser.value(dedupWindowOpt);
+        return 1;
+    }
+
+    // An explicitly requested rules file must load; a broken default one
+    // only costs the custom rules and filters.
+    kpulse::RuleSet rules = kpulse::RuleSet::defaults();
+    kpulse::JournalFilter filter;
+    QString rulesPath = parser.value(rulesOpt);
+    const bool rulesExplicit = !rulesPath.isEmpty();
+    if (!rulesExplicit) {
+        rulesPath = QStandardPaths::locate(QStandardPaths::AppConfigLocation,
+                                           QStringLiteral("rules.json"));
+    }
+    if (!rulesPath.isEmpty()) {
+        QString rulesError;
+        if (rules.loadFile(rulesPath, &rulesError)
+            && filter.loadFile(rulesPath, &rulesError)) {
+            qInfo() << "KPulse daemon: loaded" << rules.size() << "rules and"
+                    << filter.size() << "filters from" << rulesPath;
+        } else if (rulesExplicit) {
+            qCritical() << "KPulse daemon: invalid rules:" << rulesError;
+            return 1;
+        } else {
+            qWarning() << "KPulse daemon: ignoring rules file:" << rulesError;
+            rules = kpulse::RuleSet::defaults();
+            filter = kpulse::JournalFilter();
+        }
+    }
+
     kpulse::KPulseDaemon daemon(dbPath);
+    daemon.setJournalBackend(backend);
+    daemon.setStoreTuning(tuning);
+    daemon.setRetentionPolicy(retention);
+    daemon.setBroadcastWindow(broadcastWindowMs, broadcastMax);
+    daemon.setDedupWindow(dedupWindowMs);
+    daemon.setRules(rules);
+    daemon.setJournalFilter(filter);
     if (!daemon.init()) {
         qCritical() << "KPulse daemon: failed to initialise, exiting";
         return 1;
@@ -1,11 +1,118 @@
 #include "metrics_collector.hpp"
 
+#include <QDateTime>
+#include <QDir>
 #include <QFile>
 #include <QJsonObject>
+#include <QTimeZone>
 #include <QtGlobal>
 
+#include <cerrno>
+#include <charconv>
+#include <string_view>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "daemon_metrics.hpp"
+
 namespace kpulse {
 
+namespace {
+
+// A condition that persists is reported again this often.
+constexpr qint64 kRepeatMs = 5 * 60 * 1000;
+
+// A raised condition clears only once the value drops below this share of
+// its warning threshold, so a value hovering at the threshold does not
+// produce an event every few seconds.
+constexpr double kClearRatio = 0.9;
+
+// 1-minute load average per online CPU.
+constexpr double kLoadWarnPerCpu = 1.5;
+constexpr double kLoadErrorPerCpu = 3.0;
+
+// Share of memory in use (MemTotal - MemAvailable), percent.
+constexpr double kMemoryWarnPercent = 90.0;
+constexpr double kMemoryErrorPercent = 95.0;
+
+// Temperatures without a sensor-provided critical limit.
+constexpr double kTempWarnC = 90.0;
+constexpr double kTempErrorC = 100.0;
+constexpr double kTempMarginC = 10.0;   // warn this far below a known limit
+
+constexpr std::size_t kMaxSensors = 32;
+
+int openRead(const QString &path)
+{
+    return ::open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+}
+
+void closeFd(int &fd)
+{
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+// Small sysfs attributes read once at start-up.
+QString readAttribute(const QString &path)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return QString();
+    }
+    return QString::fromUtf8(file.readAll()).trimmed();
+}
+
+void skipBlanks(std::string_view &s)
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) {
+        s.remove_prefix(1);
+    }
+}
+
+template <typename T>
+bool parseNumber(std::string_view &s, T &out)
+{
+    skipBlanks(s);
+    const auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), out);
+    if (ec != std::errc()) {
+        return false;
+    }
+    s.remove_prefix(static_cast<std::size_t>(end - s.data()));
+    return true;
+}
+
+// The number following `key` anywhere in text.
+template <typename T>
+bool numberAfter(std::string_view text, std::string_view key, T &out)
+{
+    const std::size_t pos = text.find(key);
+    if (pos == std::string_view::npos) {
+        return false;
+    }
+    text.remove_prefix(pos + key.size());
+    return parseNumber(text, out);
+}
+
+Severity levelFor(double value, double warn, double error, Severity current)
+{
+    if (value >= error) {
+        return Severity::Error;
+    }
+    if (value >= warn) {
+        return Severity::Warning;
+    }
+    if (current != Severity::Info && value >= warn * kClearRatio) {
+        return Severity::Warning;
+    }
+    return Severity::Info;
+}
+
+} // namespace
+
 MetricsCollector::MetricsCollector(QObject *parent)
     : QObject(parent)
 {
@@ -13,42 +120,359 @@ MetricsCollector::MetricsCollector(QObject *parent)
     connect(&timer_, &QTimer::timeout, this, &MetricsCollector::sample);
 }
 
+MetricsCollector::~MetricsCollector()
+{
+    closeSources();
+}
+
 void MetricsCollector::start(int intervalMs)
 {
-    timer_.start(intervalMs);
+    cpuCount_ = static_cast<int>(qMax(1L, ::sysconf(_SC_NPROCESSORS_ONLN)));
+    openSources();
+
+    // The first sample only primes the CPU counters.
+    sample();
+    timer_.start(qMax(100, intervalMs));
+}
+
+void MetricsCollector::stop()
+{
+    timer_.stop();
+    closeSources();
+}
+
+void MetricsCollector::openSources()
+{
+    closeSources();
+
+    loadFd_ = openRead(QStringLiteral("/proc/loadavg"));
+    statFd_ = openRead(QStringLiteral("/proc/stat"));
+    meminfoFd_ = openRead(QStringLiteral("/proc/meminfo"));
+
+    // Pressure stall information needs CONFIG_PSI; without it the
+    // conditions simply never fire.
+    pressureFds_[0] = openRead(QStringLiteral("/proc/pressure/cpu"));
+    pressureFds_[1] = openRead(QStringLiteral("/proc/pressure/memory"));
+    pressureFds_[2] = openRead(QStringLiteral("/proc/pressure/io"));
+
+    openThermalZones();
+    openHwmon();
+}
+
+void MetricsCollector::openThermalZones()
+{
+    const QDir dir(QStringLiteral("/sys/class/thermal"));
+    const QStringList zones = dir.entryList({QStringLiteral("thermal_zone*")},
+                                            QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &zone : zones) {
+        if (sensors_.size() >= kMaxSensors) {
+            return;
+        }
+
+        const QString base = dir.filePath(zone) + QLatin1Char('/');
+        Sensor sensor;
+        sensor.fd = openRead(base + QStringLiteral("temp"));
+        if (sensor.fd < 0) {
+            continue;
+        }
+        sensor.name = readAttribute(base + QStringLiteral("type"));
+        if (sensor.name.isEmpty()) {
+            sensor.name = zone;
+        }
+
+        // The "critical" trip point is where the kernel shuts down.
+        for (int i = 0; i < 16; ++i) {
+            const QString trip = base + QStringLiteral("trip_point_%1_").arg(i);
+            const QString type = readAttribute(trip + QStringLiteral("type"));
+            if (type.isEmpty()) {
+                break;
+            }
+            if (type == QLatin1String("critical")) {
+                sensor.critC = readAttribute(trip + QStringLiteral("temp")).toDouble() / 1000.0;
+                break;
+            }
+        }
+
+        sensors_.push_back(std::move(sensor));
+    }
+}
+
+void MetricsCollector::openHwmon()
+{
+    const QDir dir(QStringLiteral("/sys/class/hwmon"));
+    const QStringList chips = dir.entryList({QStringLiteral("hwmon*")},
+                                            QDir::Dirs | QDir::NoDotAndDotDot);
+    for (const QString &chip : chips) {
+        const QDir chipDir(dir.filePath(chip));
+        const QString chipName = readAttribute(chipDir.filePath(QStringLiteral("name")));
+
+        const QStringList inputs = chipDir.entryList({QStringLiteral("temp*_input")},
+                                                     QDir::Files);
+        for (const QString &input : inputs) {
+            if (sensors_.size() >= kMaxSensors) {
+                return;
+            }
+
+            Sensor sensor;
+            sensor.fd = openRead(chipDir.filePath(input));
+            if (sensor.fd < 0) {
+                continue;
+            }
+
+            const QString prefix = input.left(input.size() - int(qstrlen("_input")));
+            QString label = readAttribute(chipDir.filePath(prefix + QStringLiteral("_label")));
+            if (label.isEmpty()) {
+                label = prefix;
+            }
+            sensor.name = chipName.isEmpty() ? label : chipName + QLatin1Char(' ') + label;
+            sensor.critC = readAttribute(chipDir.filePath(prefix + QStringLiteral("_crit")))
+                               .toDouble() / 1000.0;
+
+            sensors_.push_back(std::move(sensor));
+        }
+    }
+}
+
+void MetricsCollector::closeSources()
+{
+    closeFd(loadFd_);
+    closeFd(statFd_);
+    closeFd(meminfoFd_);
+    for (int &fd : pressureFds_) {
+        closeFd(fd);
+    }
+    for (Sensor &sensor : sensors_) {
+        closeFd(sensor.fd);
+    }
+    sensors_.clear();
+}
+
+int MetricsCollector::readFd(int fd)
+{
+    if (fd < 0) {
+        return -1;
+    }
+
+    // procfs and sysfs regenerate the content for a read at offset 0, so
+    // the same fd serves every sample.
+    ssize_t n;
+    do {
+        n = ::pread(fd, buffer_.data(), buffer_.size(), 0);
+    } while (n < 0 && errno == EINTR);
+
+    return n < 0 ? -1 : static_cast<int>(n);
 }
 
 void MetricsCollector::sample()
 {
-    QFile file(QStringLiteral("/proc/loadavg"));
-    if (!file.open(QIODevice::ReadOnly | QIODevice::Text)) {
+    const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+
+    sampleLoad(nowMs);
+    sampleCpu();
+    sampleMemory(nowMs);
+    samplePressure(pressureFds_[0], CpuPressure, nowMs);
+    samplePressure(pressureFds_[1], MemoryPressure, nowMs);
+    samplePressure(pressureFds_[2], IoPressure, nowMs);
+    sampleTemperature(nowMs);
+}
+
+void MetricsCollector::sampleLoad(qint64 nowMs)
+{
+    const int n = readFd(loadFd_);
+    std::string_view text(buffer_.data(), n > 0 ? std::size_t(n) : 0);
+
+    double load = 0.0;
+    if (!parseNumber(text, load)) {
+        return;
+    }
+
+    if (metrics_) {
+        metrics_->set(QStringLiteral("system.load1"), load);
+    }
+
+    const double perCpu = load / cpuCount_;
+    update(Load, levelFor(perCpu, kLoadWarnPerCpu, kLoadErrorPerCpu, conditions_[Load].level),
+           nowMs, Category::Process, "High CPU load", [&](QJsonObject &details) {
+               details.insert(QStringLiteral("loadavg_1min"), load);
+               details.insert(QStringLiteral("cpus"), cpuCount_);
+           });
+}
+
+void MetricsCollector::sampleCpu()
+{
+    // First line: "cpu  user nice system idle iowait irq softirq steal ..."
+    // (guest time is already part of user/nice).
+    const int n = readFd(statFd_);
+    std::string_view text(buffer_.data(), n > 0 ? std::size_t(n) : 0);
+    if (text.substr(0, 4) != "cpu ") {
+        return;
+    }
+    text.remove_prefix(4);
+
+    quint64 fields[8] = {};
+    quint64 total = 0;
+    for (quint64 &field : fields) {
+        if (!parseNumber(text, field)) {
+            return;
+        }
+        total += field;
+    }
+    const quint64 idle = fields[3] + fields[4];
+
+    if (lastCpuTotal_ != 0 && total > lastCpuTotal_ && metrics_) {
+        const double busy = 1.0 - double(idle - lastCpuIdle_) / double(total - lastCpuTotal_);
+        metrics_->set(QStringLiteral("system.cpu_busy_percent"), qBound(0.0, busy, 1.0) * 100.0);
+    }
+    lastCpuTotal_ = total;
+    lastCpuIdle_ = idle;
+}
+
+void MetricsCollector::sampleMemory(qint64 nowMs)
+{
+    const int n = readFd(meminfoFd_);
+    const std::string_view text(buffer_.data(), n > 0 ? std::size_t(n) : 0);
+
+    quint64 totalKiB = 0;
+    quint64 availableKiB = 0;
+    if (!numberAfter(text, "MemTotal:", totalKiB) || totalKiB == 0 ||
+        !numberAfter(text, "MemAvailable:", availableKiB)) {
         return;
     }
 
-    const QByteArray line = file.readLine();
-    const QList<QByteArray> parts = line.split(' ');
-    if (parts.isEmpty()) {
+    const double usedPercent = 100.0 * (1.0 - double(availableKiB) / double(totalKiB));
+    if (metrics_) {
+        metrics_->set(QStringLiteral("system.memory_used_percent"), usedPercent);
+    }
+
+    update(Memory,
+           levelFor(usedPercent, kMemoryWarnPercent, kMemoryErrorPercent,
+                    conditions_[Memory].level),
+           nowMs, Category::System, "Low memory", [&](QJsonObject &details) {
+               details.insert(QStringLiteral("memory_used_percent"), usedPercent);
+               details.insert(QStringLiteral("mem_available_kib"), qint64(availableKiB));
+               details.insert(QStringLiteral("mem_total_kib"), qint64(totalKiB));
+           });
+}
+
+void MetricsCollector::samplePressure(int fd, Condition condition, qint64 nowMs)
+{
+    // "some avg10=1.23 avg60=0.50 avg300=0.10 total=12345"
+    const int n = readFd(fd);
+    const std::string_view text(buffer_.data(), n > 0 ? std::size_t(n) : 0);
+
+    double avg10 = 0.0;
+    if (!numberAfter(text, "some avg10=", avg10)) {
         return;
     }
 
-    bool ok = false;
-    const double load = parts.at(0).toDouble(&ok);
-    if (!ok) {
+    // Share of time some task was stalled, in percent.
+    double warn = 40.0;
+    double error = 80.0;
+    Category category = Category::System;
+    const char *label = "I/O pressure";
+    switch (condition) {
+    case CpuPressure:
+        category = Category::Process;
+        label = "CPU pressure";
+        if (metrics_) {
+            metrics_->set(QStringLiteral("system.psi.cpu_some_avg10"), avg10);
+        }
+        break;
+    case MemoryPressure:
+        warn = 20.0;
+        error = 50.0;
+        label = "Memory pressure";
+        if (metrics_) {
+            metrics_->set(QStringLiteral("system.psi.memory_some_avg10"), avg10);
+        }
+        break;
+    default:
+        if (metrics_) {
+            metrics_->set(QStringLiteral("system.psi.io_some_avg10"), avg10);
+        }
+        break;
+    }
+
+    update(condition, levelFor(avg10, warn, error, conditions_[condition].level),
+           nowMs, category, label, [&](QJsonObject &details) {
+               details.insert(QStringLiteral("pressure_some_avg10"), avg10);
+           });
+}
+
+void MetricsCollector::sampleTemperature(qint64 nowMs)
+{
+    const Severity current = conditions_[Temperature].level;
+
+    Severity worst = Severity::Info;
+    const Sensor *worstSensor = nullptr;
+    double worstC = 0.0;
+    double maxC = -1000.0;
+
+    for (const Sensor &sensor : sensors_) {
+        const int n = readFd(sensor.fd);
+        std::string_view text(buffer_.data(), n > 0 ? std::size_t(n) : 0);
+
+        qint64 milli = 0;
+        if (!parseNumber(text, milli)) {
+            continue;
+        }
+        const double c = milli / 1000.0;
+        if (c <= -50.0 || c >= 200.0) {
+            continue; // unconnected or bogus sensor
+        }
+        maxC = qMax(maxC, c);
+
+        const double warn = sensor.critC > 0.0 ? sensor.critC - kTempMarginC : kTempWarnC;
+        const double error = sensor.critC > 0.0 ? sensor.critC : kTempErrorC;
+        const Severity level = levelFor(c, warn, error, current);
+        if (!worstSensor || int(level) > int(worst) || (level == worst && c > worstC)) {
+            worst = level;
+            worstSensor = &sensor;
+            worstC = c;
+        }
+    }
+
+    if (!worstSensor) {
         return;
     }
+    if (metrics_) {
+        metrics_->set(QStringLiteral("system.temperature_max_c"), maxC);
+    }
+
+    update(Temperature, worst, nowMs, Category::Thermal, "High temperature",
+           [&](QJsonObject &details) {
+               details.insert(QStringLiteral("sensor"), worstSensor->name);
+               details.insert(QStringLiteral("temperature_c"), worstC);
+               if (worstSensor->critC > 0.0) {
+                   details.insert(QStringLiteral("critical_c"), worstSensor->critC);
+               }
+           });
+}
+
+template <typename DetailsFn>
+void MetricsCollector::update(Condition condition, Severity level, qint64 nowMs,
+                              Category category, const char *label,
+                              DetailsFn &&fillDetails)
+{
+    ConditionState &state = conditions_[condition];
 
-    if (load <= 4.0) {
+    const bool worse = int(level) > int(state.level);
+    const bool persists = level != Severity::Info && level == state.level &&
+                          nowMs - state.lastEmitMs >= kRepeatMs;
+    state.level = level;
+    if (!worse && !persists) {
         return;
     }
+    state.lastEmitMs = nowMs;
 
     Event event;
-    event.timestamp = QDateTime::currentDateTimeUtc();
-    event.category = Category::Process;
-    event.severity = Severity::Warning;
-    event.label = QStringLiteral("High CPU load");
+    event.timestamp = QDateTime::fromMSecsSinceEpoch(nowMs, QTimeZone::utc());
+    event.category = category;
+    event.severity = level;
+    event.label = QString::fromUtf8(label);
 
     QJsonObject details;
-    details.insert(QStringLiteral("loadavg_1min"), load);
+    fillDetails(details);
     event.details = details;
 
     emit eventDetected(event);
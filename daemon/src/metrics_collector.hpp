@@ -1,19 +1,39 @@
 #pragma once
 
 #include <QObject>
+#include <QString>
 #include <QTimer>
 
+#include <array>
+#include <vector>
+
 #include "kpulse/event.hpp"
 
 namespace kpulse {
 
+class DaemonMetrics;
+
+// Samples system state from /proc and /sys and raises events when it
+// crosses a threshold: CPU load (scaled by the number of online CPUs),
+// memory use, pressure stall information and temperatures.
+//
+// Built to run every second: all files are opened once in start() and
+// re-read with pread() into one reusable buffer, and parsing works on that
+// buffer in place, so a sample does no allocation and no path lookups.
+// Events are only emitted when a condition gets worse, or again after
+// kRepeatMs while it persists.
 class MetricsCollector : public QObject
 {
     Q_OBJECT
 public:
     explicit MetricsCollector(QObject *parent = nullptr);
+    ~MetricsCollector() override;
 
-    void start(int intervalMs = 5000);
+    // Where the sampled values are published as gauges. Optional.
+    void setMetrics(DaemonMetrics *metrics) { metrics_ = metrics; }
+
+    void start(int intervalMs = 1000);
+    void stop();
 
 signals:
     void eventDetected(const kpulse::Event &event);
@@ -22,7 +42,66 @@ private slots:
     void sample();
 
 private:
+    enum Condition {
+        Load,
+        Memory,
+        CpuPressure,
+        MemoryPressure,
+        IoPressure,
+        Temperature,
+        ConditionCount
+    };
+
+    struct ConditionState
+    {
+        Severity level = Severity::Info;
+        qint64 lastEmitMs = 0;
+    };
+
+    struct Sensor
+    {
+        int fd = -1;
+        QString name;       // e.g. "k10temp Tctl", read once at start()
+        double critC = 0.0; // 0 when the sensor reports no limit
+    };
+
+    void openSources();
+    void closeSources();
+    void openThermalZones();
+    void openHwmon();
+
+    // pread() the start of fd into buffer_. Returns the byte count, or -1.
+    int readFd(int fd);
+
+    void sampleLoad(qint64 nowMs);
+    void sampleCpu();
+    void sampleMemory(qint64 nowMs);
+    void samplePressure(int fd, Condition condition, qint64 nowMs);
+    void sampleTemperature(qint64 nowMs);
+
+    // Emit an event if `level` is worse than before, or repeats a warning
+    // that has lasted kRepeatMs. Info clears the condition. fillDetails
+    // (QJsonObject &) only runs when an event is actually emitted.
+    template <typename DetailsFn>
+    void update(Condition condition, Severity level, qint64 nowMs,
+                Category category, const char *label, DetailsFn &&fillDetails);
+
     QTimer timer_;
+    DaemonMetrics *metrics_ = nullptr;
+    int cpuCount_ = 1;
+
+    int loadFd_ = -1;
+    int statFd_ = -1;
+    int meminfoFd_ = -1;
+    std::array<int, 3> pressureFds_ {-1, -1, -1};   // cpu, memory, io
+    std::vector<Sensor> sensors_;
+
+    // Previous /proc/stat totals for the CPU busy percentage.
+    quint64 lastCpuTotal_ = 0;
+    quint64 lastCpuIdle_ = 0;
+
+    std::array<ConditionState, ConditionCount> conditions_ {};
+    std::array<char, 4096> buffer_ {};
 };
 
 } // namespace kpulse
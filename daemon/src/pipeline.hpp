@@ -0,0 +1,202 @@
+#pragma once
+
+#include <QByteArray>
+#include <QMutex>
+#include <QMutexLocker>
+#include <QString>
+#include <QWaitCondition>
+
+#include <deque>
+#include <functional>
+#include <vector>
+
+#include "kpulse/event.hpp"
+
+namespace kpulse {
+
+// Ingestion runs as a pipeline of threads:
+//
+//   JournaldReader  --JournalBatch-->  EventClassifier  --EventBatch-->  EventWriter
+//   (reader thread)                    (classifier thread)               (writer thread)
+//
+// Stages are connected by BoundedQueues. A full queue blocks the producer,
+// so a slow disk ends up throttling journal reading instead of growing
+// memory without bound.
+
+// The handful of journal fields KPulse looks at. Both reader backends
+// decode into this so classification does not care where an entry came
+// from.
+struct JournalEntry
+{
+    QString message;
+    int     priority = 5;
+    QString unit;
+    QString identifier;
+    QString cursor;     // journalctl backend only; sd-journal asks lazily
+
+    // __REALTIME_TIMESTAMP / __MONOTONIC_TIMESTAMP, 0 when unknown.
+    quint64 realtimeUs  = 0;
+    quint64 monotonicUs = 0;
+
+    // _BOOT_ID as 32 hex digits, empty when unknown. Monotonic times are
+    // only comparable between entries of the same boot.
+    QByteArray bootId;
+};
+
+// One drain of the journal. cursor is the journal position after the last
+// entry; it is persisted once the batch's events are stored, so a restart
+// never skips entries that did not make it to disk.
+struct JournalBatch
+{
+    std::vector<JournalEntry> entries;
+    QString cursor;
+};
+
+struct EventBatch
+{
+    std::vector<Event> events;
+    QString cursor;     // empty for events not read from the journal
+};
+
+// Fixed-capacity FIFO handing work from one thread to another.
+//
+// push() blocks while the queue is full; tryPush() drops the item instead.
+// The consumer is woken through the callback given to setNotify(), which
+// runs on the producer's thread each time the queue goes from empty to
+// non-empty; it typically posts a queued call to the consumer's drain slot.
+template <typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(std::size_t capacity)
+        : capacity_(capacity > 0 ? capacity : 1)
+    {
+    }
+
+    BoundedQueue(const BoundedQueue &) = delete;
+    BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+    void setNotify(std::function<void()> notify) { notify_ = std::move(notify); }
+
+    // Returns false if the queue was closed (the item is dropped).
+    bool push(T item)
+    {
+        bool wake = false;
+        {
+            QMutexLocker locker(&mutex_);
+            if (items_.size() >= capacity_ && !closed_) {
+                ++blockedPushes_;
+                while (items_.size() >= capacity_ && !closed_) {
+                    notFull_.wait(&mutex_);
+                }
+            }
+            if (closed_) {
+                return false;
+            }
+            wake = items_.empty();
+            items_.push_back(std::move(item));
+            highWater_ = qMax(highWater_, items_.size());
+        }
+
+        if (wake && notify_) {
+            notify_();
+        }
+        return true;
+    }
+
+    // Like push(), but for producers that must never wait (the main
+    // thread): returns false and drops the item if the queue is full or
+    // closed.
+    bool tryPush(T item)
+    {
+        bool wake = false;
+        {
+            QMutexLocker locker(&mutex_);
+            if (closed_) {
+                return false;
+            }
+            if (items_.size() >= capacity_) {
+                ++droppedPushes_;
+                return false;
+            }
+            wake = items_.empty();
+            items_.push_back(std::move(item));
+            highWater_ = qMax(highWater_, items_.size());
+        }
+
+        if (wake && notify_) {
+            notify_();
+        }
+        return true;
+    }
+
+    // Take up to max items (0 = all) without blocking.
+    std::vector<T> pop(std::size_t max = 0)
+    {
+        std::vector<T> out;
+        QMutexLocker locker(&mutex_);
+        const std::size_t n = (max == 0 || max > items_.size()) ? items_.size() : max;
+        out.reserve(n);
+        for (std::size_t i = 0; i < n; ++i) {
+            out.push_back(std::move(items_.front()));
+            items_.pop_front();
+        }
+        if (n > 0) {
+            notFull_.wakeAll();
+        }
+        return out;
+    }
+
+    // Wake blocked producers and refuse further items.
+    void close()
+    {
+        QMutexLocker locker(&mutex_);
+        closed_ = true;
+        notFull_.wakeAll();
+    }
+
+    std::size_t capacity() const { return capacity_; }
+
+    std::size_t size() const
+    {
+        QMutexLocker locker(&mutex_);
+        return items_.size();
+    }
+
+    // Largest depth seen since the last call.
+    std::size_t takeHighWater()
+    {
+        QMutexLocker locker(&mutex_);
+        const std::size_t hw = highWater_;
+        highWater_ = items_.size();
+        return hw;
+    }
+
+    // Number of pushes that had to wait for space.
+    quint64 blockedPushes() const
+    {
+        QMutexLocker locker(&mutex_);
+        return blockedPushes_;
+    }
+
+    // Number of tryPush() items dropped because the queue was full.
+    quint64 droppedPushes() const
+    {
+        QMutexLocker locker(&mutex_);
+        return droppedPushes_;
+    }
+
+private:
+    const std::size_t capacity_;
+    std::function<void()> notify_;
+
+    mutable QMutex mutex_;
+    QWaitCondition notFull_;
+    std::deque<T> items_;
+    std::size_t highWater_ = 0;
+    quint64 blockedPushes_ = 0;
+    quint64 droppedPushes_ = 0;
+    bool closed_ = false;
+};
+
+} // namespace kpulse
@@ -0,0 +1,424 @@
+#include "rule_engine.hpp"
+
+#include <QDebug>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+
+#include <deque>
+
+namespace kpulse {
+
+namespace {
+
+// Built-in rules. Order matters: the first matching rule wins.
+constexpr const char *kDefaultRules = R"json({
+  "rules": [
+    {
+      "name": "kioworker-appimage-thumbnails",
+      "identifier": ["kioworker"],
+      "match": ["thumbcreator/appimagethumbnail.so"],
+      "action": "drop"
+    },
+    {
+      "name": "http-429",
+      "match": ["httperror", ["429 client error", "too many requests"]],
+      "category": "network", "severity": "warning",
+      "label": "HTTP 429 (rate limited)"
+    },
+    {
+      "name": "gpu-hang",
+      "match": [["gpu", "amdgpu", "nvidia"], ["hang", "reset", "fault", "timeout"]],
+      "category": "gpu", "severity": "error",
+      "label": "GPU hang/reset"
+    },
+    {
+      "name": "thermal-throttling",
+      "match": [["thermal", "throttle", "temperature above threshold"]],
+      "category": "thermal", "severity": "warning",
+      "label": "Thermal throttling"
+    },
+    {
+      "name": "oom",
+      "match": [["oom-killer", "out of memory"]],
+      "category": "system", "severity": "critical",
+      "label": "Out-of-memory condition"
+    },
+    {
+      "name": "soft-lockup",
+      "match": ["soft lockup"],
+      "category": "system", "severity": "error",
+      "label": "CPU soft lockup"
+    },
+    {
+      "name": "systemd-resource-usage",
+      "match": ["consumed", "cpu time over", "memory peak"],
+      "regex": "Consumed\\s+([0-9\\.]+)s CPU time over\\s+([0-9\\.]+)s wall clock time,\\s+([0-9\\.]+)M memory peak\\.",
+      "captureMin": {"1": 5.0, "3": 1024.0},
+      "category": "process", "severity": "warning",
+      "label": "High resource usage (systemd)"
+    },
+    {
+      "name": "systemd-resource-usage-below-threshold",
+      "match": ["consumed", "cpu time over", "memory peak"],
+      "regex": "Consumed\\s+([0-9\\.]+)s CPU time over\\s+([0-9\\.]+)s wall clock time,\\s+([0-9\\.]+)M memory peak\\.",
+      "action": "drop"
+    }
+  ]
+})json";
+
+bool isAscii(const QString &s)
+{
+    for (QChar c : s) {
+        if (c.unicode() >= 128) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool parseCategory(const QString &name, Category &out)
+{
+    out = categoryFromString(name);
+    return categoryToString(out) == name.trimmed().toLower();
+}
+
+bool parseSeverity(const QString &name, Severity &out)
+{
+    out = severityFromString(name);
+    return severityToString(out) == name.trimmed().toLower();
+}
+
+QStringList stringList(const QJsonValue &value)
+{
+    QStringList out;
+    if (value.isString()) {
+        out << value.toString();
+    }
+    for (const QJsonValue &v : value.toArray()) {
+        out << v.toString();
+    }
+    out.removeAll(QString());
+    return out;
+}
+
+} // namespace
+
+RuleSet RuleSet::defaults()
+{
+    RuleSet set;
+    QString error;
+    if (!set.loadJson(QByteArray(kDefaultRules), &error)) {
+        qWarning() << "RuleSet: built-in rules are invalid:" << error;
+    }
+    return set;
+}
+
+bool RuleSet::loadFile(const QString &path, QString *error)
+{
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        if (error) {
+            *error = QStringLiteral("%1: %2").arg(path, file.errorString());
+        }
+        return false;
+    }
+
+    QString parseError;
+    if (!loadJson(file.readAll(), &parseError)) {
+        if (error) {
+            *error = QStringLiteral("%1: %2").arg(path, parseError);
+        }
+        return false;
+    }
+    return true;
+}
+
+bool RuleSet::loadJson(const QByteArray &json, QString *error)
+{
+    QJsonParseError err{};
+    const QJsonDocument doc = QJsonDocument::fromJson(json, &err);
+    if (err.error != QJsonParseError::NoError || !doc.isObject()) {
+        if (error) {
+            *error = err.error != QJsonParseError::NoError
+                ? err.errorString()
+                : QStringLiteral("top level is not an object");
+        }
+        return false;
+    }
+
+    // The file may only carry other sections (see JournalFilter).
+    if (!doc.object().contains(QStringLiteral("rules"))) {
+        return true;
+    }
+
+    std::vector<Rule> rules;
+    QHash<QString, int> patternIds;
+    QStringList patterns;
+
+    const QJsonArray array = doc.object().value(QStringLiteral("rules")).toArray();
+    for (int i = 0; i < array.size(); ++i) {
+        Rule rule;
+        QString ruleError;
+        if (!parseRule(array.at(i).toObject(), rule, patternIds, patterns, &ruleError)) {
+            if (error) {
+                *error = QStringLiteral("rule %1: %2").arg(i).arg(ruleError);
+            }
+            return false;
+        }
+        rules.push_back(std::move(rule));
+    }
+
+    rules_ = std::move(rules);
+    compile(patterns);
+    return true;
+}
+
+bool RuleSet::parseRule(const QJsonObject &obj,
+                        Rule &rule,
+                        QHash<QString, int> &patternIds,
+                        QStringList &patterns,
+                        QString *error) const
+{
+    rule.result.ruleName = obj.value(QStringLiteral("name")).toString();
+
+    for (const QJsonValue &group : obj.value(QStringLiteral("match")).toArray()) {
+        std::vector<int> ids;
+        for (const QString &pattern : stringList(group)) {
+            const QString folded = pattern.toLower();
+            auto it = patternIds.constFind(folded);
+            if (it == patternIds.constEnd()) {
+                it = patternIds.insert(folded, patterns.size());
+                patterns << folded;
+            }
+            ids.push_back(it.value());
+        }
+        if (ids.empty()) {
+            *error = QStringLiteral("empty entry in \"match\"");
+            return false;
+        }
+        rule.groups.push_back(std::move(ids));
+    }
+
+    rule.identifiers = stringList(obj.value(QStringLiteral("identifier")));
+    rule.units = stringList(obj.value(QStringLiteral("unit")));
+
+    const QString regex = obj.value(QStringLiteral("regex")).toString();
+    if (!regex.isEmpty()) {
+        rule.regex = QRegularExpression(regex, QRegularExpression::CaseInsensitiveOption);
+        if (!rule.regex.isValid()) {
+            *error = QStringLiteral("invalid regex: %1").arg(rule.regex.errorString());
+            return false;
+        }
+        rule.regex.optimize();
+
+        const QJsonObject mins = obj.value(QStringLiteral("captureMin")).toObject();
+        for (auto it = mins.constBegin(); it != mins.constEnd(); ++it) {
+            bool ok = false;
+            const int capture = it.key().toInt(&ok);
+            if (!ok || capture < 1 || capture > rule.regex.captureCount()) {
+                *error = QStringLiteral("captureMin refers to missing group %1").arg(it.key());
+                return false;
+            }
+            rule.captureMin.emplace_back(capture, it.value().toDouble());
+        }
+    }
+
+    if (rule.groups.empty() && rule.identifiers.isEmpty() && rule.units.isEmpty()
+        && regex.isEmpty()) {
+        *error = QStringLiteral("rule has no matchers");
+        return false;
+    }
+
+    const QString action = obj.value(QStringLiteral("action")).toString(QStringLiteral("classify"));
+    if (action == QLatin1String("drop")) {
+        rule.result.drop = true;
+        return true;
+    }
+    if (action != QLatin1String("classify")) {
+        *error = QStringLiteral("unknown action \"%1\"").arg(action);
+        return false;
+    }
+
+    if (!parseCategory(obj.value(QStringLiteral("category")).toString(), rule.result.category)) {
+        *error = QStringLiteral("unknown category");
+        return false;
+    }
+
+    if (obj.contains(QStringLiteral("severity"))) {
+        Severity sev = Severity::Info;
+        if (!parseSeverity(obj.value(QStringLiteral("severity")).toString(), sev)) {
+            *error = QStringLiteral("unknown severity");
+            return false;
+        }
+        rule.result.severity = sev;
+    }
+
+    rule.result.label = obj.value(QStringLiteral("label")).toString();
+    if (rule.result.label.isEmpty()) {
+        *error = QStringLiteral("missing label");
+        return false;
+    }
+    return true;
+}
+
+void RuleSet::compile(const QStringList &patterns)
+{
+    nodes_.clear();
+    slowPatterns_.clear();
+    patternCount_ = static_cast<int>(patterns.size());
+
+    nodes_.emplace_back();
+    nodes_[0].next.fill(-1);
+
+    // Trie of all ASCII patterns.
+    for (int id = 0; id < patternCount_; ++id) {
+        const QString &pattern = patterns.at(id);
+        if (pattern.isEmpty() || !isAscii(pattern)) {
+            slowPatterns_.emplace_back(id, pattern);
+            continue;
+        }
+
+        int state = 0;
+        for (QChar c : pattern) {
+            const int u = c.unicode();
+            if (nodes_[state].next[u] < 0) {
+                const int created = static_cast<int>(nodes_.size());
+                nodes_.emplace_back();
+                nodes_.back().next.fill(-1);
+                nodes_[state].next[u] = created;
+            }
+            state = nodes_[state].next[u];
+        }
+        nodes_[state].outputs.push_back(id);
+    }
+
+    // Breadth-first: set failure links and turn missing edges into the
+    // edges of the failure state, so scanning needs one lookup per char.
+    std::deque<int> queue;
+    for (int u = 0; u < 128; ++u) {
+        const int s = nodes_[0].next[u];
+        if (s < 0) {
+            nodes_[0].next[u] = 0;
+        } else {
+            nodes_[s].fail = 0;
+            queue.push_back(s);
+        }
+    }
+
+    while (!queue.empty()) {
+        const int r = queue.front();
+        queue.pop_front();
+
+        for (int u = 0; u < 128; ++u) {
+            const int s = nodes_[r].next[u];
+            const int viaFail = nodes_[nodes_[r].fail].next[u];
+            if (s < 0) {
+                nodes_[r].next[u] = viaFail;
+                continue;
+            }
+            nodes_[s].fail = viaFail;
+            const std::vector<int> &inherited = nodes_[viaFail].outputs;
+            nodes_[s].outputs.insert(nodes_[s].outputs.end(),
+                                     inherited.begin(), inherited.end());
+            queue.push_back(s);
+        }
+    }
+}
+
+void RuleSet::scan(const QString &text, std::vector<char> &hits) const
+{
+    // ASCII is folded on the fly, so the message is never copied.
+    int state = 0;
+    for (QChar c : text) {
+        int u = c.unicode();
+        if (u >= 128) {
+            state = 0;
+            continue;
+        }
+        if (u >= 'A' && u <= 'Z') {
+            u += 'a' - 'A';
+        }
+        state = nodes_[state].next[u];
+        for (int id : nodes_[state].outputs) {
+            hits[id] = 1;
+        }
+    }
+
+    for (const auto &[id, pattern] : slowPatterns_) {
+        if (!pattern.isEmpty() && text.contains(pattern, Qt::CaseInsensitive)) {
+            hits[id] = 1;
+        }
+    }
+}
+
+bool RuleSet::regexMatches(const Rule &rule, const QString &message)
+{
+    const QRegularExpressionMatch m = rule.regex.match(message);
+    if (!m.hasMatch()) {
+        return false;
+    }
+    if (rule.captureMin.empty()) {
+        return true;
+    }
+
+    for (const auto &[capture, minimum] : rule.captureMin) {
+        if (m.captured(capture).toDouble() >= minimum) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool RuleSet::match(const JournalEntry &entry, RuleMatch &out) const
+{
+    // Runs for every journal entry, so the buffer is kept between calls
+    // instead of being allocated each time; one per thread, as a RuleSet
+    // may be matched from several.
+    thread_local std::vector<char> hits;
+    hits.assign(static_cast<std::size_t>(patternCount_), 0);
+    if (patternCount_ > 0) {
+        scan(entry.message, hits);
+    }
+
+    for (const Rule &rule : rules_) {
+        bool ok = true;
+        for (const std::vector<int> &group : rule.groups) {
+            bool any = false;
+            for (int id : group) {
+                if (hits[id]) {
+                    any = true;
+                    break;
+                }
+            }
+            if (!any) {
+                ok = false;
+                break;
+            }
+        }
+        if (!ok) {
+            continue;
+        }
+
+        if (!rule.identifiers.isEmpty()
+            && !rule.identifiers.contains(entry.identifier, Qt::CaseInsensitive)) {
+            continue;
+        }
+        if (!rule.units.isEmpty()
+            && !rule.units.contains(entry.unit, Qt::CaseInsensitive)) {
+            continue;
+        }
+
+        // Checked last: the substring groups usually rule the entry out
+        // before the regex has to run.
+        if (!rule.regex.pattern().isEmpty() && !regexMatches(rule, entry.message)) {
+            continue;
+        }
+
+        out = rule.result;
+        return true;
+    }
+    return false;
+}
+
+} // namespace kpulse
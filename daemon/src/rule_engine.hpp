@@ -0,0 +1,105 @@
+#pragma once
+
+#include <QByteArray>
+#include <QHash>
+#include <QJsonObject>
+#include <QRegularExpression>
+#include <QString>
+#include <QStringList>
+
+#include <array>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "kpulse/event.hpp"
+
+#include "pipeline.hpp"
+
+namespace kpulse {
+
+// Outcome of the first rule that matched a journal entry.
+struct RuleMatch
+{
+    QString  ruleName;
+    bool     drop = false;              // entry is noise, produce no event
+    Category category = Category::System;
+    std::optional<Severity> severity;   // unset: derive from PRIORITY
+    QString  label;
+};
+
+// Data-driven journal classification rules.
+//
+// Rules are read from JSON:
+//
+//   {"rules": [
+//     {"name": "gpu-hang",
+//      "match": [["gpu", "amdgpu", "nvidia"], ["hang", "reset", "timeout"]],
+//      "category": "gpu", "severity": "error", "label": "GPU hang/reset"},
+//     ...]}
+//
+// A rule matches when every element of "match" is found in MESSAGE
+// (case-insensitive substring; an inner array means any of them), when
+// "identifier"/"unit" (if given) contain the entry's SYSLOG_IDENTIFIER /
+// _SYSTEMD_UNIT, and when "regex" (if given) matches. "captureMin" maps
+// regex capture numbers to thresholds; the rule then only matches if at
+// least one captured number reaches its threshold. "action": "drop" turns
+// matching entries into noise. Rules are tried in order; the first match
+// wins.
+//
+// All substrings of all rules are compiled into one Aho-Corasick
+// automaton, so a message is scanned once no matter how many rules exist.
+class RuleSet
+{
+public:
+    // The built-in rules, used when no rules file is configured.
+    static RuleSet defaults();
+
+    // Replace the rules with those in json; without a "rules" section the
+    // set is kept. On error the set is left unchanged and error (if given)
+    // describes the problem.
+    bool loadJson(const QByteArray &json, QString *error = nullptr);
+    bool loadFile(const QString &path, QString *error = nullptr);
+
+    int size() const { return static_cast<int>(rules_.size()); }
+
+    bool match(const JournalEntry &entry, RuleMatch &out) const;
+
+private:
+    struct Rule
+    {
+        RuleMatch result;
+
+        // Pattern ids; each group needs at least one hit.
+        std::vector<std::vector<int>> groups;
+        QStringList identifiers;     // compared case-insensitively, empty = any
+        QStringList units;
+        QRegularExpression regex;
+        std::vector<std::pair<int, double>> captureMin;
+    };
+
+    // Aho-Corasick automaton over case-folded ASCII. Patterns with other
+    // characters are rare and checked with QString::contains() instead.
+    struct Node
+    {
+        std::array<int, 128> next;
+        int fail = 0;
+        std::vector<int> outputs;
+    };
+
+    bool parseRule(const QJsonObject &obj,
+                   Rule &rule,
+                   QHash<QString, int> &patternIds,
+                   QStringList &patterns,
+                   QString *error) const;
+    void compile(const QStringList &patterns);
+    void scan(const QString &text, std::vector<char> &hits) const;
+    static bool regexMatches(const Rule &rule, const QString &message);
+
+    std::vector<Rule> rules_;
+    std::vector<Node> nodes_;
+    int patternCount_ = 0;
+    std::vector<std::pair<int, QString>> slowPatterns_;
+};
+
+} // namespace kpulse
@@ -0,0 +1,179 @@
+#include <QFile>
+#include <QProcess>
+#include <QStandardPaths>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <systemd/sd-journal.h>
+
+#include "journal_corpus.hpp"
+#include "journald_reader.hpp"
+#include "pipeline.hpp"
+
+using namespace kpulse;
+
+namespace {
+
+// Copies of the sample corpus in the generated journal (58 entries each).
+constexpr int kCorpusCopies = 200;
+constexpr int kCorpusCopiesLarge = 5000;
+
+constexpr int kReadTimeoutMs = 120 * 1000;
+
+QString journalRemote()
+{
+    for (const char *path : {"/usr/lib/systemd/systemd-journal-remote",
+                             "/lib/systemd/systemd-journal-remote"}) {
+        if (QFile::exists(QString::fromLatin1(path))) {
+            return QString::fromLatin1(path);
+        }
+    }
+    return QStandardPaths::findExecutable(QStringLiteral("systemd-journal-remote"));
+}
+
+// Journal export format: FIELD=value lines, a blank line after each entry.
+QByteArray exportCorpus(const QList<QJsonObject> &corpus, int copies)
+{
+    const QByteArray bootId("0123456789abcdef0123456789abcdef");
+    const quint64 startUs = 1'700'000'000'000'000ULL;
+
+    QByteArray out;
+    quint64 n = 0;
+    for (int copy = 0; copy < copies; ++copy) {
+        for (const QJsonObject &entry : corpus) {
+            out += "__REALTIME_TIMESTAMP=" + QByteArray::number(startUs + n * 1000) + '\n';
+            out += "__MONOTONIC_TIMESTAMP=" + QByteArray::number(1'000'000 + n * 1000) + '\n';
+            out += "_BOOT_ID=" + bootId + '\n';
+            for (auto it = entry.constBegin(); it != entry.constEnd(); ++it) {
+                // Multi-line values would need the binary field encoding.
+                const QByteArray value = it.value().toString().toUtf8().replace('\n', ' ');
+                out += it.key().toUtf8() + '=' + value + '\n';
+            }
+            out += '\n';
+            ++n;
+        }
+    }
+    return out;
+}
+
+qint64 countEntries(const QString &path)
+{
+    sd_journal *j = nullptr;
+    const QByteArray encoded = QFile::encodeName(path);
+    const char *paths[] = {encoded.constData(), nullptr};
+    if (sd_journal_open_files(&j, paths, 0) < 0) {
+        return -1;
+    }
+
+    qint64 n = 0;
+    SD_JOURNAL_FOREACH(j) {
+        ++n;
+    }
+    sd_journal_close(j);
+    return n;
+}
+
+} // namespace
+
+// Reads a whole journal file with each JournaldReader backend. The file is
+// $KPULSE_BENCH_JOURNAL if set (e.g. a copy of a system journal), otherwise
+// one generated from data/journal_sample.json with systemd-journal-remote.
+class BenchJournalBackends : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void readAll_data();
+    void readAll();
+
+private:
+    // Entries delivered by a reader that read journalFile_ to the end.
+    qint64 readJournal(JournaldReader::Backend backend);
+
+    QTemporaryDir dir_;
+    QString journalFile_;
+    qint64 entries_ = 0;
+};
+
+void BenchJournalBackends::initTestCase()
+{
+    journalFile_ = qEnvironmentVariable("KPULSE_BENCH_JOURNAL");
+    if (journalFile_.isEmpty()) {
+        const QString remote = journalRemote();
+        if (remote.isEmpty()) {
+            QSKIP("systemd-journal-remote not found and KPULSE_BENCH_JOURNAL not set");
+        }
+
+        const QList<QJsonObject> corpus =
+            readJournalCorpus(QFINDTESTDATA("data/journal_sample.json"));
+        QVERIFY(!corpus.isEmpty());
+
+        QVERIFY(dir_.isValid());
+        journalFile_ = dir_.filePath(QStringLiteral("sample.journal"));
+
+        QProcess process;
+        process.start(remote, {QStringLiteral("--split-mode=none"),
+                               QStringLiteral("--output=%1").arg(journalFile_),
+                               QStringLiteral("-")});
+        QVERIFY(process.waitForStarted());
+        const int copies = qEnvironmentVariableIsSet("KPULSE_BENCH_LARGE")
+            ? kCorpusCopiesLarge : kCorpusCopies;
+        process.write(exportCorpus(corpus, copies));
+        process.closeWriteChannel();
+        QVERIFY(process.waitForFinished(kReadTimeoutMs));
+        QCOMPARE(process.exitCode(), 0);
+    }
+
+    entries_ = countEntries(journalFile_);
+    QVERIFY2(entries_ > 0, qPrintable(journalFile_));
+    qInfo() << "Reading" << entries_ << "entries from" << journalFile_;
+}
+
+qint64 BenchJournalBackends::readJournal(JournaldReader::Backend backend)
+{
+    BoundedQueue<JournalBatch> queue(64);
+    qint64 received = 0;
+    queue.setNotify([&]() {
+        for (const JournalBatch &batch : queue.pop()) {
+            received += qint64(batch.entries.size());
+        }
+    });
+
+    JournaldReader reader;
+    reader.setBackend(backend);
+    reader.setJournalFiles({journalFile_});
+    reader.setOutput(&queue);
+    reader.setCatchUpThrottle(500, 0);   // measure parsing, not pacing
+    if (!reader.start()) {
+        return -1;
+    }
+
+    QTest::qWaitFor([&]() { return received >= entries_; }, kReadTimeoutMs);
+    reader.stop();
+    return received;
+}
+
+void BenchJournalBackends::readAll_data()
+{
+    QTest::addColumn<int>("backend");
+    QTest::newRow("sd-journal") << int(JournaldReader::Backend::Native);
+    QTest::newRow("journalctl") << int(JournaldReader::Backend::Journalctl);
+}
+
+void BenchJournalBackends::readAll()
+{
+    QFETCH(int, backend);
+    const auto b = static_cast<JournaldReader::Backend>(backend);
+    if (b == JournaldReader::Backend::Journalctl
+        && QStandardPaths::findExecutable(QStringLiteral("journalctl")).isEmpty()) {
+        QSKIP("journalctl not installed");
+    }
+
+    QBENCHMARK {
+        QCOMPARE(readJournal(b), entries_);
+    }
+}
+
+QTEST_GUILESS_MAIN(BenchJournalBackends)
+
+#include "bench_journal_backends.moc"
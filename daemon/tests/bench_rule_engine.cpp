@@ -0,0 +1,96 @@
+#include <QElapsedTimer>
+#include <QTest>
+
+#include <vector>
+
+#include "journal_corpus.hpp"
+#include "legacy_classifier.hpp"
+#include "rule_engine.hpp"
+
+using namespace kpulse;
+
+namespace {
+
+// Copies of the sample corpus classified per benchmark iteration.
+constexpr int kCorpusCopies = 100;
+constexpr int kCorpusCopiesLarge = 5000;
+
+enum class Classifier { Rules, Legacy };
+
+// The decision EventClassifier::classifyEntry() makes with a RuleSet.
+bool keptByRules(const RuleSet &rules, const JournalEntry &entry)
+{
+    RuleMatch match;
+    if (rules.match(entry, match)) {
+        return !match.drop;
+    }
+    return entry.priority <= 4;
+}
+
+} // namespace
+
+// Entries/s through RuleSet::defaults() and through the hard-coded
+// classifier it replaced, over the sample of real journal lines.
+class BenchRuleEngine : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void classify_data();
+    void classify();
+
+private:
+    std::vector<JournalEntry> entries_;
+};
+
+void BenchRuleEngine::initTestCase()
+{
+    const QList<QJsonObject> corpus = readJournalCorpus(QFINDTESTDATA("data/journal_sample.json"));
+    QVERIFY(!corpus.isEmpty());
+
+    const int copies = qEnvironmentVariableIsSet("KPULSE_BENCH_LARGE")
+        ? kCorpusCopiesLarge : kCorpusCopies;
+    entries_.reserve(std::size_t(corpus.size()) * copies);
+    for (int copy = 0; copy < copies; ++copy) {
+        for (const QJsonObject &obj : corpus) {
+            entries_.push_back(journalEntryFromJson(obj));
+        }
+    }
+}
+
+void BenchRuleEngine::classify_data()
+{
+    QTest::addColumn<int>("classifier");
+    QTest::newRow("rules") << int(Classifier::Rules);
+    QTest::newRow("legacy") << int(Classifier::Legacy);
+}
+
+void BenchRuleEngine::classify()
+{
+    QFETCH(int, classifier);
+    const RuleSet rules = RuleSet::defaults();
+
+    qint64 classified = 0;
+    int kept = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QBENCHMARK {
+        kept = 0;
+        for (const JournalEntry &entry : entries_) {
+            if (Classifier(classifier) == Classifier::Rules) {
+                kept += keptByRules(rules, entry);
+            } else {
+                kept += !legacy::classify(entry).dropped;
+            }
+        }
+        classified += qint64(entries_.size());
+    }
+    QVERIFY(kept > 0);
+    qInfo("%s: %.0f entries/s, %d of %zu kept", QTest::currentDataTag(),
+          double(classified) * 1000.0 / qMax<qint64>(1, timer.elapsed()),
+          kept, entries_.size());
+}
+
+QTEST_GUILESS_MAIN(BenchRuleEngine)
+
+#include "bench_rule_engine.moc"
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QList>
+#include <QString>
+
+#include "pipeline.hpp"
+
+// data/journal_sample.json: journal entries as `journalctl -o json` prints
+// them, one per line, without the timestamp and cursor fields. Shared by
+// the tests and benchmarks that need realistic journal traffic.
+inline QList<QJsonObject> readJournalCorpus(const QString &path)
+{
+    QList<QJsonObject> entries;
+
+    QFile file(path);
+    if (!file.open(QIODevice::ReadOnly)) {
+        return entries;
+    }
+    while (!file.atEnd()) {
+        const QJsonDocument doc = QJsonDocument::fromJson(file.readLine());
+        if (doc.isObject()) {
+            entries.push_back(doc.object());
+        }
+    }
+    return entries;
+}
+
+// The fields of a corpus entry the daemon reads, as a reader backend
+// would decode them.
+inline kpulse::JournalEntry journalEntryFromJson(const QJsonObject &obj)
+{
+    kpulse::JournalEntry entry;
+    entry.message = obj.value(QStringLiteral("MESSAGE")).toString();
+    entry.priority = obj.value(QStringLiteral("PRIORITY")).toString().toInt();
+    entry.identifier = obj.value(QStringLiteral("SYSLOG_IDENTIFIER")).toString();
+    entry.unit = obj.value(QStringLiteral("_SYSTEMD_UNIT")).toString();
+    return entry;
+}
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <QRegularExpression>
+#include <QString>
+
+#include "kpulse/event.hpp"
+
+#include "pipeline.hpp"
+
+// The hard-coded classifier that RuleSet::defaults() replaced, kept
+// verbatim as the reference for the equivalence test and the benchmark.
+namespace legacy {
+
+using kpulse::Category;
+using kpulse::Severity;
+
+// What classification made of an entry.
+struct Outcome
+{
+    bool dropped = true;
+    Category category = Category::System;
+    Severity severity = Severity::Info;
+    QString label;
+};
+
+inline Severity severityFromPriority(int prio)
+{
+    if (prio <= 2) {
+        return Severity::Critical;
+    }
+    if (prio <= 3) {
+        return Severity::Error;
+    }
+    if (prio <= 4) {
+        return Severity::Warning;
+    }
+    return Severity::Info;
+}
+
+inline bool classifyMessage(const QString &message,
+                            Category &outCategory,
+                            Severity &outSeverity,
+                            QString &outLabel)
+{
+    const QString lower = message.toLower();
+
+    if (lower.contains("httperror") &&
+        (lower.contains("429 client error") ||
+         lower.contains("too many requests"))) {
+        outCategory = Category::Network;
+        outSeverity = Severity::Warning;
+        outLabel = QStringLiteral("HTTP 429 (rate limited)");
+        return true;
+    }
+
+    if ((lower.contains("gpu") || lower.contains("amdgpu") || lower.contains("nvidia")) &&
+        (lower.contains("hang") || lower.contains("reset") ||
+         lower.contains("fault") || lower.contains("timeout"))) {
+        outCategory = Category::GPU;
+        outSeverity = Severity::Error;
+        outLabel = QStringLiteral("GPU hang/reset");
+        return true;
+    }
+
+    if (lower.contains("thermal") ||
+        lower.contains("throttle") ||
+        lower.contains("temperature above threshold")) {
+        outCategory = Category::Thermal;
+        outSeverity = Severity::Warning;
+        outLabel = QStringLiteral("Thermal throttling");
+        return true;
+    }
+
+    if (lower.contains("oom-killer") ||
+        lower.contains("out of memory")) {
+        outCategory = Category::System;
+        outSeverity = Severity::Critical;
+        outLabel = QStringLiteral("Out-of-memory condition");
+        return true;
+    }
+
+    if (lower.contains("soft lockup") ||
+        lower.contains("watchdog: bug: soft lockup")) {
+        outCategory = Category::System;
+        outSeverity = Severity::Error;
+        outLabel = QStringLiteral("CPU soft lockup");
+        return true;
+    }
+
+    if (lower.contains("consumed") &&
+        lower.contains("cpu time over") &&
+        lower.contains("memory peak")) {
+
+        static QRegularExpression re(
+            R"(Consumed\s+([0-9\.]+)s CPU time over\s+([0-9\.]+)s wall clock time,\s+([0-9\.]+)M memory peak\.)",
+            QRegularExpression::CaseInsensitiveOption
+        );
+
+        const QRegularExpressionMatch m = re.match(message);
+        if (m.hasMatch()) {
+            const double cpuSec = m.captured(1).toDouble();
+            const double memMB  = m.captured(3).toDouble();
+
+            if (cpuSec >= 5.0 || memMB >= 1024.0) {
+                outCategory = Category::Process;
+                outSeverity = Severity::Warning;
+                outLabel = QStringLiteral("High resource usage (systemd)");
+                return true;
+            }
+            return false;
+        }
+    }
+
+    return false;
+}
+
+// classifyEntry() as it was, without the timestamp and details.
+inline Outcome classify(const kpulse::JournalEntry &entry)
+{
+    Outcome out;
+
+    if (entry.identifier == QStringLiteral("kioworker") &&
+        entry.message.contains(QStringLiteral("thumbcreator/appimagethumbnail.so"))) {
+        return out;
+    }
+
+    out.severity = severityFromPriority(entry.priority);
+    if (!classifyMessage(entry.message, out.category, out.severity, out.label)) {
+        out.category = Category::System;
+        out.label = entry.message.left(120);
+        if (out.severity == Severity::Info) {
+            return out;
+        }
+    }
+
+    out.dropped = false;
+    return out;
+}
+
+} // namespace legacy
@@ -0,0 +1,170 @@
+#include <QTest>
+#include <QTimeZone>
+
+#include <algorithm>
+#include <utility>
+
+#include "baseline_tracker.hpp"
+
+using namespace kpulse;
+
+namespace {
+
+// Start of a bucket, so minute n is bucket n.
+constexpr qint64 kStartMs = 28'333'334LL * BaselineTracker::kBucketMs;
+
+Event eventAt(const QString &label, qint64 minute)
+{
+    Event ev;
+    ev.category = Category::System;
+    ev.label = label;
+    ev.timestamp = QDateTime::fromMSecsSinceEpoch(kStartMs + minute * BaselineTracker::kBucketMs,
+                                                  QTimeZone::utc());
+    return ev;
+}
+
+// Observes count events of label in the given minute; returns the score
+// of the last one.
+double feed(BaselineTracker &tracker, const QString &label, qint64 minute, int count)
+{
+    double score = 0.0;
+    for (int i = 0; i < count; ++i) {
+        score = tracker.observe(eventAt(label, minute));
+    }
+    return score;
+}
+
+QStringList labelsOf(const std::vector<BaselineState> &states)
+{
+    QStringList labels;
+    for (const BaselineState &s : states) {
+        labels << s.label;
+    }
+    labels.sort();
+    return labels;
+}
+
+} // namespace
+
+class TestBaselineTracker : public QObject
+{
+    Q_OBJECT
+private slots:
+    void stepShift();
+    void rampShift();
+    void emptyBucketCatchUp();
+    void lruEviction();
+    void stateRoundTrip();
+};
+
+// A sudden jump in rate scores high, then becomes the new normal.
+void TestBaselineTracker::stepShift()
+{
+    BaselineTracker tracker;
+    const QString label = QStringLiteral("step");
+
+    qint64 minute = 0;
+    double score = 0.0;
+    for (; minute < 120; ++minute) {
+        score = feed(tracker, label, minute, 2);
+    }
+    QVERIFY2(score < 1.0, qPrintable(QString::number(score)));
+
+    score = feed(tracker, label, minute++, 20);
+    QVERIFY2(score > 10.0, qPrintable(QString::number(score)));
+
+    for (; minute < 320; ++minute) {
+        score = feed(tracker, label, minute, 20);
+    }
+    QVERIFY2(score < 1.0, qPrintable(QString::number(score)));
+}
+
+// A slow ramp to the same rate is followed by the baseline and never
+// scores like the step does.
+void TestBaselineTracker::rampShift()
+{
+    BaselineTracker tracker;
+    const QString label = QStringLiteral("ramp");
+
+    qint64 minute = 0;
+    for (; minute < 120; ++minute) {
+        feed(tracker, label, minute, 2);
+    }
+
+    double maxScore = 0.0;
+    for (int i = 0; i < 180; ++i, ++minute) {
+        maxScore = std::max(maxScore, feed(tracker, label, minute, 2 + i / 10));
+    }
+    QVERIFY2(maxScore < 3.0, qPrintable(QString::number(maxScore)));
+}
+
+// Minutes without events count as empty buckets when the label shows up
+// again, however long the gap.
+void TestBaselineTracker::emptyBucketCatchUp()
+{
+    BaselineTracker busy;
+    BaselineTracker paused;
+    const QString label = QStringLiteral("gap");
+
+    for (qint64 minute = 0; minute < 120; ++minute) {
+        feed(busy, label, minute, 10);
+        feed(paused, label, minute, 10);
+    }
+
+    // After half an hour of silence ten events are less usual.
+    const double steady = feed(busy, label, 120, 10);
+    const double afterGap = feed(paused, label, 150, 10);
+    QVERIFY2(afterGap > steady + 1.0,
+             qPrintable(QStringLiteral("%1 vs %2").arg(afterGap).arg(steady)));
+
+    // After a year the label is as good as new: one event scores 1.
+    const qint64 year = 365LL * 24 * 60;
+    const double forgotten = feed(paused, label, 150 + year, 1);
+    QVERIFY2(qAbs(forgotten - 1.0) < 0.01, qPrintable(QString::number(forgotten)));
+}
+
+// At capacity the least recently seen label is forgotten.
+void TestBaselineTracker::lruEviction()
+{
+    BaselineTracker tracker(3);
+    feed(tracker, QStringLiteral("a"), 0, 1);
+    feed(tracker, QStringLiteral("b"), 0, 1);
+    feed(tracker, QStringLiteral("c"), 0, 1);
+    feed(tracker, QStringLiteral("a"), 1, 1);
+    QCOMPARE(tracker.size(), 3);
+
+    feed(tracker, QStringLiteral("d"), 2, 1);
+    QCOMPARE(tracker.size(), 3);
+    QCOMPARE(labelsOf(tracker.state()),
+             QStringList({QStringLiteral("a"), QStringLiteral("c"), QStringLiteral("d")}));
+}
+
+// A restored tracker scores exactly like the one it was saved from.
+void TestBaselineTracker::stateRoundTrip()
+{
+    BaselineTracker original;
+    for (qint64 minute = 0; minute < 90; ++minute) {
+        feed(original, QStringLiteral("steady"), minute, 3);
+        if (minute % 7 == 0) {
+            feed(original, QStringLiteral("bursty"), minute, 12);
+        }
+    }
+    // An open bucket with a partial count.
+    feed(original, QStringLiteral("steady"), 90, 2);
+
+    BaselineTracker restored;
+    restored.restore(original.state());
+    QCOMPARE(restored.size(), original.size());
+    QCOMPARE(labelsOf(restored.state()), labelsOf(original.state()));
+
+    for (const auto &[label, minute] : {std::pair{QStringLiteral("steady"), qint64(90)},
+                                        std::pair{QStringLiteral("steady"), qint64(95)},
+                                        std::pair{QStringLiteral("bursty"), qint64(91)}}) {
+        QCOMPARE(restored.observe(eventAt(label, minute)),
+                 original.observe(eventAt(label, minute)));
+    }
+}
+
+QTEST_GUILESS_MAIN(TestBaselineTracker)
+
+#include "test_baseline_tracker.moc"
@@ -0,0 +1,101 @@
+#include <QTest>
+
+#include "event_classifier.hpp"
+#include "journal_corpus.hpp"
+#include "legacy_classifier.hpp"
+#include "pipeline.hpp"
+
+using namespace kpulse;
+
+namespace {
+
+// Runs one entry through a classifier stage built on the default rules.
+legacy::Outcome classifyWithRules(const JournalEntry &entry)
+{
+    BoundedQueue<JournalBatch> input(1);
+    BoundedQueue<EventBatch> output(1);
+    EventClassifier classifier(&input, &output);
+
+    JournalBatch batch;
+    batch.entries.push_back(entry);
+    input.push(std::move(batch));
+    classifier.drain();
+
+    legacy::Outcome out;
+    const std::vector<EventBatch> batches = output.pop();
+    if (batches.size() != 1 || batches.front().events.empty()) {
+        return out;
+    }
+    const Event &ev = batches.front().events.front();
+    out.dropped = false;
+    out.category = ev.category;
+    out.severity = ev.severity;
+    out.label = ev.label;
+    return out;
+}
+
+JournalEntry entry(int priority, const QString &identifier, const QString &message)
+{
+    JournalEntry e;
+    e.priority = priority;
+    e.identifier = identifier;
+    e.message = message;
+    return e;
+}
+
+} // namespace
+
+// RuleSet::defaults() must classify like the hard-coded classifier it
+// replaced: same events, same category, severity and label, same drops.
+class TestDefaultRules : public QObject
+{
+    Q_OBJECT
+private slots:
+    void matchesLegacy_data();
+    void matchesLegacy();
+    void resourceUsageBelowThreshold();
+};
+
+void TestDefaultRules::matchesLegacy_data()
+{
+    QTest::addColumn<QJsonObject>("json");
+
+    const QList<QJsonObject> corpus = readJournalCorpus(QFINDTESTDATA("data/journal_sample.json"));
+    QVERIFY(!corpus.isEmpty());
+    for (qsizetype i = 0; i < corpus.size(); ++i) {
+        QTest::addRow("line-%lld", static_cast<long long>(i + 1)) << corpus.at(i);
+    }
+}
+
+void TestDefaultRules::matchesLegacy()
+{
+    QFETCH(QJsonObject, json);
+    const JournalEntry e = journalEntryFromJson(json);
+
+    const legacy::Outcome expected = legacy::classify(e);
+    const legacy::Outcome actual = classifyWithRules(e);
+
+    QCOMPARE(actual.dropped, expected.dropped);
+    if (!expected.dropped) {
+        QCOMPARE(actual.category, expected.category);
+        QCOMPARE(actual.severity, expected.severity);
+        QCOMPARE(actual.label, expected.label);
+    }
+}
+
+// The one intended difference: resource accounting below the thresholds
+// is dropped at any priority. The old classifier let it fall through to
+// the generic mapping, which only dropped it at priority Info.
+void TestDefaultRules::resourceUsageBelowThreshold()
+{
+    const QString message = QStringLiteral(
+        "foo.service: Consumed 1.690s CPU time over 8.269s wall clock time, 274.1M memory peak.");
+
+    QVERIFY(classifyWithRules(entry(6, QStringLiteral("systemd"), message)).dropped);
+    QVERIFY(classifyWithRules(entry(4, QStringLiteral("systemd"), message)).dropped);
+    QVERIFY(!legacy::classify(entry(4, QStringLiteral("systemd"), message)).dropped);
+}
+
+QTEST_GUILESS_MAIN(TestDefaultRules)
+
+#include "test_default_rules.moc"
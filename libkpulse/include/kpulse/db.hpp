@@ -1,29 +1,214 @@
 #pragma once
 
 #include "event.hpp"
+#include "histogram.hpp"
 
 #include <QSqlDatabase>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <span>
 #include <vector>
 
+class QSqlQuery;
+
 namespace kpulse {
 
+// SQLite pragmas EventStore applies when it opens its connections.
+// The defaults ("balanced") favour ingest throughput and concurrent reads
+// over surviving power loss without losing the last few transactions.
+struct StoreTuning
+{
+    QString profile       = QStringLiteral("balanced");
+    QString journalMode   = QStringLiteral("WAL");
+    QString synchronous   = QStringLiteral("NORMAL");
+    qint64  mmapSizeBytes = 256LL * 1024 * 1024;
+    int     cacheSizeKiB  = 16 * 1024;
+    QString tempStore     = QStringLiteral("MEMORY");
+
+    // Rewrite a database created without incremental auto-vacuum when it
+    // is opened, so retention can shrink the file. Takes as long as a full
+    // VACUUM and as much free disk as the file; off by default.
+    bool    vacuumOnOpen  = false;
+
+    // Named presets: "balanced", "durable" (synchronous=FULL) and
+    // "compact" (no mmap, small cache, temp data on disk).
+    // Returns false for unknown names and leaves out untouched.
+    static bool fromProfile(const QString &name, StoreTuning &out);
+};
+
+// How long data is kept at each resolution. Raw events older than
+// rawRetentionMs are folded into per-minute counts, per-minute counts older
+// than minuteRetentionMs into per-hour counts, which are kept for good.
+struct RetentionPolicy
+{
+    qint64 rawRetentionMs    = 14LL * 24 * 60 * 60 * 1000;
+    qint64 minuteRetentionMs = 90LL * 24 * 60 * 60 * 1000;
+
+    // Rows moved per runRetentionStep() call; small enough that one step
+    // never holds the write lock for long.
+    int batchSize = 500;
+};
+
+// Position in the (timestamp_ms, id) order used for keyset paging.
+struct EventKey
+{
+    qint64 timestampMs = 0;
+    qint64 id = 0;
+};
+
+// Persisted per-(category, label) rate baseline of the daemon's anomaly
+// detector: the open bucket (start time and count so far) and the
+// exponentially weighted mean/variance of earlier buckets.
+struct BaselineState
+{
+    Category category = Category::System;
+    QString  label;
+    qint64   bucketMs = 0;
+    int      count = 0;
+    double   mean = 0.0;
+    double   variance = 0.0;
+};
+
 class EventStore {
 public:
     explicit EventStore(const QString &dbPath);
+    ~EventStore();
+
+    EventStore(const EventStore &) = delete;
+    EventStore &operator=(const EventStore &) = delete;
 
+    // Must be called before open() to take effect.
+    void setTuning(const StoreTuning &tuning) { tuning_ = tuning; }
+    const StoreTuning &tuning() const { return tuning_; }
+
+    // The writer connection's settings as SQLite reports them after open().
+    // They can differ from tuning(): a file system without shared memory
+    // support keeps the rollback journal instead of WAL, and mmap_size is
+    // capped at compile time.
+    const StoreTuning &effectiveTuning() const { return effectiveTuning_; }
+
+    // Opens the writer connection and applies the tuning pragmas.
     bool open();
+
+    // Opens only the read-only query connection, for stores that never
+    // write (e.g. one per query thread). The database must already exist.
+    bool openReadOnly();
+
+    // Bring the schema up to date by applying the numbered migrations the
+    // database has not seen yet. Fails (and leaves the file untouched) if
+    // the database was written by a newer KPulse.
     bool initSchema();
+
+    // Progress of long migrations: (target version, percent, description).
+    // Without a callback progress is logged.
+    using MigrationProgressFn =
+        std::function<void(int version, int percent, const QString &description)>;
+    void setMigrationProgressCallback(MigrationProgressFn fn)
+    {
+        migrationProgress_ = std::move(fn);
+    }
     bool insertEvent(const Event &event, qint64 *outId = nullptr);
 
+    // Insert all events in a single transaction using the cached INSERT
+    // statement. Either every event is stored or none is. When outIds is
+    // given it receives the new row ids in input order.
+    bool insertEvents(std::span<const Event> events,
+                      std::vector<qint64> *outIds = nullptr);
+
+    // Store the grown count/lastSeen and the current details of already
+    // stored events (by id), in a single transaction.
+    bool updateRepeats(std::span<const Event> events);
+
+    // Baselines of the anomaly detector. saveBaselines() replaces the
+    // stored set; loadBaselines() returns it oldest bucket first.
+    bool saveBaselines(const std::vector<BaselineState> &states);
+    std::vector<BaselineState> loadBaselines();
+
+    // Small key/value store in the meta table (schema version, journal
+    // cursor, ...). metaValue() returns an empty string for missing keys.
+    QString metaValue(const QString &key);
+    bool setMetaValue(const QString &key, const QString &value);
+
+    // Queries run on a separate read-only connection, so with WAL they
+    // never wait for (or block) the writer.
+    //
+    // Parts of the range past raw retention come back as aggregated events:
+    // one per (bucket, category, severity, label), with a negative id,
+    // count N (occurrences, repeats included) and details
+    // {"aggregated": true, "count": N, "resolution_ms": 60000|3600000}.
     std::vector<Event> queryEvents(const QDateTime &from,
                                    const QDateTime &to,
                                    const std::vector<Category> &categories = {});
 
+    // One page of queryEvents(), in (timestamp, id) order, starting after
+    // the given key (or at the beginning of the range). outHasMore reports
+    // whether a further page exists; the last event's key continues it.
+    std::vector<Event> queryEventsPage(const QDateTime &from,
+                                       const QDateTime &to,
+                                       const std::vector<Category> &categories,
+                                       const std::optional<EventKey> &after,
+                                       int limit,
+                                       bool *outHasMore = nullptr);
+
+    // Occurrences (repeats included) per bucketMs-wide bucket, category and
+    // severity over [fromMs, toMs), aggregated history included. Counted
+    // in SQL from covering indexes, so only the counts leave the database.
+    // Returns false on error.
+    bool histogram(qint64 fromMs,
+                   qint64 toMs,
+                   qint64 bucketMs,
+                   const std::vector<Category> &categories,
+                   EventHistogram &out);
+
+    void setRetentionPolicy(const RetentionPolicy &policy) { retention_ = policy; }
+    const RetentionPolicy &retentionPolicy() const { return retention_; }
+
+    // Apply retention to at most one batch of rows per resolution in a
+    // short transaction, then release some freed pages with
+    // incremental_vacuum if the file uses it. Returns true if more rows are due, i.e. the
+    // caller should schedule another step soon.
+    bool runRetentionStep(qint64 nowMs);
+
 private:
     QString dbPath_;
+    QString connectionName_;
+    StoreTuning tuning_;
+    StoreTuning effectiveTuning_;
+    RetentionPolicy retention_;
     QSqlDatabase db_;
+    QSqlDatabase readDb_;
+    bool readOnly_ = false;
+    bool incrementalVacuum_ = false;
+    std::unique_ptr<QSqlQuery> insertQuery_;
+    std::unique_ptr<QSqlQuery> updateQuery_;
+    MigrationProgressFn migrationProgress_;
 
     bool ensureConnection();
+    int readSchemaVersion();
+    bool ensureReadConnection();
+    void applyTuning(QSqlDatabase &db, bool writer);
+    void recordTuning();
+    std::vector<Event> queryRange(qint64 fromMs,
+                                  qint64 toMs,
+                                  const std::vector<Category> &categories,
+                                  const std::optional<EventKey> &after,
+                                  int limit,
+                                  bool *outHasMore);
+    std::vector<Event> queryRollups(QSqlQuery &query,
+                                    qint64 fromMs,
+                                    qint64 toMs,
+                                    const std::vector<Category> &categories,
+                                    const std::optional<EventKey> &after,
+                                    int fetch);
+    bool histogramFrom(QSqlQuery &query,
+                       const QString &table,
+                       const QString &timeColumn,
+                       qint64 fromMs,
+                       qint64 toMs,
+                       const std::vector<Category> &categories,
+                       EventHistogram &out);
+    QSqlQuery *preparedInsert();
 };
 
 } // namespace kpulse
@@ -0,0 +1,29 @@
+#pragma once
+
+// Typed DBus marshalling for kpulse::Event.
+//
+// On the bus an event is the struct (xxiisixa{sv}):
+//   id, timestamp_ms (UTC), category, severity, label, count,
+//   last_seen_ms (0 = none), details
+// where details is the event's JSON details object as a{sv}.
+
+#include <QDBusArgument>
+#include <QList>
+#include <QMetaType>
+
+#include "kpulse/event.hpp"
+
+namespace kpulse {
+
+using EventList = QList<Event>;
+
+// Register Event/EventList with QtDBus. Safe to call more than once.
+void registerDBusTypes();
+
+QDBusArgument &operator<<(QDBusArgument &arg, const Event &ev);
+const QDBusArgument &operator>>(const QDBusArgument &arg, Event &ev);
+
+} // namespace kpulse
+
+Q_DECLARE_METATYPE(kpulse::Event)
+Q_DECLARE_METATYPE(kpulse::EventList)
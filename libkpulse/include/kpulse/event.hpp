@@ -33,6 +33,11 @@ struct Event
     QString   label;
     QJsonObject details;
 
+    // Identical events collapsed into this one at ingest. timestamp is the
+    // first occurrence; lastSeen (invalid while count == 1) the latest.
+    int       count = 1;
+    QDateTime lastSeen;
+
     std::optional<qint64> windowId;
 };
 
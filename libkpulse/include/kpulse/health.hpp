@@ -0,0 +1,73 @@
+#pragma once
+
+#include <QString>
+#include <QtGlobal>
+
+#include <array>
+#include <vector>
+
+#include "kpulse/event.hpp"
+
+namespace kpulse {
+
+// Per-severity event counts over a sliding time window, kept as a ring of
+// fixed-width time buckets. add() and advance() are O(1) per bucket, so a
+// consumer can track "what happened in the last N minutes" from pushed
+// events without re-querying the whole window.
+class HealthWindow
+{
+public:
+    static constexpr int kSeverityCount = 4;
+
+    explicit HealthWindow(qint64 windowMs = 5 * 60 * 1000, int bucketCount = 30);
+
+    qint64 windowMs() const { return bucketMs_ * qint64(buckets_.size()); }
+    qint64 bucketMs() const { return bucketMs_; }
+
+    // Count an event by its timestamp, as `occurrences` events (normally
+    // ev.count). Events older than the window are ignored; newer ones move
+    // the window forward.
+    void add(const Event &ev, int occurrences = 1);
+
+    // Move the window so it ends at nowMs, expiring older buckets.
+    void advance(qint64 nowMs);
+
+    void clear();
+
+    int count(Severity s) const { return count(s, windowMs()); }
+    int total() const { return total(windowMs()); }
+
+    // Highest severity with a non-zero count (Info when empty).
+    Severity worst() const { return worst(windowMs()); }
+
+    // Label of the most recent event of severity s in the window.
+    QString latestLabel(Severity s) const { return latestLabel(s, windowMs()); }
+
+    // Same, restricted to the newest spanMs of the window (rounded up to
+    // whole buckets). If atMs is given it receives the event's timestamp,
+    // or -1 when there is none.
+    int count(Severity s, qint64 spanMs) const;
+    int total(qint64 spanMs) const;
+    Severity worst(qint64 spanMs) const;
+    QString latestLabel(Severity s, qint64 spanMs, qint64 *atMs = nullptr) const;
+
+private:
+    struct Bucket
+    {
+        qint64 index = -1;   // timestamp / bucketMs_, -1 when unused
+        std::array<int, kSeverityCount> counts {};
+        std::array<qint64, kSeverityCount> latestMs {};
+        std::array<QString, kSeverityCount> latestLabel;
+    };
+
+    // Bucket holding ts, moving the window if needed; null if too old.
+    Bucket *bucketFor(qint64 ts);
+    bool isLive(const Bucket &b, qint64 span) const;
+    qint64 spanBuckets(qint64 spanMs) const;
+
+    qint64 bucketMs_;
+    qint64 headIndex_ = -1;
+    std::vector<Bucket> buckets_;
+};
+
+} // namespace kpulse
@@ -0,0 +1,112 @@
+#pragma once
+
+#include <QtGlobal>
+
+#include <vector>
+
+#include "kpulse/event.hpp"
+
+namespace kpulse {
+
+// Event occurrences per fixed-width time bucket, category and severity:
+// the answer to "how busy was it when" without moving the events.
+//
+// counts is dense, bucket-major, then Category, then Severity in enum
+// order, so bucket b starts at b * kCellsPerBucket. Bucket b covers
+// [fromMs + b * bucketMs, fromMs + (b + 1) * bucketMs).
+struct EventHistogram
+{
+    static constexpr int kCategoryCount = 6;
+    static constexpr int kSeverityCount = 4;
+    static constexpr int kCellsPerBucket = kCategoryCount * kSeverityCount;
+
+    // GetEventHistogram widens bucketMs so a reply has at most this many.
+    static constexpr qint64 kMaxBuckets = 4096;
+
+    // Last millisecond of year 9999, the latest time GetEventHistogram
+    // covers.
+    static constexpr qint64 kMaxTimestampMs = 253402300799999LL;
+
+    // Whether GetEventHistogram answers for [fromMs, toMs): non-empty and
+    // within [0, kMaxTimestampMs].
+    static bool isValidRange(qint64 fromMs, qint64 toMs)
+    {
+        return fromMs >= 0 && fromMs < toMs && toMs <= kMaxTimestampMs;
+    }
+
+    // Length of [fromMs, toMs), 0 when empty. Computed unsigned, so any
+    // pair of timestamps is safe.
+    static quint64 spanMs(qint64 fromMs, qint64 toMs)
+    {
+        return toMs > fromMs ? quint64(toMs) - quint64(fromMs) : 0;
+    }
+
+    // The bucket width GetEventHistogram uses when asked for bucketMs.
+    static qint64 effectiveBucketMs(qint64 fromMs, qint64 toMs, qint64 bucketMs)
+    {
+        const quint64 span = spanMs(fromMs, toMs);
+        const quint64 minBucketMs = span / kMaxBuckets + (span % kMaxBuckets != 0);
+        return qMax(qMax<qint64>(1, bucketMs), static_cast<qint64>(minBucketMs));
+    }
+
+    qint64 fromMs = 0;
+    qint64 bucketMs = 0;
+    std::vector<quint32> counts;
+
+    bool isEmpty() const { return counts.empty() || bucketMs <= 0; }
+    int bucketCount() const { return static_cast<int>(counts.size() / kCellsPerBucket); }
+    qint64 toMs() const { return fromMs + bucketMs * bucketCount(); }
+
+    // Size counts for [fromMs, toMs) at bucketMs, all zero. Left empty if
+    // that would take more than kMaxBuckets.
+    void reset(qint64 from, qint64 to, qint64 bucket)
+    {
+        fromMs = from;
+        bucketMs = qMax<qint64>(1, bucket);
+        const quint64 span = spanMs(from, to);
+        const quint64 buckets = span == 0 ? 0 : (span - 1) / quint64(bucketMs) + 1;
+        counts.assign(buckets <= quint64(kMaxBuckets)
+                          ? static_cast<std::size_t>(buckets) * kCellsPerBucket
+                          : 0,
+                      0);
+    }
+
+    static int cell(Category c, Severity s)
+    {
+        return static_cast<int>(c) * kSeverityCount + static_cast<int>(s);
+    }
+
+    quint32 count(int bucket, Category c, Severity s) const
+    {
+        return counts[static_cast<std::size_t>(bucket) * kCellsPerBucket + cell(c, s)];
+    }
+
+    // Add occurrences at timestamp ms; ignored outside the covered range.
+    void add(qint64 ms, Category c, Severity s, quint32 occurrences = 1)
+    {
+        if (isEmpty() || ms < fromMs || ms >= toMs()) {
+            return;
+        }
+        const qint64 bucket = (ms - fromMs) / bucketMs;
+        counts[static_cast<std::size_t>(bucket) * kCellsPerBucket + cell(c, s)] += occurrences;
+    }
+
+    // All occurrences in the buckets overlapping [from, to).
+    quint64 total(qint64 from, qint64 to) const
+    {
+        if (isEmpty() || to <= fromMs || from >= toMs()) {
+            return 0;
+        }
+        const int first = static_cast<int>(qMax<qint64>(0, (from - fromMs) / bucketMs));
+        const int last = static_cast<int>(qMin<qint64>(bucketCount(),
+                                                       (to - fromMs + bucketMs - 1) / bucketMs));
+        quint64 sum = 0;
+        for (std::size_t i = std::size_t(first) * kCellsPerBucket;
+             i < std::size_t(last) * kCellsPerBucket; ++i) {
+            sum += counts[i];
+        }
+        return sum;
+    }
+};
+
+} // namespace kpulse
@@ -2,17 +2,32 @@
 
 #include <QObject>
 #include <QDateTime>
+#include <QDBusPendingCallWatcher>
+#include <QFutureWatcher>
+#include <QPointer>
 #include <QString>
 #include <QStringList>
 
 #include <vector>
 
+#include "kpulse/dbus_types.hpp"
 #include "kpulse/event.hpp"
+#include "kpulse/histogram.hpp"
 
 class QDBusInterface;
+class QDBusMessage;
 
 namespace kpulse {
 
+// One page of events as returned by IpcClient::getEventsPage().
+struct EventPage
+{
+    std::vector<Event> events;
+
+    // Token for the next page; empty once the range is exhausted.
+    QString nextPageToken;
+};
+
 class IpcClient : public QObject
 {
     Q_OBJECT
@@ -27,28 +42,106 @@ public:
     bool isConnected() const { return connected_; }
     QString lastError() const { return lastError_; }
 
-    // Synchronous fetch of events via DBus.
+    // Synchronous fetch of events via DBus (binary encoding).
     // Returns an empty vector on error; lastError() will be set.
     std::vector<Event> getEvents(const QDateTime &from,
                                  const QDateTime &to,
                                  const std::vector<Category> &categories);
 
+    // Synchronous fetch of a single page of at most `limit` events. Pass an
+    // empty pageToken for the first page and EventPage::nextPageToken for
+    // the following ones. Returns false on error; lastError() will be set.
+    bool getEventsPage(const QDateTime &from,
+                       const QDateTime &to,
+                       const std::vector<Category> &categories,
+                       const QString &pageToken,
+                       int limit,
+                       EventPage &out);
+
+    // Asynchronous counterparts of getEvents()/getEventsPage(). Each returns
+    // a request id; the result arrives later as eventsReady() or
+    // eventsPageReady(), or as requestFailed(), carrying that id. Replies
+    // are decoded on a worker thread.
+    //
+    // A client has at most one request in flight: starting a new one
+    // supersedes the previous request, whose result is never delivered.
+    quint64 requestEvents(const QDateTime &from,
+                          const QDateTime &to,
+                          const std::vector<Category> &categories);
+    quint64 requestEventsPage(const QDateTime &from,
+                              const QDateTime &to,
+                              const std::vector<Category> &categories,
+                              const QString &pageToken,
+                              int limit);
+
+    // Drop the request in flight, if any. No signal is emitted for it.
+    void cancelRequest();
+
+    // Asynchronous GetEventHistogram: occurrence counts per bucketMs over
+    // [from, to), delivered as histogramReady() or requestFailed(). Tracked
+    // separately from the event requests above, so loading events and
+    // fetching counts do not cancel each other; a new histogram request
+    // supersedes the previous one.
+    quint64 requestHistogram(const QDateTime &from,
+                             const QDateTime &to,
+                             qint64 bucketMs,
+                             const std::vector<Category> &categories);
+    void cancelHistogram();
+
+    // Only push events of at least minSeverity in the given categories
+    // (empty = all). Defaults to everything. Applied by the daemon, so
+    // filtered-out events never reach this process.
+    void setSubscription(Severity minSeverity, const std::vector<Category> &categories);
+
 signals:
-    // Emitted whenever the daemon pushes a new event over DBus.
+    // Emitted for every event the daemon pushes over DBus.
     void eventReceived(const kpulse::Event &event);
 
+    // Emitted when more identical occurrences were collapsed into an event
+    // already received: same id, larger count and later lastSeen.
+    void eventUpdated(const kpulse::Event &event);
+
+    // Results of requestEvents()/requestEventsPage().
+    void eventsReady(quint64 requestId, const std::vector<kpulse::Event> &events);
+    void eventsPageReady(quint64 requestId, const kpulse::EventPage &page);
+    void histogramReady(quint64 requestId, const kpulse::EventHistogram &histogram);
+    void requestFailed(quint64 requestId, const QString &error);
+
     // Emitted when connection state changes.
     void connectionChanged(bool connected);
 
+    // Emitted when the daemon (re)appears on the bus. Events pushed while
+    // it was away are lost, so cached state should be re-fetched.
+    void daemonRegistered();
+
 private slots:
-    void handleEventJson(const QString &json);
+    void handleEventsAdded(const kpulse::EventList &events);
+    void handleEventsUpdated(const kpulse::EventList &events);
 
 private:
     void setConnected(bool c);
+    void sendSubscription();
+
+    quint64 beginRequest();
+    void failRequestLater(quint64 id);
+    void startCall(quint64 id, const QDBusPendingCall &call, bool paged);
+    void decodeReply(quint64 id, const QDBusMessage &reply, bool paged);
 
     QDBusInterface *iface_ = nullptr;
     bool connected_ = false;
     QString lastError_;
+
+    // Async request state; activeRequest_ is 0 when nothing is in flight.
+    quint64 nextRequestId_ = 0;
+    quint64 activeRequest_ = 0;
+    QPointer<QDBusPendingCallWatcher> callWatcher_;
+    QPointer<QFutureWatcher<EventPage>> decodeWatcher_;
+
+    quint64 activeHistogram_ = 0;
+    QPointer<QDBusPendingCallWatcher> histogramWatcher_;
+
+    Severity minSeverity_ = Severity::Info;
+    std::vector<Category> subscribedCategories_;
 };
 
 } // namespace kpulse
@@ -6,17 +6,32 @@
 #include <QJsonDocument>
 #include <QJsonObject>
 #include <QSqlDatabase>
+#include <QSqlDriver>
 #include <QSqlError>
 #include <QSqlQuery>
+#include <QStringList>
 #include <QTimeZone>
 #include <QVariant>
 #include <QDebug>
+#include <QElapsedTimer>
+
+#include <sqlite3.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <limits>
 
 namespace kpulse {
 
 namespace {
 constexpr const char *kConnectionName = "kpulse_event_store";
-constexpr int kSchemaVersion = 1;
+
+// Each EventStore gets its own pair of named Qt connections.
+std::atomic<int> connectionCounter{0};
 
 QString lastErrorString(const QSqlDatabase &db)
 {
@@ -28,23 +43,414 @@ QString lastErrorString(const QSqlQuery &query)
     return query.lastError().text();
 }
 
+void bindEvent(QSqlQuery &query, const Event &event)
+{
+    // Timestamp stored as UTC msecs since epoch
+    query.bindValue(0, event.timestamp.toMSecsSinceEpoch());
+
+    query.bindValue(1, static_cast<int>(event.category));
+    query.bindValue(2, static_cast<int>(event.severity));
+    query.bindValue(3, event.label);
+
+    // Details as compact JSON, or NULL if empty
+    if (event.details.isEmpty()) {
+        query.bindValue(4, QVariant());  // NULL
+    } else {
+        QJsonDocument doc(event.details);
+        query.bindValue(4, QString::fromUtf8(doc.toJson(QJsonDocument::Compact)));
+    }
+
+    // Optional window id
+    if (event.windowId.has_value()) {
+        query.bindValue(5, static_cast<qint64>(*event.windowId));
+    } else {
+        query.bindValue(5, QVariant());  // NULL
+    }
+
+    query.bindValue(6, qMax(1, event.count));
+    if (event.lastSeen.isValid()) {
+        query.bindValue(7, event.lastSeen.toMSecsSinceEpoch());
+    } else {
+        query.bindValue(7, QVariant());  // NULL
+    }
+}
+
+// ---- Schema migrations ----------------------------------------------------
+//
+// Every schema change is a numbered migration. initSchema() applies the ones
+// newer than the database's schema_version in order, each in its own
+// transaction together with the version bump, so an interrupted upgrade
+// resumes from the last completed step.
+
+// (done, total) progress of a migration's steps.
+using StepProgress = std::function<void(qint64 done, qint64 total)>;
+
+struct Migration
+{
+    int version;
+    const char *description;
+    bool (*apply)(QSqlDatabase &db, const StepProgress &progress);
+};
+
+// Turns step progress into whole percentages for callback, or logs them
+// without one; each percentage is reported once.
+StepProgress percentProgress(const EventStore::MigrationProgressFn &callback,
+                             int version,
+                             const QString &description)
+{
+    int lastPercent = -1;
+    return [=](qint64 done, qint64 total) mutable {
+        const int percent = total > 0 ? int(done * 100 / total) : 100;
+        if (percent == lastPercent) {
+            return;
+        }
+        lastPercent = percent;
+        if (callback) {
+            callback(version, percent, description);
+        } else {
+            qInfo() << "EventStore:" << description << "progress:" << percent << "%";
+        }
+    };
+}
+
+// Steps report progress in these units, so a single long statement can
+// move the percentage while it runs.
+constexpr qint64 kStepUnits = 1000;
+
+// SQLite virtual machine instructions between progress callbacks, and the
+// rough cost of one database page for CREATE INDEX or VACUUM.
+constexpr int kProgressOps = 100000;
+constexpr double kOpsPerPage = 2000.0;
+
+// Whether the QSQLITE driver runs on the SQLite library linked here. A Qt
+// built with its bundled copy has its own, and its handles must not be
+// passed to this one.
+bool driverUsesLinkedSqlite(const QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    if (!query.exec(QStringLiteral("SELECT sqlite_source_id()")) || !query.next()) {
+        return false;
+    }
+    const QString driverSource = query.value(0).toString();
+    const bool same = driverSource == QString::fromUtf8(sqlite3_sourceid());
+    if (!same) {
+        qInfo() << "EventStore: Qt's SQLite" << driverSource
+                << "is not the linked SQLite" << sqlite3_sourceid()
+                << "- long statements report progress only when done";
+    }
+    return same;
+}
+
+// The connection's sqlite3 handle, or null when it is not usable with
+// the sqlite3_* functions linked here.
+sqlite3 *sqliteHandle(const QSqlDatabase &db)
+{
+    const QVariant handle = db.driver()->handle();
+    if (!handle.isValid() || qstrcmp(handle.typeName(), "sqlite3*") != 0) {
+        return nullptr;
+    }
+
+    // All connections share the driver's library; check it once.
+    static const bool sameLibrary = driverUsesLinkedSqlite(db);
+    return sameLibrary ? *static_cast<sqlite3 *const *>(handle.constData()) : nullptr;
+}
+
+// Progress from inside one statement, via sqlite3_progress_handler(), for
+// as long as the object lives; nothing when sqliteHandle() has none. SQLite cannot tell how much of a statement
+// is left, so the fraction is estimated from instructions executed
+// against the database size: it moves steadily and approaches, but never
+// reaches, 1.
+class StatementProgress
+{
+public:
+    StatementProgress(QSqlDatabase &db, std::function<void(double fraction)> report)
+        : handle_(sqliteHandle(db))
+        , report_(std::move(report))
+    {
+        if (!handle_) {
+            return;
+        }
+
+        QSqlQuery query(db);
+        const qint64 pages = query.exec(QStringLiteral("PRAGMA page_count")) && query.next()
+            ? query.value(0).toLongLong() : 0;
+        expectedOps_ = qMax(1.0, double(pages) * kOpsPerPage);
+
+        sqlite3_progress_handler(handle_, kProgressOps, &StatementProgress::onProgress, this);
+    }
+
+    ~StatementProgress()
+    {
+        if (handle_) {
+            sqlite3_progress_handler(handle_, 0, nullptr, nullptr);
+        }
+    }
+
+    StatementProgress(const StatementProgress &) = delete;
+    StatementProgress &operator=(const StatementProgress &) = delete;
+
+private:
+    static int onProgress(void *self)
+    {
+        auto *p = static_cast<StatementProgress *>(self);
+        p->ops_ += kProgressOps;
+        p->report_(1.0 - std::exp(-p->ops_ / p->expectedOps_));
+        return 0;   // never interrupt
+    }
+
+    sqlite3 *handle_;
+    std::function<void(double)> report_;
+    double expectedOps_ = 1.0;
+    double ops_ = 0.0;
+};
+
+bool execSteps(QSqlDatabase &db,
+               std::initializer_list<const char *> statements,
+               const StepProgress &progress)
+{
+    QSqlQuery query(db);
+    const qint64 total = static_cast<qint64>(statements.size()) * kStepUnits;
+    qint64 done = 0;
+
+    for (const char *sql : statements) {
+        bool ok = false;
+        {
+            StatementProgress inStatement(db, [&](double fraction) {
+                progress(done + qint64(fraction * kStepUnits), total);
+            });
+            ok = query.exec(QString::fromUtf8(sql));
+        }
+        if (!ok) {
+            qWarning() << "EventStore: migration statement failed:"
+                       << lastErrorString(query);
+            return false;
+        }
+        done += kStepUnits;
+        progress(done, total);
+    }
+    return true;
+}
+
+bool migrateCreateEvents(QSqlDatabase &db, const StepProgress &progress)
+{
+    return execSteps(db, {R"(
+        CREATE TABLE IF NOT EXISTS events (
+            id          INTEGER PRIMARY KEY AUTOINCREMENT,
+            timestamp_ms INTEGER NOT NULL,
+            category    INTEGER NOT NULL,
+            severity    INTEGER NOT NULL,
+            label       TEXT    NOT NULL,
+            details     TEXT,
+            window_id   INTEGER
+        )
+    )"}, progress);
+}
+
+// Range queries (timestamp_ms BETWEEN ? AND ? ORDER BY timestamp_ms) walk
+// the time index instead of scanning and sorting the whole table;
+// category-filtered queries use (category, timestamp_ms). Building these
+// on a large existing table takes a while, hence one step per index.
+bool migrateTimeIndexes(QSqlDatabase &db, const StepProgress &progress)
+{
+    return execSteps(db, {
+        "CREATE INDEX IF NOT EXISTS idx_events_timestamp "
+        "ON events (timestamp_ms)",
+        "CREATE INDEX IF NOT EXISTS idx_events_category_timestamp "
+        "ON events (category, timestamp_ms)",
+    }, progress);
+}
+
+// Per-minute and per-hour counts of events that aged out of raw
+// retention. Rows of both resolutions never overlap in time: minutes are
+// folded into hours once they pass the minute retention window.
+bool migrateRollups(QSqlDatabase &db, const StepProgress &progress)
+{
+    return execSteps(db, {R"(
+        CREATE TABLE IF NOT EXISTS events_rollup (
+            resolution_ms INTEGER NOT NULL,
+            bucket_ms     INTEGER NOT NULL,
+            category      INTEGER NOT NULL,
+            severity      INTEGER NOT NULL,
+            label         TEXT    NOT NULL,
+            count         INTEGER NOT NULL,
+            UNIQUE (resolution_ms, bucket_ms, category, severity, label)
+        )
+    )",
+        "CREATE INDEX IF NOT EXISTS idx_rollup_bucket "
+        "ON events_rollup (bucket_ms)",
+    }, progress);
+}
+
+bool autoVacuumIncremental(QSqlDatabase &db)
+{
+    QSqlQuery query(db);
+    return query.exec(QStringLiteral("PRAGMA auto_vacuum")) && query.next() &&
+        query.value(0).toInt() == 2;
+}
+
+// Retention frees pages with PRAGMA incremental_vacuum, which needs
+// auto_vacuum=INCREMENTAL. New files get it from applyTuning(). Files
+// created earlier need this full VACUUM, which rewrites the whole file and
+// needs as much free disk again, so it only runs when asked for
+// (StoreTuning::vacuumOnOpen). Until then retention just deletes and
+// SQLite reuses the freed pages.
+bool convertToIncrementalVacuum(QSqlDatabase &db, const StepProgress &progress)
+{
+    progress(0, kStepUnits);
+    qInfo() << "EventStore: rewriting database to enable incremental vacuum;"
+            << "this can take a while on large databases";
+
+    QSqlQuery query(db);
+    bool ok = query.exec(QStringLiteral("PRAGMA auto_vacuum = INCREMENTAL"));
+    if (ok) {
+        StatementProgress inVacuum(db, [&](double fraction) {
+            progress(qint64(fraction * kStepUnits), kStepUnits);
+        });
+        ok = query.exec(QStringLiteral("VACUUM"));
+    }
+    if (!ok) {
+        qWarning() << "EventStore: enabling incremental vacuum failed:"
+                   << lastErrorString(query);
+        return false;
+    }
+
+    progress(kStepUnits, kStepUnits);
+    return true;
+}
+
+// Repeated identical events are stored once, with the number of
+// occurrences and the time of the latest one.
+bool migrateRepeatCounts(QSqlDatabase &db, const StepProgress &progress)
+{
+    return execSteps(db, {
+        "ALTER TABLE events ADD COLUMN count INTEGER NOT NULL DEFAULT 1",
+        "ALTER TABLE events ADD COLUMN last_seen_ms INTEGER",
+    }, progress);
+}
+
+// Anomaly detector state, so baselines survive a daemon restart.
+bool migrateBaselines(QSqlDatabase &db, const StepProgress &progress)
+{
+    return execSteps(db, {R"(
+        CREATE TABLE IF NOT EXISTS baseline_state (
+            category  INTEGER NOT NULL,
+            label     TEXT    NOT NULL,
+            bucket_ms INTEGER NOT NULL,
+            count     INTEGER NOT NULL,
+            mean      REAL    NOT NULL,
+            variance  REAL    NOT NULL,
+            PRIMARY KEY (category, label)
+        )
+    )"}, progress);
+}
+
+// Histograms group by time, category and severity and sum count; with
+// all four in one index SQLite answers them without touching the tables.
+// The plain time indexes stay: only they order ties by rowid, which keyset
+// pages and retention batches (ORDER BY timestamp_ms, id) rely on to skip
+// a sort.
+bool migrateHistogramIndexes(QSqlDatabase &db, const StepProgress &progress)
+{
+    return execSteps(db, {
+        "CREATE INDEX IF NOT EXISTS idx_events_histogram "
+        "ON events (timestamp_ms, category, severity, count)",
+        "CREATE INDEX IF NOT EXISTS idx_rollup_histogram "
+        "ON events_rollup (bucket_ms, category, severity, count)",
+    }, progress);
+}
+
+constexpr Migration kMigrations[] = {
+    {1, "create events table", &migrateCreateEvents},
+    {2, "index events by time and category", &migrateTimeIndexes},
+    {3, "add aggregated history table", &migrateRollups},
+    {4, "add repeat counts to events", &migrateRepeatCounts},
+    {5, "add anomaly baseline table", &migrateBaselines},
+    {6, "index events for histograms", &migrateHistogramIndexes},
+};
+
+constexpr qint64 kMinuteMs = 60 * 1000;
+constexpr qint64 kHourMs = 60 * kMinuteMs;
+
+// Pages handed back to the file system per retention step.
+constexpr int kVacuumPagesPerStep = 256;
+
+constexpr int kSchemaVersion = std::end(kMigrations)[-1].version;
+
 } // namespace
 
+bool StoreTuning::fromProfile(const QString &name, StoreTuning &out)
+{
+    const QString lower = name.trimmed().toLower();
+
+    StoreTuning t;
+    if (lower.isEmpty() || lower == QLatin1String("balanced")) {
+        out = t;
+        return true;
+    }
+    if (lower == QLatin1String("durable")) {
+        t.profile = lower;
+        t.synchronous = QStringLiteral("FULL");
+        out = t;
+        return true;
+    }
+    if (lower == QLatin1String("compact")) {
+        t.profile = lower;
+        t.mmapSizeBytes = 0;
+        t.cacheSizeKiB = 2 * 1024;
+        t.tempStore = QStringLiteral("FILE");
+        out = t;
+        return true;
+    }
+    return false;
+}
+
 EventStore::EventStore(const QString &dbPath)
     : dbPath_(dbPath)
+    , connectionName_(QStringLiteral("%1_%2")
+                          .arg(QString::fromUtf8(kConnectionName))
+                          .arg(++connectionCounter))
 {
 }
 
+EventStore::~EventStore()
+{
+    // Statements and handles must be gone before the connections are
+    // removed, otherwise Qt warns that the connection is still in use.
+    insertQuery_.reset();
+    updateQuery_.reset();
+
+    const QString readName = readDb_.connectionName();
+    if (readDb_.isValid()) {
+        readDb_.close();
+    }
+    readDb_ = QSqlDatabase();
+
+    if (db_.isValid()) {
+        db_.close();
+    }
+    db_ = QSqlDatabase();
+
+    if (!readName.isEmpty()) {
+        QSqlDatabase::removeDatabase(readName);
+    }
+    if (QSqlDatabase::contains(connectionName_)) {
+        QSqlDatabase::removeDatabase(connectionName_);
+    }
+}
+
 bool EventStore::ensureConnection()
 {
     if (db_.isValid() && db_.isOpen()) {
         return true;
     }
+    if (readOnly_) {
+        return false;
+    }
 
-    if (QSqlDatabase::contains(kConnectionName)) {
-        db_ = QSqlDatabase::database(kConnectionName);
+    if (QSqlDatabase::contains(connectionName_)) {
+        db_ = QSqlDatabase::database(connectionName_);
     } else {
-        db_ = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), kConnectionName);
+        db_ = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), connectionName_);
     }
 
     db_.setDatabaseName(dbPath_);
@@ -55,42 +461,156 @@ bool EventStore::ensureConnection()
         return false;
     }
 
+    applyTuning(db_, true);
+    return true;
+}
+
+bool EventStore::ensureReadConnection()
+{
+    if (readDb_.isValid() && readDb_.isOpen()) {
+        return true;
+    }
+
+    // WAL mode is a property of the file, so the writer has to have opened
+    // (and converted) it before a read-only connection can attach. A
+    // read-only store relies on some other store having done that.
+    if (!readOnly_ && !ensureConnection()) {
+        return false;
+    }
+
+    const QString readName = connectionName_ + QStringLiteral("_ro");
+    if (QSqlDatabase::contains(readName)) {
+        readDb_ = QSqlDatabase::database(readName);
+    } else {
+        readDb_ = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), readName);
+    }
+
+    readDb_.setDatabaseName(dbPath_);
+    readDb_.setConnectOptions(QStringLiteral(
+        "QSQLITE_OPEN_READONLY;QSQLITE_BUSY_TIMEOUT=5000"));
+
+    if (!readDb_.open()) {
+        qWarning() << "EventStore: failed to open read-only connection:"
+                   << dbPath_ << "-" << lastErrorString(readDb_);
+        return false;
+    }
+
+    applyTuning(readDb_, false);
     return true;
 }
 
+void EventStore::applyTuning(QSqlDatabase &db, bool writer)
+{
+    QSqlQuery query(db);
+
+    QStringList pragmas;
+    if (writer) {
+        // auto_vacuum only takes effect while the file has no tables yet;
+        // existing files are converted by a schema migration.
+        pragmas << QStringLiteral("PRAGMA auto_vacuum = INCREMENTAL")
+                << QStringLiteral("PRAGMA journal_mode = %1").arg(tuning_.journalMode)
+                << QStringLiteral("PRAGMA synchronous = %1").arg(tuning_.synchronous);
+    } else {
+        pragmas << QStringLiteral("PRAGMA query_only = 1");
+    }
+    pragmas << QStringLiteral("PRAGMA mmap_size = %1").arg(tuning_.mmapSizeBytes)
+            // Negative cache_size is in KiB rather than pages.
+            << QStringLiteral("PRAGMA cache_size = -%1").arg(tuning_.cacheSizeKiB)
+            << QStringLiteral("PRAGMA temp_store = %1").arg(tuning_.tempStore);
+
+    for (const QString &pragma : pragmas) {
+        if (!query.exec(pragma)) {
+            qWarning() << "EventStore:" << pragma << "failed:"
+                       << lastErrorString(query);
+        }
+    }
+
+    if (!writer) {
+        return;
+    }
+
+    // SQLite silently keeps what it cannot do, so ask what is in effect.
+    const auto pragmaValue = [&query](const char *name) {
+        if (query.exec(QStringLiteral("PRAGMA %1").arg(QLatin1String(name))) && query.next()) {
+            return query.value(0);
+        }
+        return QVariant();
+    };
+
+    effectiveTuning_ = tuning_;
+    effectiveTuning_.journalMode = pragmaValue("journal_mode").toString().toUpper();
+
+    static const char *const kSynchronousNames[] = {"OFF", "NORMAL", "FULL", "EXTRA"};
+    const int synchronous = pragmaValue("synchronous").toInt();
+    effectiveTuning_.synchronous = synchronous >= 0 && synchronous < 4
+        ? QString::fromLatin1(kSynchronousNames[synchronous])
+        : QString::number(synchronous);
+
+    effectiveTuning_.mmapSizeBytes = pragmaValue("mmap_size").toLongLong();
+    query.finish();
+
+    if (effectiveTuning_.journalMode.compare(tuning_.journalMode, Qt::CaseInsensitive) != 0) {
+        qWarning() << "EventStore: journal_mode" << tuning_.journalMode
+                   << "is not available for" << dbPath_ << "- running in"
+                   << effectiveTuning_.journalMode << "mode; queries will block ingest";
+    }
+}
+
+void EventStore::recordTuning()
+{
+    // What the database actually runs with, not what was asked for.
+    const StoreTuning &t = effectiveTuning_;
+
+    QJsonObject obj;
+    obj.insert(QStringLiteral("profile"), t.profile);
+    obj.insert(QStringLiteral("journal_mode"), t.journalMode);
+    obj.insert(QStringLiteral("synchronous"), t.synchronous);
+    obj.insert(QStringLiteral("mmap_size"), t.mmapSizeBytes);
+    obj.insert(QStringLiteral("cache_size_kib"), t.cacheSizeKiB);
+    obj.insert(QStringLiteral("temp_store"), t.tempStore);
+
+    setMetaValue(QStringLiteral("tuning"),
+                 QString::fromUtf8(QJsonDocument(obj).toJson(QJsonDocument::Compact)));
+}
+
 bool EventStore::open()
 {
     return ensureConnection();
 }
 
-bool EventStore::initSchema()
+bool EventStore::openReadOnly()
 {
-    if (!ensureConnection()) {
-        return false;
+    readOnly_ = true;
+    return ensureReadConnection();
+}
+
+int EventStore::readSchemaVersion()
+{
+    const QString stored = metaValue(QStringLiteral("schema_version"));
+    if (!stored.isEmpty()) {
+        return stored.toInt();
     }
 
+    // Databases created before versioning have an events table but no
+    // schema_version row; they match migration 1.
     QSqlQuery query(db_);
+    if (query.exec(QStringLiteral(
+            "SELECT 1 FROM sqlite_master WHERE type = 'table' AND name = 'events'"))
+        && query.next()) {
+        return 1;
+    }
+    return 0;
+}
 
-    // Base events table. Adjust column names/types if your schema differs.
-    const char *createSql = R"(
-        CREATE TABLE IF NOT EXISTS events (
-            id          INTEGER PRIMARY KEY AUTOINCREMENT,
-            timestamp_ms INTEGER NOT NULL,
-            category    INTEGER NOT NULL,
-            severity    INTEGER NOT NULL,
-            label       TEXT    NOT NULL,
-            details     TEXT,
-            window_id   INTEGER
-        )
-    )";
-
-    if (!query.exec(QString::fromUtf8(createSql))) {
-        qWarning() << "EventStore: failed to create events table:"
-                   << lastErrorString(query);
+bool EventStore::initSchema()
+{
+    if (!ensureConnection()) {
         return false;
     }
 
-    // Optional meta table for schema versioning
+    QSqlQuery query(db_);
+
+    // Meta table holds schema_version, so it exists outside the migrations.
     const char *metaSql = R"(
         CREATE TABLE IF NOT EXISTS meta (
             key   TEXT PRIMARY KEY,
@@ -104,102 +624,574 @@ bool EventStore::initSchema()
         return false;
     }
 
-    query.prepare(QStringLiteral(
-        "INSERT OR REPLACE INTO meta (key, value) VALUES ('schema_version', ?)"
-    ));
-    query.addBindValue(QString::number(kSchemaVersion));
-    if (!query.exec()) {
-        qWarning() << "EventStore: failed to write schema version:"
-                   << lastErrorString(query);
-        // Not fatal, but indicates DB mismatch.
+    const int current = readSchemaVersion();
+    if (current > kSchemaVersion) {
+        qWarning() << "EventStore: database schema version" << current
+                   << "is newer than the supported version" << kSchemaVersion
+                   << "- refusing to open" << dbPath_;
+        return false;
+    }
+
+    for (const Migration &migration : kMigrations) {
+        if (migration.version <= current) {
+            continue;
+        }
+
+        const QString description = QString::fromUtf8(migration.description);
+        qInfo() << "EventStore: migrating schema to version" << migration.version
+                << "-" << description;
+
+        const StepProgress progress =
+            percentProgress(migrationProgress_, migration.version, description);
+
+        if (!db_.transaction()) {
+            qWarning() << "EventStore: failed to begin migration transaction:"
+                       << lastErrorString(db_);
+            return false;
+        }
+
+        QElapsedTimer elapsed;
+        elapsed.start();
+
+        bool ok = migration.apply(db_, progress);
+        if (ok) {
+            query.prepare(QStringLiteral(
+                "INSERT OR REPLACE INTO meta (key, value) VALUES ('schema_version', ?)"
+            ));
+            query.addBindValue(QString::number(migration.version));
+            ok = query.exec();
+            if (!ok) {
+                qWarning() << "EventStore: failed to write schema version:"
+                           << lastErrorString(query);
+            }
+        }
+
+        if (!ok || !db_.commit()) {
+            qWarning() << "EventStore: migration to version" << migration.version
+                       << "failed:" << lastErrorString(db_);
+            db_.rollback();
+            return false;
+        }
+
+        qInfo() << "EventStore: schema version" << migration.version
+                << "applied in" << elapsed.elapsed() << "ms";
+    }
+
+    incrementalVacuum_ = autoVacuumIncremental(db_);
+    if (!incrementalVacuum_ && !tuning_.vacuumOnOpen) {
+        qInfo() << "EventStore: database does not use incremental vacuum;"
+                << "retention will reuse freed pages instead of shrinking the file";
+    } else if (!incrementalVacuum_) {
+        const StepProgress progress = percentProgress(
+            migrationProgress_, kSchemaVersion, QStringLiteral("enable incremental vacuum"));
+
+        // A failed rewrite leaves the file as it was; retention keeps
+        // working without incremental vacuum.
+        QElapsedTimer elapsed;
+        elapsed.start();
+        if (convertToIncrementalVacuum(db_, progress)) {
+            qInfo() << "EventStore: database rewritten in" << elapsed.elapsed() << "ms";
+        }
+        incrementalVacuum_ = autoVacuumIncremental(db_);
     }
 
+    recordTuning();
+
     return true;
 }
 
-bool EventStore::insertEvent(const Event &event, qint64 *outId)
+QSqlQuery *EventStore::preparedInsert()
 {
-    if (!ensureConnection()) {
-        return false;
+    if (insertQuery_) {
+        return insertQuery_.get();
     }
 
-    QSqlQuery query(db_);
-
-    query.prepare(QStringLiteral(R"(
+    auto query = std::make_unique<QSqlQuery>(db_);
+    if (!query->prepare(QStringLiteral(R"(
         INSERT INTO events (
             timestamp_ms,
             category,
             severity,
             label,
             details,
-            window_id
-        ) VALUES (?, ?, ?, ?, ?, ?)
-    )"));
+            window_id,
+            count,
+            last_seen_ms
+        ) VALUES (?, ?, ?, ?, ?, ?, ?, ?)
+    )"))) {
+        qWarning() << "EventStore: failed to prepare insert:"
+                   << lastErrorString(*query);
+        return nullptr;
+    }
 
-    // Timestamp stored as UTC msecs since epoch
-    query.addBindValue(event.timestamp.toMSecsSinceEpoch());
+    insertQuery_ = std::move(query);
+    return insertQuery_.get();
+}
 
-    query.addBindValue(static_cast<int>(event.category));
-    query.addBindValue(static_cast<int>(event.severity));
-    query.addBindValue(event.label);
+bool EventStore::insertEvent(const Event &event, qint64 *outId)
+{
+    if (!ensureConnection()) {
+        return false;
+    }
 
-    // Details as compact JSON, or NULL if empty
-    if (event.details.isEmpty()) {
-        query.addBindValue(QVariant());  // NULL
-    } else {
-        QJsonDocument doc(event.details);
-        query.addBindValue(QString::fromUtf8(doc.toJson(QJsonDocument::Compact)));
+    QSqlQuery *query = preparedInsert();
+    if (!query) {
+        return false;
     }
 
-    // Optional window id (assumes Event has std::optional<qint64> windowId)
-    if (event.windowId.has_value()) {
-        query.addBindValue(static_cast<qint64>(*event.windowId));
-    } else {
-        query.addBindValue(QVariant());  // NULL
+    bindEvent(*query, event);
+
+    if (!query->exec()) {
+        qWarning() << "EventStore: insertEvent failed:" << lastErrorString(*query);
+        return false;
+    }
+
+    if (outId && query->lastInsertId().isValid()) {
+        *outId = query->lastInsertId().toLongLong();
+    }
+
+    return true;
+}
+
+bool EventStore::insertEvents(std::span<const Event> events,
+                              std::vector<qint64> *outIds)
+{
+    if (outIds) {
+        outIds->clear();
+    }
+    if (events.empty()) {
+        return true;
     }
 
+    if (!ensureConnection()) {
+        return false;
+    }
+
+    QSqlQuery *query = preparedInsert();
+    if (!query) {
+        return false;
+    }
+
+    if (!db_.transaction()) {
+        qWarning() << "EventStore: insertEvents failed to begin transaction:"
+                   << lastErrorString(db_);
+        return false;
+    }
+
+    if (outIds) {
+        outIds->reserve(events.size());
+    }
+
+    for (const Event &event : events) {
+        bindEvent(*query, event);
+
+        if (!query->exec()) {
+            qWarning() << "EventStore: insertEvents failed:" << lastErrorString(*query);
+            db_.rollback();
+            if (outIds) {
+                outIds->clear();
+            }
+            return false;
+        }
+
+        if (outIds) {
+            outIds->push_back(query->lastInsertId().toLongLong());
+        }
+    }
+
+    if (!db_.commit()) {
+        qWarning() << "EventStore: insertEvents failed to commit:"
+                   << lastErrorString(db_);
+        db_.rollback();
+        if (outIds) {
+            outIds->clear();
+        }
+        return false;
+    }
+
+    return true;
+}
+
+bool EventStore::updateRepeats(std::span<const Event> events)
+{
+    if (events.empty()) {
+        return true;
+    }
+    if (!ensureConnection()) {
+        return false;
+    }
+
+    if (!updateQuery_) {
+        auto query = std::make_unique<QSqlQuery>(db_);
+        if (!query->prepare(QStringLiteral(
+                "UPDATE events SET count = ?, last_seen_ms = ?, details = ? WHERE id = ?"))) {
+            qWarning() << "EventStore: failed to prepare repeat update:"
+                       << lastErrorString(*query);
+            return false;
+        }
+        updateQuery_ = std::move(query);
+    }
+
+    if (!db_.transaction()) {
+        qWarning() << "EventStore: updateRepeats failed to begin transaction:"
+                   << lastErrorString(db_);
+        return false;
+    }
+
+    for (const Event &event : events) {
+        updateQuery_->bindValue(0, qMax(1, event.count));
+        updateQuery_->bindValue(1, event.lastSeen.isValid()
+                                       ? QVariant(event.lastSeen.toMSecsSinceEpoch())
+                                       : QVariant());
+        // Details can change too (the highest anomaly score of the repeats).
+        if (event.details.isEmpty()) {
+            updateQuery_->bindValue(2, QVariant());  // NULL
+        } else {
+            QJsonDocument doc(event.details);
+            updateQuery_->bindValue(2, QString::fromUtf8(doc.toJson(QJsonDocument::Compact)));
+        }
+        updateQuery_->bindValue(3, event.id);
+
+        if (!updateQuery_->exec()) {
+            qWarning() << "EventStore: updateRepeats failed:"
+                       << lastErrorString(*updateQuery_);
+            db_.rollback();
+            return false;
+        }
+    }
+
+    if (!db_.commit()) {
+        qWarning() << "EventStore: updateRepeats failed to commit:"
+                   << lastErrorString(db_);
+        db_.rollback();
+        return false;
+    }
+    return true;
+}
+
+bool EventStore::saveBaselines(const std::vector<BaselineState> &states)
+{
+    if (!ensureConnection()) {
+        return false;
+    }
+
+    if (!db_.transaction()) {
+        qWarning() << "EventStore: saveBaselines failed to begin transaction:"
+                   << lastErrorString(db_);
+        return false;
+    }
+
+    QSqlQuery query(db_);
+    bool ok = query.exec(QStringLiteral("DELETE FROM baseline_state"));
+    if (ok) {
+        ok = query.prepare(QStringLiteral(
+            "INSERT INTO baseline_state "
+            "(category, label, bucket_ms, count, mean, variance) "
+            "VALUES (?, ?, ?, ?, ?, ?)"));
+    }
+
+    for (std::size_t i = 0; ok && i < states.size(); ++i) {
+        const BaselineState &s = states[i];
+        query.bindValue(0, static_cast<int>(s.category));
+        query.bindValue(1, s.label);
+        query.bindValue(2, s.bucketMs);
+        query.bindValue(3, s.count);
+        query.bindValue(4, s.mean);
+        query.bindValue(5, s.variance);
+        ok = query.exec();
+    }
+
+    if (!ok) {
+        qWarning() << "EventStore: saveBaselines failed:" << lastErrorString(query);
+        db_.rollback();
+        return false;
+    }
+    if (!db_.commit()) {
+        qWarning() << "EventStore: saveBaselines failed to commit:"
+                   << lastErrorString(db_);
+        db_.rollback();
+        return false;
+    }
+    return true;
+}
+
+std::vector<BaselineState> EventStore::loadBaselines()
+{
+    std::vector<BaselineState> states;
+    if (!ensureConnection()) {
+        return states;
+    }
+
+    QSqlQuery query(db_);
+    query.setForwardOnly(true);
+    if (!query.exec(QStringLiteral(
+            "SELECT category, label, bucket_ms, count, mean, variance "
+            "FROM baseline_state ORDER BY bucket_ms"))) {
+        qWarning() << "EventStore: loadBaselines failed:" << lastErrorString(query);
+        return states;
+    }
+
+    while (query.next()) {
+        BaselineState s;
+        s.category = static_cast<Category>(query.value(0).toInt());
+        s.label = query.value(1).toString();
+        s.bucketMs = query.value(2).toLongLong();
+        s.count = query.value(3).toInt();
+        s.mean = query.value(4).toDouble();
+        s.variance = query.value(5).toDouble();
+        states.push_back(std::move(s));
+    }
+    return states;
+}
+
+QString EventStore::metaValue(const QString &key)
+{
+    if (!ensureConnection()) {
+        return QString();
+    }
+
+    QSqlQuery query(db_);
+    query.prepare(QStringLiteral("SELECT value FROM meta WHERE key = ?"));
+    query.addBindValue(key);
+
     if (!query.exec()) {
-        qWarning() << "EventStore: insertEvent failed:" << lastErrorString(query);
+        qWarning() << "EventStore: failed to read meta" << key << ":"
+                   << lastErrorString(query);
+        return QString();
+    }
+
+    return query.next() ? query.value(0).toString() : QString();
+}
+
+bool EventStore::setMetaValue(const QString &key, const QString &value)
+{
+    if (!ensureConnection()) {
         return false;
     }
 
-    if (outId && query.lastInsertId().isValid()) {
-        *outId = query.lastInsertId().toLongLong();
+    QSqlQuery query(db_);
+    query.prepare(QStringLiteral(
+        "INSERT OR REPLACE INTO meta (key, value) VALUES (?, ?)"
+    ));
+    query.addBindValue(key);
+    query.addBindValue(value);
+
+    if (!query.exec()) {
+        qWarning() << "EventStore: failed to write meta" << key << ":"
+                   << lastErrorString(query);
+        return false;
     }
 
     return true;
 }
 
+bool EventStore::runRetentionStep(qint64 nowMs)
+{
+    if (!ensureConnection()) {
+        return false;
+    }
+
+    const int batch = qMax(1, retention_.batchSize);
+
+    // Cut-offs are aligned to bucket boundaries so a bucket is never split
+    // between raw rows and a rollup, or between minute and hour rollups.
+    const qint64 rawCutoff =
+        ((nowMs - retention_.rawRetentionMs) / kMinuteMs) * kMinuteMs;
+    const qint64 minuteCutoff =
+        ((nowMs - retention_.minuteRetentionMs) / kHourMs) * kHourMs;
+
+    if (!db_.transaction()) {
+        qWarning() << "EventStore: retention failed to begin transaction:"
+                   << lastErrorString(db_);
+        return false;
+    }
+
+    QSqlQuery query(db_);
+    bool ok = true;
+    int rawMoved = 0;
+    int minutesMoved = 0;
+
+    // 1) Oldest raw events past retention -> per-minute counts. The same
+    //    ordered LIMIT selects the same rows for the INSERT and the DELETE
+    //    inside this transaction.
+    const QString rawBatch = QStringLiteral(
+        "SELECT id FROM events WHERE timestamp_ms < ? "
+        "ORDER BY timestamp_ms, id LIMIT ?");
+
+    query.prepare(QStringLiteral(
+        "INSERT INTO events_rollup "
+        "(resolution_ms, bucket_ms, category, severity, label, count) "
+        "SELECT %1, (timestamp_ms / %1) * %1, category, severity, label, SUM(count) "
+        "FROM events WHERE id IN (%2) "
+        "GROUP BY 2, category, severity, label "
+        "ON CONFLICT (resolution_ms, bucket_ms, category, severity, label) "
+        "DO UPDATE SET count = count + excluded.count")
+                      .arg(kMinuteMs)
+                      .arg(rawBatch));
+    query.addBindValue(rawCutoff);
+    query.addBindValue(batch);
+    ok = query.exec();
+
+    if (ok) {
+        query.prepare(QStringLiteral("DELETE FROM events WHERE id IN (%1)").arg(rawBatch));
+        query.addBindValue(rawCutoff);
+        query.addBindValue(batch);
+        ok = query.exec();
+        rawMoved = ok ? query.numRowsAffected() : 0;
+    }
+
+    // 2) Minute rollups past their window -> per-hour counts.
+    const QString minuteBatch = QStringLiteral(
+        "SELECT rowid FROM events_rollup "
+        "WHERE resolution_ms = %1 AND bucket_ms < ? "
+        "ORDER BY bucket_ms LIMIT ?").arg(kMinuteMs);
+
+    if (ok) {
+        query.prepare(QStringLiteral(
+            "INSERT INTO events_rollup "
+            "(resolution_ms, bucket_ms, category, severity, label, count) "
+            "SELECT %1, (bucket_ms / %1) * %1, category, severity, label, SUM(count) "
+            "FROM events_rollup WHERE rowid IN (%2) "
+            "GROUP BY 2, category, severity, label "
+            "ON CONFLICT (resolution_ms, bucket_ms, category, severity, label) "
+            "DO UPDATE SET count = count + excluded.count")
+                          .arg(kHourMs)
+                          .arg(minuteBatch));
+        query.addBindValue(minuteCutoff);
+        query.addBindValue(batch);
+        ok = query.exec();
+    }
+
+    if (ok) {
+        query.prepare(QStringLiteral("DELETE FROM events_rollup WHERE rowid IN (%1)")
+                          .arg(minuteBatch));
+        query.addBindValue(minuteCutoff);
+        query.addBindValue(batch);
+        ok = query.exec();
+        minutesMoved = ok ? query.numRowsAffected() : 0;
+    }
+
+    if (!ok) {
+        qWarning() << "EventStore: retention step failed:" << lastErrorString(query);
+        db_.rollback();
+        return false;
+    }
+
+    if (!db_.commit()) {
+        qWarning() << "EventStore: retention failed to commit:" << lastErrorString(db_);
+        db_.rollback();
+        return false;
+    }
+
+    // Give a bounded number of freed pages back to the file system. Without
+    // incremental auto-vacuum the pragma is a no-op; the pages stay on the
+    // free list for new rows.
+    if (incrementalVacuum_ && (rawMoved > 0 || minutesMoved > 0)) {
+        if (!query.exec(QStringLiteral("PRAGMA incremental_vacuum(%1)")
+                            .arg(kVacuumPagesPerStep))) {
+            qWarning() << "EventStore: incremental vacuum failed:"
+                       << lastErrorString(query);
+        }
+        while (query.next()) {
+            // incremental_vacuum works as rows are stepped
+        }
+    }
+
+    return rawMoved >= batch || minutesMoved >= batch;
+}
+
+namespace {
+
+// " AND category IN (?, ?, ...)" for the given filter, or nothing.
+QString categoryFilterSql(const std::vector<Category> &categories)
+{
+    if (categories.empty()) {
+        return QString();
+    }
+
+    QString sql = QStringLiteral(" AND category IN (");
+    for (std::size_t i = 0; i < categories.size(); ++i) {
+        if (i != 0) {
+            sql += QStringLiteral(", ");
+        }
+        sql += QStringLiteral("?");
+    }
+    sql += QStringLiteral(")");
+    return sql;
+}
+
+bool eventKeyLess(const Event &a, const Event &b)
+{
+    const qint64 ta = a.timestamp.toMSecsSinceEpoch();
+    const qint64 tb = b.timestamp.toMSecsSinceEpoch();
+    return ta != tb ? ta < tb : a.id < b.id;
+}
+
+} // namespace
+
 std::vector<Event> EventStore::queryEvents(const QDateTime &from,
                                            const QDateTime &to,
                                            const std::vector<Category> &categories)
+{
+    return queryRange(from.toMSecsSinceEpoch(), to.toMSecsSinceEpoch(),
+                      categories, std::nullopt, -1, nullptr);
+}
+
+std::vector<Event> EventStore::queryEventsPage(const QDateTime &from,
+                                               const QDateTime &to,
+                                               const std::vector<Category> &categories,
+                                               const std::optional<EventKey> &after,
+                                               int limit,
+                                               bool *outHasMore)
+{
+    return queryRange(from.toMSecsSinceEpoch(), to.toMSecsSinceEpoch(),
+                      categories, after, qMax(1, limit), outHasMore);
+}
+
+std::vector<Event> EventStore::queryRange(qint64 fromMs,
+                                          qint64 toMs,
+                                          const std::vector<Category> &categories,
+                                          const std::optional<EventKey> &after,
+                                          int limit,
+                                          bool *outHasMore)
 {
     std::vector<Event> results;
+    if (outHasMore) {
+        *outHasMore = false;
+    }
 
-    if (!ensureConnection()) {
+    // Fall back to the writer connection if a read-only one cannot be
+    // opened (e.g. the file is not in WAL mode and is locked).
+    if (!ensureReadConnection() && !ensureConnection()) {
         return results;
     }
 
-    QSqlQuery query(db_);
+    QSqlQuery query(readDb_.isOpen() ? readDb_ : db_);
+    query.setForwardOnly(true);
+
+    // One row more than asked for tells whether another page exists.
+    const int fetch = limit > 0 ? limit + 1 : -1;
 
     QString sql = QStringLiteral(
-        "SELECT id, timestamp_ms, category, severity, label, details, window_id "
+        "SELECT id, timestamp_ms, category, severity, label, details, window_id, "
+        "count, last_seen_ms "
         "FROM events WHERE timestamp_ms BETWEEN ? AND ?"
     );
 
     // Optional category filter
-    if (!categories.empty()) {
-        sql += QStringLiteral(" AND category IN (");
-        for (std::size_t i = 0; i < categories.size(); ++i) {
-            if (i != 0) {
-                sql += QStringLiteral(", ");
-            }
-            sql += QStringLiteral("?");
-        }
-        sql += QStringLiteral(")");
+    sql += categoryFilterSql(categories);
+
+    // Keyset paging on (timestamp_ms, id): the time index already orders
+    // ties by rowid, so this needs neither OFFSET nor a sort.
+    if (after) {
+        sql += QStringLiteral(" AND (timestamp_ms, id) > (?, ?)");
     }
 
-    sql += QStringLiteral(" ORDER BY timestamp_ms ASC");
+    sql += QStringLiteral(" ORDER BY timestamp_ms ASC, id ASC");
+
+    if (fetch > 0) {
+        sql += QStringLiteral(" LIMIT %1").arg(fetch);
+    }
 
     if (!query.prepare(sql)) {
         qWarning() << "EventStore: queryEvents prepare failed:"
@@ -207,9 +1199,6 @@ std::vector<Event> EventStore::queryEvents(const QDateTime &from,
         return results;
     }
 
-    const qint64 fromMs = from.toMSecsSinceEpoch();
-    const qint64 toMs   = to.toMSecsSinceEpoch();
-
     query.addBindValue(fromMs);
     query.addBindValue(toMs);
 
@@ -217,6 +1206,11 @@ std::vector<Event> EventStore::queryEvents(const QDateTime &from,
         query.addBindValue(static_cast<int>(cat));
     }
 
+    if (after) {
+        query.addBindValue(after->timestampMs);
+        query.addBindValue(after->id);
+    }
+
     if (!query.exec()) {
         qWarning() << "EventStore: queryEvents exec failed:"
                    << lastErrorString(query);
@@ -226,6 +1220,8 @@ std::vector<Event> EventStore::queryEvents(const QDateTime &from,
     while (query.next()) {
         Event ev;
 
+        ev.id = query.value(0).toLongLong();
+
         const qint64 tsMs = query.value(1).toLongLong();
         ev.timestamp = QDateTime::fromMSecsSinceEpoch(tsMs, QTimeZone::utc());
 
@@ -246,10 +1242,198 @@ std::vector<Event> EventStore::queryEvents(const QDateTime &from,
             ev.windowId = query.value(6).toLongLong();
         }
 
+        ev.count = qMax(1, query.value(7).toInt());
+        if (!query.value(8).isNull()) {
+            ev.lastSeen = QDateTime::fromMSecsSinceEpoch(query.value(8).toLongLong(),
+                                                         QTimeZone::utc());
+        }
+
+        results.push_back(std::move(ev));
+    }
+
+    // Ranges reaching past raw retention are answered from the rollups.
+    std::vector<Event> aggregated =
+        queryRollups(query, fromMs, toMs, categories, after, fetch);
+    if (!aggregated.empty()) {
+        std::vector<Event> merged;
+        merged.reserve(results.size() + aggregated.size());
+        std::merge(std::make_move_iterator(aggregated.begin()),
+                   std::make_move_iterator(aggregated.end()),
+                   std::make_move_iterator(results.begin()),
+                   std::make_move_iterator(results.end()),
+                   std::back_inserter(merged),
+                   eventKeyLess);
+        results.swap(merged);
+    }
+
+    if (limit > 0 && results.size() > static_cast<std::size_t>(limit)) {
+        results.resize(static_cast<std::size_t>(limit));
+        if (outHasMore) {
+            *outHasMore = true;
+        }
+    }
+
+    return results;
+}
+
+std::vector<Event> EventStore::queryRollups(QSqlQuery &query,
+                                            qint64 fromMs,
+                                            qint64 toMs,
+                                            const std::vector<Category> &categories,
+                                            const std::optional<EventKey> &after,
+                                            int fetch)
+{
+    std::vector<Event> results;
+
+    // Rollup rows have no event id; they are exposed with id = -rowid so
+    // they still have a unique, stable key for paging.
+    QString sql = QStringLiteral(
+        "SELECT bucket_ms, resolution_ms, category, severity, label, count, -rowid AS id "
+        "FROM events_rollup WHERE bucket_ms BETWEEN ? AND ?"
+    );
+
+    sql += categoryFilterSql(categories);
+
+    if (after) {
+        sql += QStringLiteral(" AND (bucket_ms, -rowid) > (?, ?)");
+    }
+
+    sql += QStringLiteral(" ORDER BY bucket_ms ASC, id ASC");
+
+    if (fetch > 0) {
+        sql += QStringLiteral(" LIMIT %1").arg(fetch);
+    }
+
+    if (!query.prepare(sql)) {
+        qWarning() << "EventStore: queryRollups prepare failed:"
+                   << lastErrorString(query);
+        return results;
+    }
+
+    query.addBindValue(fromMs);
+    query.addBindValue(toMs);
+    for (Category cat : categories) {
+        query.addBindValue(static_cast<int>(cat));
+    }
+
+    if (after) {
+        query.addBindValue(after->timestampMs);
+        query.addBindValue(after->id);
+    }
+
+    if (!query.exec()) {
+        qWarning() << "EventStore: queryRollups exec failed:"
+                   << lastErrorString(query);
+        return results;
+    }
+
+    while (query.next()) {
+        Event ev;
+        ev.id = query.value(6).toLongLong();
+        ev.timestamp = QDateTime::fromMSecsSinceEpoch(query.value(0).toLongLong(),
+                                                      QTimeZone::utc());
+        ev.category = static_cast<Category>(query.value(2).toInt());
+        ev.severity = static_cast<Severity>(query.value(3).toInt());
+        ev.label    = query.value(4).toString();
+        ev.count    = static_cast<int>(qMin<qint64>(query.value(5).toLongLong(),
+                                                    std::numeric_limits<int>::max()));
+
+        QJsonObject details;
+        details.insert(QStringLiteral("aggregated"), true);
+        details.insert(QStringLiteral("resolution_ms"), query.value(1).toLongLong());
+        details.insert(QStringLiteral("count"), query.value(5).toLongLong());
+        ev.details = details;
+
         results.push_back(std::move(ev));
     }
 
     return results;
 }
 
+bool EventStore::histogram(qint64 fromMs,
+                           qint64 toMs,
+                           qint64 bucketMs,
+                           const std::vector<Category> &categories,
+                           EventHistogram &out)
+{
+    out.reset(fromMs, toMs, bucketMs);
+    if (out.isEmpty()) {
+        return true;
+    }
+
+    if (!ensureReadConnection() && !ensureConnection()) {
+        return false;
+    }
+
+    QSqlQuery query(readDb_.isOpen() ? readDb_ : db_);
+    query.setForwardOnly(true);
+
+    // Raw events and aggregated history never overlap in time, so both are
+    // simply summed. Rollup rows count towards the bucket they start in.
+    return histogramFrom(query, QStringLiteral("events"),
+                         QStringLiteral("timestamp_ms"),
+                         fromMs, toMs, categories, out) &&
+           histogramFrom(query, QStringLiteral("events_rollup"),
+                         QStringLiteral("bucket_ms"),
+                         fromMs, toMs, categories, out);
+}
+
+bool EventStore::histogramFrom(QSqlQuery &query,
+                               const QString &table,
+                               const QString &timeColumn,
+                               qint64 fromMs,
+                               qint64 toMs,
+                               const std::vector<Category> &categories,
+                               EventHistogram &out)
+{
+    // Served from idx_events_histogram / idx_rollup_histogram alone.
+    QString sql = QStringLiteral(
+        "SELECT (%2 - ?) / ? AS bucket, category, severity, SUM(count) "
+        "FROM %1 WHERE %2 >= ? AND %2 < ?"
+    ).arg(table, timeColumn);
+    sql += categoryFilterSql(categories);
+    sql += QStringLiteral(" GROUP BY bucket, category, severity");
+
+    if (!query.prepare(sql)) {
+        qWarning() << "EventStore: histogram prepare failed for" << table << ":"
+                   << lastErrorString(query);
+        return false;
+    }
+
+    query.addBindValue(out.fromMs);
+    query.addBindValue(out.bucketMs);
+    query.addBindValue(fromMs);
+    query.addBindValue(toMs);
+    for (Category cat : categories) {
+        query.addBindValue(static_cast<int>(cat));
+    }
+
+    if (!query.exec()) {
+        qWarning() << "EventStore: histogram exec failed for" << table << ":"
+                   << lastErrorString(query);
+        return false;
+    }
+
+    const int buckets = out.bucketCount();
+    while (query.next()) {
+        const qint64 bucket = query.value(0).toLongLong();
+        const int category = query.value(1).toInt();
+        const int severity = query.value(2).toInt();
+        if (bucket < 0 || bucket >= buckets ||
+            category < 0 || category >= EventHistogram::kCategoryCount ||
+            severity < 0 || severity >= EventHistogram::kSeverityCount) {
+            continue;
+        }
+        quint32 &cell = out.counts[static_cast<std::size_t>(bucket) *
+                                       EventHistogram::kCellsPerBucket +
+                                   EventHistogram::cell(static_cast<Category>(category),
+                                                        static_cast<Severity>(severity))];
+        const qint64 sum = qint64(cell) + query.value(3).toLongLong();
+        cell = static_cast<quint32>(qMin<qint64>(sum, std::numeric_limits<quint32>::max()));
+    }
+
+    query.finish();
+    return true;
+}
+
 } // namespace kpulse
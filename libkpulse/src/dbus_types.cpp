@@ -0,0 +1,193 @@
+#include "kpulse/dbus_types.hpp"
+
+#include <QDBusMetaType>
+#include <QDBusVariant>
+#include <QJsonArray>
+#include <QJsonObject>
+#include <QJsonValue>
+#include <QTimeZone>
+#include <QVariantList>
+#include <QVariantMap>
+
+namespace kpulse {
+
+namespace {
+
+// DBus has no null: JSON nulls are dropped, objects become a{sv} and
+// arrays av. Returns an invalid QVariant for values that are skipped.
+QVariant jsonToDBus(const QJsonValue &value)
+{
+    switch (value.type()) {
+    case QJsonValue::Null:
+    case QJsonValue::Undefined:
+        return QVariant();
+    case QJsonValue::Bool:
+        return value.toBool();
+    case QJsonValue::Double: {
+        const double d = value.toDouble();
+        const qint64 i = value.toInteger();
+        if (double(i) == d) {
+            return QVariant::fromValue(static_cast<qlonglong>(i));
+        }
+        return d;
+    }
+    case QJsonValue::String:
+        return value.toString();
+    case QJsonValue::Array: {
+        QVariantList list;
+        const QJsonArray arr = value.toArray();
+        for (const QJsonValue &v : arr) {
+            const QVariant item = jsonToDBus(v);
+            if (item.isValid()) {
+                list.push_back(item);
+            }
+        }
+        return list;
+    }
+    case QJsonValue::Object: {
+        QVariantMap map;
+        const QJsonObject obj = value.toObject();
+        for (auto it = obj.begin(); it != obj.end(); ++it) {
+            const QVariant item = jsonToDBus(it.value());
+            if (item.isValid()) {
+                map.insert(it.key(), item);
+            }
+        }
+        return map;
+    }
+    }
+    return QVariant();
+}
+
+QJsonValue dbusToJson(const QVariant &value)
+{
+    if (value.metaType() == QMetaType::fromType<QDBusVariant>()) {
+        return dbusToJson(qvariant_cast<QDBusVariant>(value).variant());
+    }
+
+    if (value.metaType() != QMetaType::fromType<QDBusArgument>()) {
+        return QJsonValue::fromVariant(value);
+    }
+
+    // Containers nested inside a variant arrive still marshalled.
+    const QDBusArgument arg = qvariant_cast<QDBusArgument>(value);
+    switch (arg.currentType()) {
+    case QDBusArgument::MapType: {
+        QJsonObject obj;
+        arg.beginMap();
+        while (!arg.atEnd()) {
+            QString key;
+            QDBusVariant item;
+            arg.beginMapEntry();
+            arg >> key >> item;
+            arg.endMapEntry();
+            obj.insert(key, dbusToJson(item.variant()));
+        }
+        arg.endMap();
+        return obj;
+    }
+    case QDBusArgument::ArrayType: {
+        QJsonArray arr;
+        arg.beginArray();
+        while (!arg.atEnd()) {
+            QDBusVariant item;
+            arg >> item;
+            arr.push_back(dbusToJson(item.variant()));
+        }
+        arg.endArray();
+        return arr;
+    }
+    default:
+        return QJsonValue();
+    }
+}
+
+} // namespace
+
+void registerDBusTypes()
+{
+    qDBusRegisterMetaType<Event>();
+    qDBusRegisterMetaType<EventList>();
+}
+
+QDBusArgument &operator<<(QDBusArgument &arg, const Event &ev)
+{
+    arg.beginStructure();
+
+    arg << static_cast<qlonglong>(ev.id)
+        << static_cast<qlonglong>(ev.timestamp.isValid()
+                                      ? ev.timestamp.toMSecsSinceEpoch()
+                                      : 0)
+        << static_cast<int>(ev.category)
+        << static_cast<int>(ev.severity)
+        << ev.label
+        << ev.count
+        << static_cast<qlonglong>(ev.lastSeen.isValid()
+                                      ? ev.lastSeen.toMSecsSinceEpoch()
+                                      : 0);
+
+    arg.beginMap(QMetaType::fromType<QString>(), QMetaType::fromType<QDBusVariant>());
+    for (auto it = ev.details.begin(); it != ev.details.end(); ++it) {
+        const QVariant value = jsonToDBus(it.value());
+        if (!value.isValid()) {
+            continue;
+        }
+        arg.beginMapEntry();
+        arg << it.key() << QDBusVariant(value);
+        arg.endMapEntry();
+    }
+    arg.endMap();
+
+    arg.endStructure();
+    return arg;
+}
+
+const QDBusArgument &operator>>(const QDBusArgument &arg, Event &ev)
+{
+    qlonglong id = 0;
+    qlonglong timestampMs = 0;
+    int category = 0;
+    int severity = 0;
+    QString label;
+    int count = 1;
+    qlonglong lastSeenMs = 0;
+
+    arg.beginStructure();
+    arg >> id >> timestampMs >> category >> severity >> label >> count >> lastSeenMs;
+
+    QJsonObject details;
+    arg.beginMap();
+    while (!arg.atEnd()) {
+        QString key;
+        QDBusVariant value;
+        arg.beginMapEntry();
+        arg >> key >> value;
+        arg.endMapEntry();
+        details.insert(key, dbusToJson(value.variant()));
+    }
+    arg.endMap();
+
+    arg.endStructure();
+
+    ev = Event{};
+    ev.id = id;
+    if (timestampMs != 0) {
+        ev.timestamp = QDateTime::fromMSecsSinceEpoch(timestampMs, QTimeZone::utc());
+    }
+    ev.category = (category >= int(Category::System) && category <= int(Category::Network))
+        ? static_cast<Category>(category)
+        : Category::System;
+    ev.severity = (severity >= int(Severity::Info) && severity <= int(Severity::Critical))
+        ? static_cast<Severity>(severity)
+        : Severity::Info;
+    ev.label = label;
+    ev.count = qMax(1, count);
+    if (lastSeenMs != 0) {
+        ev.lastSeen = QDateTime::fromMSecsSinceEpoch(lastSeenMs, QTimeZone::utc());
+    }
+    ev.details = details;
+
+    return arg;
+}
+
+} // namespace kpulse
@@ -100,6 +100,16 @@ QJsonObject eventToJson(const Event &ev)
     obj.insert(QStringLiteral("severity"), severityToString(ev.severity));
     obj.insert(QStringLiteral("label"), ev.label);
 
+    if (ev.count > 1) {
+        obj.insert(QStringLiteral("count"), ev.count);
+    }
+    if (ev.lastSeen.isValid()) {
+        obj.insert(QStringLiteral("last_seen"),
+                   ev.lastSeen.toUTC().toString(Qt::ISODate));
+        obj.insert(QStringLiteral("last_seen_ms"),
+                   static_cast<qint64>(ev.lastSeen.toMSecsSinceEpoch()));
+    }
+
     if (!ev.details.isEmpty()) {
         obj.insert(QStringLiteral("details"), ev.details);
     }
@@ -161,6 +171,17 @@ Event eventFromJson(const QJsonObject &obj)
         ev.label = obj.value(QStringLiteral("label")).toString();
     }
 
+    // Repeat count / last occurrence (optional)
+    if (obj.contains(QStringLiteral("count"))) {
+        ev.count = qMax(1, obj.value(QStringLiteral("count")).toInt());
+    }
+    if (obj.contains(QStringLiteral("last_seen_ms"))) {
+        ev.lastSeen = QDateTime::fromMSecsSinceEpoch(
+            obj.value(QStringLiteral("last_seen_ms")).toInteger(),
+            QTimeZone::utc()
+        );
+    }
+
     // Details (embedded JSON object)
     if (obj.contains(QStringLiteral("details")) &&
         obj.value(QStringLiteral("details")).isObject()) {
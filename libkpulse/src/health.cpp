@@ -0,0 +1,139 @@
+#include "kpulse/health.hpp"
+
+namespace kpulse {
+
+HealthWindow::HealthWindow(qint64 windowMs, int bucketCount)
+    : bucketMs_(qMax<qint64>(1, windowMs / qMax(1, bucketCount)))
+    , buckets_(static_cast<std::size_t>(qMax(1, bucketCount)))
+{
+}
+
+void HealthWindow::add(const Event &ev, int occurrences)
+{
+    const qint64 ts = ev.timestamp.toMSecsSinceEpoch();
+    Bucket *b = bucketFor(ts);
+    if (!b) {
+        return;
+    }
+
+    const int sev = static_cast<int>(ev.severity);
+    if (sev < 0 || sev >= kSeverityCount || occurrences <= 0) {
+        return;
+    }
+    b->counts[sev] += occurrences;
+    if (ts >= b->latestMs[sev]) {
+        b->latestMs[sev] = ts;
+        b->latestLabel[sev] = ev.label;
+    }
+}
+
+HealthWindow::Bucket *HealthWindow::bucketFor(qint64 ts)
+{
+    if (ts < 0) {
+        return nullptr;
+    }
+
+    const qint64 index = ts / bucketMs_;
+    if (index > headIndex_) {
+        advance(ts);
+    } else if (index <= headIndex_ - qint64(buckets_.size())) {
+        return nullptr;
+    }
+
+    Bucket &b = buckets_[static_cast<std::size_t>(index % qint64(buckets_.size()))];
+    if (b.index != index) {
+        b = Bucket();
+        b.index = index;
+    }
+    return &b;
+}
+
+void HealthWindow::advance(qint64 nowMs)
+{
+    const qint64 index = nowMs / bucketMs_;
+    if (index <= headIndex_) {
+        return;
+    }
+    headIndex_ = index;
+
+    // Stale buckets are only reset lazily on reuse; isLive() hides them.
+    // Dropping the payload here keeps labels of long-gone events from
+    // lingering in memory.
+    for (Bucket &b : buckets_) {
+        if (b.index >= 0 && !isLive(b, qint64(buckets_.size()))) {
+            b = Bucket();
+        }
+    }
+}
+
+void HealthWindow::clear()
+{
+    for (Bucket &b : buckets_) {
+        b = Bucket();
+    }
+}
+
+int HealthWindow::count(Severity s, qint64 spanMs) const
+{
+    const int sev = static_cast<int>(s);
+    const qint64 span = spanBuckets(spanMs);
+    int n = 0;
+    for (const Bucket &b : buckets_) {
+        if (isLive(b, span)) {
+            n += b.counts[sev];
+        }
+    }
+    return n;
+}
+
+int HealthWindow::total(qint64 spanMs) const
+{
+    int n = 0;
+    for (int sev = 0; sev < kSeverityCount; ++sev) {
+        n += count(static_cast<Severity>(sev), spanMs);
+    }
+    return n;
+}
+
+Severity HealthWindow::worst(qint64 spanMs) const
+{
+    for (int sev = kSeverityCount - 1; sev > 0; --sev) {
+        if (count(static_cast<Severity>(sev), spanMs) > 0) {
+            return static_cast<Severity>(sev);
+        }
+    }
+    return Severity::Info;
+}
+
+QString HealthWindow::latestLabel(Severity s, qint64 spanMs, qint64 *atMs) const
+{
+    const int sev = static_cast<int>(s);
+    const qint64 span = spanBuckets(spanMs);
+    qint64 latest = -1;
+    QString label;
+    for (const Bucket &b : buckets_) {
+        if (isLive(b, span) && b.counts[sev] > 0 && b.latestMs[sev] > latest) {
+            latest = b.latestMs[sev];
+            label = b.latestLabel[sev];
+        }
+    }
+    if (atMs) {
+        *atMs = latest;
+    }
+    return label;
+}
+
+bool HealthWindow::isLive(const Bucket &b, qint64 span) const
+{
+    return b.index >= 0
+        && b.index <= headIndex_
+        && b.index > headIndex_ - span;
+}
+
+qint64 HealthWindow::spanBuckets(qint64 spanMs) const
+{
+    const qint64 n = (spanMs + bucketMs_ - 1) / bucketMs_;
+    return qBound<qint64>(1, n, qint64(buckets_.size()));
+}
+
+} // namespace kpulse
@@ -4,12 +4,16 @@
 #include <QDBusError>
 #include <QDBusInterface>
 #include <QDBusMessage>
+#include <QDBusPendingCall>
 #include <QDBusReply>
-#include <QJsonArray>
-#include <QJsonDocument>
-#include <QJsonObject>
-#include <QTimeZone>
+#include <QDBusServiceWatcher>
 #include <QDebug>
+#include <QPromise>
+#include <QThreadPool>
+#include <QTimer>
+
+#include <algorithm>
+#include <memory>
 
 namespace {
 
@@ -17,8 +21,22 @@ namespace {
 constexpr const char *kServiceName  = "org.kde.kpulse.Daemon";
 constexpr const char *kObjectPath   = "/org/kde/kpulse/Daemon";
 constexpr const char *kInterface    = "org.kde.kpulse.Daemon";
-constexpr const char *kSignalName   = "EventAdded";
-constexpr const char *kMethodGet    = "GetEvents";
+constexpr const char *kSignalName   = "SubscribedEventsAdded";
+constexpr const char *kUpdateSignalName = "SubscribedEventsUpdated";
+constexpr const char *kMethodGet    = "GetEventsBinary";
+constexpr const char *kMethodPage   = "GetEventsPageBinary";
+constexpr const char *kMethodHistogram = "GetEventHistogram";
+constexpr const char *kMethodSubscribe = "Subscribe";
+
+QStringList categoryNames(const std::vector<kpulse::Category> &categories)
+{
+    QStringList catNames;
+    catNames.reserve(static_cast<int>(categories.size()));
+    for (kpulse::Category c : categories) {
+        catNames.push_back(kpulse::categoryToString(c));
+    }
+    return catNames;
+}
 
 } // namespace
 
@@ -27,6 +45,18 @@ namespace kpulse {
 IpcClient::IpcClient(QObject *parent)
     : QObject(parent)
 {
+    registerDBusTypes();
+
+    // Subscriptions live in the daemon; renew ours whenever it (re)appears.
+    auto *watcher = new QDBusServiceWatcher(QString::fromUtf8(kServiceName),
+                                            QDBusConnection::sessionBus(),
+                                            QDBusServiceWatcher::WatchForRegistration,
+                                            this);
+    connect(watcher, &QDBusServiceWatcher::serviceRegistered,
+            this, [this]() {
+                sendSubscription();
+                emit daemonRegistered();
+            });
 }
 
 IpcClient::~IpcClient()
@@ -77,27 +107,59 @@ bool IpcClient::connectToDaemon()
         return false;
     }
 
-    // Connect to EventAdded signal for push events.
+    // Push events arrive as the targeted, pre-filtered SubscribedEventsAdded
+    // signal, so this client is only woken for events it asked for.
     bool ok = bus.connect(
         QString::fromUtf8(kServiceName),
         QString::fromUtf8(kObjectPath),
         QString::fromUtf8(kInterface),
         QString::fromUtf8(kSignalName),
         this,
-        SLOT(handleEventJson(QString))
+        SLOT(handleEventsAdded(kpulse::EventList))
     );
 
     if (!ok) {
-        lastError_ = QStringLiteral("Failed to connect to EventAdded signal");
+        lastError_ = QStringLiteral("Failed to connect to SubscribedEventsAdded signal");
         qWarning() << "IpcClient:" << lastError_;
         // Still usable for pull-based GetEvents, so we do not tear down iface_
     }
 
+    if (!bus.connect(QString::fromUtf8(kServiceName),
+                     QString::fromUtf8(kObjectPath),
+                     QString::fromUtf8(kInterface),
+                     QString::fromUtf8(kUpdateSignalName),
+                     this,
+                     SLOT(handleEventsUpdated(kpulse::EventList)))) {
+        qWarning() << "IpcClient: failed to connect to SubscribedEventsUpdated signal";
+    }
+
+    sendSubscription();
+
     lastError_.clear();
     setConnected(true);
     return true;
 }
 
+void IpcClient::setSubscription(Severity minSeverity, const std::vector<Category> &categories)
+{
+    minSeverity_ = minSeverity;
+    subscribedCategories_ = categories;
+    sendSubscription();
+}
+
+void IpcClient::sendSubscription()
+{
+    if (!iface_) {
+        return;
+    }
+
+    // Fire and forget: a lost subscription only delays live updates until
+    // the next reconnect, and must not block the caller.
+    iface_->asyncCall(QString::fromUtf8(kMethodSubscribe),
+                      severityToString(minSeverity_),
+                      categoryNames(subscribedCategories_));
+}
+
 std::vector<Event> IpcClient::getEvents(const QDateTime &from,
                                         const QDateTime &to,
                                         const std::vector<Category> &categories)
@@ -113,17 +175,11 @@ std::vector<Event> IpcClient::getEvents(const QDateTime &from,
     const qint64 fromMs = from.toMSecsSinceEpoch();
     const qint64 toMs   = to.toMSecsSinceEpoch();
 
-    QStringList catNames;
-    catNames.reserve(static_cast<int>(categories.size()));
-    for (Category c : categories) {
-        catNames.push_back(categoryToString(c));
-    }
-
-    QDBusReply<QString> reply = iface_->call(
+    QDBusReply<EventList> reply = iface_->call(
         QString::fromUtf8(kMethodGet),
         static_cast<qlonglong>(fromMs),
         static_cast<qlonglong>(toMs),
-        catNames
+        categoryNames(categories)
     );
 
     if (!reply.isValid()) {
@@ -133,35 +189,300 @@ std::vector<Event> IpcClient::getEvents(const QDateTime &from,
         return results;
     }
 
-    const QString json = reply.value();
-    QJsonDocument doc = QJsonDocument::fromJson(json.toUtf8());
-    if (!doc.isArray()) {
-        lastError_ = QStringLiteral("GetEvents returned non-array JSON");
-        qWarning() << "IpcClient:" << lastError_;
-        return results;
+    const EventList events = reply.value();
+    results.assign(events.cbegin(), events.cend());
+
+    lastError_.clear();
+    return results;
+}
+
+bool IpcClient::getEventsPage(const QDateTime &from,
+                              const QDateTime &to,
+                              const std::vector<Category> &categories,
+                              const QString &pageToken,
+                              int limit,
+                              EventPage &out)
+{
+    out.events.clear();
+    out.nextPageToken.clear();
+
+    if (!iface_) {
+        if (!connectToDaemon()) {
+            return false;
+        }
     }
 
-    const QJsonArray arr = doc.array();
-    results.reserve(arr.size());
-    for (const QJsonValue &v : arr) {
-        if (!v.isObject())
-            continue;
-        const QJsonObject obj = v.toObject();
-        results.push_back(eventFromJson(obj));
+    const QDBusMessage reply = iface_->call(
+        QString::fromUtf8(kMethodPage),
+        static_cast<qlonglong>(from.toMSecsSinceEpoch()),
+        static_cast<qlonglong>(to.toMSecsSinceEpoch()),
+        categoryNames(categories),
+        pageToken,
+        limit
+    );
+
+    if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().size() < 2) {
+        lastError_ = reply.type() == QDBusMessage::ErrorMessage
+            ? reply.errorMessage()
+            : QStringLiteral("GetEventsPage returned an unexpected reply");
+        qWarning() << "IpcClient: GetEventsPage failed:" << lastError_;
+        setConnected(false);
+        return false;
     }
 
+    const EventList events = qdbus_cast<EventList>(reply.arguments().at(0));
+    out.events.assign(events.cbegin(), events.cend());
+    out.nextPageToken = reply.arguments().at(1).toString();
+
     lastError_.clear();
-    return results;
+    return true;
 }
 
-void IpcClient::handleEventJson(const QString &json)
+quint64 IpcClient::requestEvents(const QDateTime &from,
+                                 const QDateTime &to,
+                                 const std::vector<Category> &categories)
 {
-    QJsonDocument doc = QJsonDocument::fromJson(json.toUtf8());
-    if (!doc.isObject())
-        return;
+    const quint64 id = beginRequest();
+    if (!iface_ && !connectToDaemon()) {
+        failRequestLater(id);
+        return id;
+    }
 
-    Event ev = eventFromJson(doc.object());
-    emit eventReceived(ev);
+    startCall(id,
+              iface_->asyncCall(QString::fromUtf8(kMethodGet),
+                                static_cast<qlonglong>(from.toMSecsSinceEpoch()),
+                                static_cast<qlonglong>(to.toMSecsSinceEpoch()),
+                                categoryNames(categories)),
+              false);
+    return id;
+}
+
+quint64 IpcClient::requestEventsPage(const QDateTime &from,
+                                     const QDateTime &to,
+                                     const std::vector<Category> &categories,
+                                     const QString &pageToken,
+                                     int limit)
+{
+    const quint64 id = beginRequest();
+    if (!iface_ && !connectToDaemon()) {
+        failRequestLater(id);
+        return id;
+    }
+
+    startCall(id,
+              iface_->asyncCall(QString::fromUtf8(kMethodPage),
+                                static_cast<qlonglong>(from.toMSecsSinceEpoch()),
+                                static_cast<qlonglong>(to.toMSecsSinceEpoch()),
+                                categoryNames(categories),
+                                pageToken,
+                                limit),
+              true);
+    return id;
+}
+
+void IpcClient::cancelRequest()
+{
+    activeRequest_ = 0;
+
+    // A DBus call cannot be recalled; dropping the watcher just means its
+    // reply is ignored. A decode already running is told to stop early.
+    if (callWatcher_) {
+        callWatcher_->disconnect(this);
+        callWatcher_->deleteLater();
+        callWatcher_ = nullptr;
+    }
+    if (decodeWatcher_) {
+        decodeWatcher_->disconnect(this);
+        decodeWatcher_->cancel();
+        decodeWatcher_->deleteLater();
+        decodeWatcher_ = nullptr;
+    }
+}
+
+quint64 IpcClient::requestHistogram(const QDateTime &from,
+                                    const QDateTime &to,
+                                    qint64 bucketMs,
+                                    const std::vector<Category> &categories)
+{
+    cancelHistogram();
+    const quint64 id = ++nextRequestId_;
+    activeHistogram_ = id;
+
+    if (!iface_ && !connectToDaemon()) {
+        const QString error = lastError_;
+        QTimer::singleShot(0, this, [this, id, error]() {
+            if (id != activeHistogram_)
+                return;
+            activeHistogram_ = 0;
+            emit requestFailed(id, error);
+        });
+        return id;
+    }
+
+    const qint64 fromMs = from.toMSecsSinceEpoch();
+    const qint64 toMs = to.toMSecsSinceEpoch();
+    auto *watcher = new QDBusPendingCallWatcher(
+        iface_->asyncCall(QString::fromUtf8(kMethodHistogram),
+                          static_cast<qlonglong>(fromMs),
+                          static_cast<qlonglong>(toMs),
+                          static_cast<qlonglong>(bucketMs),
+                          categoryNames(categories)),
+        this);
+    histogramWatcher_ = watcher;
+
+    // The reply is at most a few hundred KiB of plain integers, cheap
+    // enough to decode right here.
+    connect(watcher, &QDBusPendingCallWatcher::finished,
+            this, [this, id, fromMs, toMs](QDBusPendingCallWatcher *w) {
+        w->deleteLater();
+        if (histogramWatcher_ == w)
+            histogramWatcher_ = nullptr;
+        if (id != activeHistogram_)
+            return;
+        activeHistogram_ = 0;
+
+        const QDBusMessage reply = w->reply();
+        if (reply.type() != QDBusMessage::ReplyMessage || reply.arguments().size() < 2) {
+            lastError_ = reply.type() == QDBusMessage::ErrorMessage
+                ? reply.errorMessage()
+                : QStringLiteral("GetEventHistogram returned an unexpected reply");
+            qWarning() << "IpcClient: GetEventHistogram failed:" << lastError_;
+            emit requestFailed(id, lastError_);
+            return;
+        }
+
+        const QList<uint> counts = qdbus_cast<QList<uint>>(reply.arguments().at(0));
+        EventHistogram histogram;
+        histogram.reset(fromMs, toMs, reply.arguments().at(1).toLongLong());
+        if (static_cast<std::size_t>(counts.size()) != histogram.counts.size()) {
+            lastError_ = QStringLiteral("GetEventHistogram returned %1 counts, expected %2")
+                             .arg(counts.size())
+                             .arg(histogram.counts.size());
+            qWarning() << "IpcClient:" << lastError_;
+            emit requestFailed(id, lastError_);
+            return;
+        }
+        std::copy(counts.cbegin(), counts.cend(), histogram.counts.begin());
+
+        lastError_.clear();
+        emit histogramReady(id, histogram);
+    });
+    return id;
+}
+
+void IpcClient::cancelHistogram()
+{
+    activeHistogram_ = 0;
+    if (histogramWatcher_) {
+        histogramWatcher_->disconnect(this);
+        histogramWatcher_->deleteLater();
+        histogramWatcher_ = nullptr;
+    }
+}
+
+quint64 IpcClient::beginRequest()
+{
+    cancelRequest();
+    activeRequest_ = ++nextRequestId_;
+    return activeRequest_;
+}
+
+void IpcClient::failRequestLater(quint64 id)
+{
+    // Deliver asynchronously like any other result, so callers can rely on
+    // having the request id before a signal for it arrives.
+    const QString error = lastError_;
+    QTimer::singleShot(0, this, [this, id, error]() {
+        if (id != activeRequest_)
+            return;
+        activeRequest_ = 0;
+        emit requestFailed(id, error);
+    });
+}
+
+void IpcClient::startCall(quint64 id, const QDBusPendingCall &call, bool paged)
+{
+    auto *watcher = new QDBusPendingCallWatcher(call, this);
+    callWatcher_ = watcher;
+
+    connect(watcher, &QDBusPendingCallWatcher::finished,
+            this, [this, id, paged](QDBusPendingCallWatcher *w) {
+        w->deleteLater();
+        if (callWatcher_ == w)
+            callWatcher_ = nullptr;
+        if (id != activeRequest_)
+            return;
+
+        const QDBusMessage reply = w->reply();
+        if (reply.type() != QDBusMessage::ReplyMessage
+            || reply.arguments().size() < (paged ? 2 : 1)) {
+            lastError_ = reply.type() == QDBusMessage::ErrorMessage
+                ? reply.errorMessage()
+                : QStringLiteral("Daemon returned an unexpected reply");
+            qWarning() << "IpcClient: async request failed:" << lastError_;
+            activeRequest_ = 0;
+            setConnected(false);
+            emit requestFailed(id, lastError_);
+            return;
+        }
+
+        decodeReply(id, reply, paged);
+    });
+}
+
+void IpcClient::decodeReply(quint64 id, const QDBusMessage &reply, bool paged)
+{
+    // Demarshalling a large reply (and rebuilding every details object)
+    // is the expensive part of a query; keep it off the caller's thread.
+    auto promise = std::make_shared<QPromise<EventPage>>();
+
+    auto *watcher = new QFutureWatcher<EventPage>(this);
+    decodeWatcher_ = watcher;
+    connect(watcher, &QFutureWatcherBase::finished, this, [this, id, paged, watcher]() {
+        watcher->deleteLater();
+        if (decodeWatcher_ == watcher)
+            decodeWatcher_ = nullptr;
+        if (id != activeRequest_ || watcher->future().resultCount() == 0)
+            return;
+
+        activeRequest_ = 0;
+        lastError_.clear();
+        const EventPage page = watcher->future().result();
+        if (paged) {
+            emit eventsPageReady(id, page);
+        } else {
+            emit eventsReady(id, page.events);
+        }
+    });
+    watcher->setFuture(promise->future());
+
+    QThreadPool::globalInstance()->start([promise, reply, paged]() {
+        promise->start();
+        if (!promise->isCanceled()) {
+            EventPage page;
+            const EventList events = qdbus_cast<EventList>(reply.arguments().at(0));
+            page.events.assign(events.cbegin(), events.cend());
+            if (paged) {
+                page.nextPageToken = reply.arguments().at(1).toString();
+            }
+            promise->addResult(std::move(page));
+        }
+        promise->finish();
+    });
+}
+
+void IpcClient::handleEventsAdded(const EventList &events)
+{
+    for (const Event &ev : events) {
+        emit eventReceived(ev);
+    }
+}
+
+void IpcClient::handleEventsUpdated(const EventList &events)
+{
+    for (const Event &ev : events) {
+        emit eventUpdated(ev);
+    }
 }
 
 } // namespace kpulse
@@ -0,0 +1,205 @@
+#include <QDBusArgument>
+#include <QDBusConnection>
+#include <QDBusMessage>
+#include <QDBusServer>
+#include <QDir>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QTest>
+
+#include <vector>
+
+#include "kpulse/dbus_types.hpp"
+#include "kpulse/event.hpp"
+
+#include "synthetic_events.hpp"
+
+using namespace kpulse;
+
+namespace {
+
+constexpr int kReceiveTimeoutMs = 10 * 1000;
+
+const QString kPath = QStringLiteral("/bench");
+const QString kInterface = QStringLiteral("org.kde.kpulse.Bench");
+const QString kSignal = QStringLiteral("Events");
+
+enum class Format { Json, Binary };
+
+// The JSON encoding as the daemon's GetEvents/GetEventsPage send it.
+QString toJsonString(const EventList &events)
+{
+    QJsonArray arr;
+    for (const Event &ev : events) {
+        arr.push_back(eventToJson(ev));
+    }
+    return QString::fromUtf8(QJsonDocument(arr).toJson(QJsonDocument::Compact));
+}
+
+EventList fromJsonString(const QString &json)
+{
+    EventList events;
+    const QJsonArray arr = QJsonDocument::fromJson(json.toUtf8()).array();
+    events.reserve(arr.size());
+    for (const QJsonValue &value : arr) {
+        events.push_back(eventFromJson(value.toObject()));
+    }
+    return events;
+}
+
+EventList makeEvents(int count)
+{
+    const std::vector<Event> events = syntheticEvents(count);
+    EventList list(events.begin(), events.end());
+    for (qsizetype i = 0; i < list.size(); ++i) {
+        list[i].id = i + 1;
+    }
+    return list;
+}
+
+} // namespace
+
+// Cost of the two event encodings on the bus: building the D-Bus message
+// body (marshal) and getting kpulse::Events back out of a received message
+// (unmarshal). Messages go over a private peer-to-peer connection, so no
+// session bus is needed.
+class BenchDBusMarshal : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void marshal_data();
+    void marshal();
+    void unmarshal_data();
+    void unmarshal();
+
+    void onEvents(const QDBusMessage &message) { received_ = message; }
+
+private:
+    void addRows();
+
+    // Sends the events in the given format and returns the message as the
+    // receiving side sees it.
+    QDBusMessage roundTrip(Format format, const EventList &events);
+
+    QDBusServer *server_ = nullptr;
+    std::vector<QDBusConnection> peers_;
+    QDBusMessage received_;
+};
+
+void BenchDBusMarshal::initTestCase()
+{
+    registerDBusTypes();
+
+    server_ = new QDBusServer(QStringLiteral("unix:tmpdir=%1").arg(QDir::tempPath()), this);
+    QVERIFY(server_->isConnected());
+    connect(server_, &QDBusServer::newConnection, this, [this](const QDBusConnection &peer) {
+        // The server does not keep the connection alive.
+        peers_.push_back(peer);
+        peers_.back().connect(QString(), kPath, kInterface, kSignal,
+                              this, SLOT(onEvents(QDBusMessage)));
+    });
+
+    const QDBusConnection client =
+        QDBusConnection::connectToPeer(server_->address(), QStringLiteral("kpulse_bench"));
+    QVERIFY2(client.isConnected(), qPrintable(client.lastError().message()));
+    QVERIFY(QTest::qWaitFor([this]() { return !peers_.empty(); }, kReceiveTimeoutMs));
+}
+
+void BenchDBusMarshal::cleanupTestCase()
+{
+    QDBusConnection::disconnectFromPeer(QStringLiteral("kpulse_bench"));
+}
+
+void BenchDBusMarshal::addRows()
+{
+    QTest::addColumn<int>("format");
+    QTest::addColumn<int>("count");
+
+    // One live event, a coalesced broadcast, and a full GetEventsPage.
+    for (int count : {1, 100, 2000}) {
+        QTest::addRow("json-%d", count) << int(Format::Json) << count;
+        QTest::addRow("binary-%d", count) << int(Format::Binary) << count;
+    }
+}
+
+QDBusMessage BenchDBusMarshal::roundTrip(Format format, const EventList &events)
+{
+    QDBusMessage message = QDBusMessage::createSignal(kPath, kInterface, kSignal);
+    if (format == Format::Json) {
+        message << toJsonString(events);
+    } else {
+        message << QVariant::fromValue(events);
+    }
+
+    received_ = QDBusMessage();
+    if (!QDBusConnection(QStringLiteral("kpulse_bench")).send(message)) {
+        return QDBusMessage();
+    }
+    QTest::qWaitFor([this]() { return received_.type() == QDBusMessage::SignalMessage; },
+                    kReceiveTimeoutMs);
+    return received_;
+}
+
+void BenchDBusMarshal::marshal_data()
+{
+    addRows();
+}
+
+void BenchDBusMarshal::marshal()
+{
+    QFETCH(int, format);
+    QFETCH(int, count);
+    const EventList events = makeEvents(count);
+
+    // A default-constructed QDBusArgument writes into a libdbus message,
+    // i.e. the wire format.
+    QBENCHMARK {
+        QDBusArgument arg;
+        if (Format(format) == Format::Json) {
+            arg << toJsonString(events);
+        } else {
+            arg << events;
+        }
+    }
+}
+
+void BenchDBusMarshal::unmarshal_data()
+{
+    addRows();
+}
+
+void BenchDBusMarshal::unmarshal()
+{
+    QFETCH(int, format);
+    QFETCH(int, count);
+    const EventList events = makeEvents(count);
+
+    const QDBusMessage message = roundTrip(Format(format), events);
+    QCOMPARE(message.arguments().size(), 1);
+    const QVariant body = message.arguments().constFirst();
+
+    EventList decoded;
+    QBENCHMARK {
+        if (Format(format) == Format::Json) {
+            decoded = fromJsonString(body.toString());
+        } else {
+            // Each copy reads from the start: a shared QDBusArgument
+            // detaches its read position.
+            const QDBusArgument arg = qvariant_cast<QDBusArgument>(body);
+            decoded.clear();
+            arg >> decoded;
+        }
+    }
+
+    QCOMPARE(decoded.size(), events.size());
+    QCOMPARE(decoded.constLast().id, events.constLast().id);
+    QCOMPARE(decoded.constLast().label, events.constLast().label);
+    QCOMPARE(decoded.constLast().timestamp, events.constLast().timestamp);
+    QCOMPARE(decoded.constLast().details, events.constLast().details);
+}
+
+QTEST_GUILESS_MAIN(BenchDBusMarshal)
+
+#include "bench_dbus_marshal.moc"
@@ -0,0 +1,71 @@
+#include <QElapsedTimer>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include <span>
+
+#include "kpulse/db.hpp"
+
+#include "synthetic_events.hpp"
+
+using namespace kpulse;
+
+namespace {
+constexpr int kEvents = 2000;
+constexpr int kEventsLarge = 100000;
+} // namespace
+
+// Events/s stored through insertEvent() (one implicit transaction per
+// event) and through insertEvents() in batches of various sizes.
+class BenchEventStoreInsert : public QObject
+{
+    Q_OBJECT
+private slots:
+    void insert_data();
+    void insert();
+};
+
+void BenchEventStoreInsert::insert_data()
+{
+    QTest::addColumn<int>("batchSize");
+    QTest::newRow("single") << 1;
+    QTest::newRow("batch-16") << 16;
+    QTest::newRow("batch-256") << 256;
+    QTest::newRow("batch-1024") << 1024;
+}
+
+void BenchEventStoreInsert::insert()
+{
+    QFETCH(int, batchSize);
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    EventStore store(dir.filePath(QStringLiteral("events.db")));
+    QVERIFY(store.open());
+    QVERIFY(store.initSchema());
+
+    const int count = qEnvironmentVariableIsSet("KPULSE_BENCH_LARGE") ? kEventsLarge : kEvents;
+    const std::vector<Event> events = syntheticEvents(count);
+    const std::span<const Event> all(events);
+
+    qint64 stored = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QBENCHMARK {
+        for (std::size_t i = 0; i < all.size(); i += std::size_t(batchSize)) {
+            const auto chunk = all.subspan(i, qMin(all.size() - i, std::size_t(batchSize)));
+            if (batchSize == 1) {
+                QVERIFY(store.insertEvent(chunk.front()));
+            } else {
+                QVERIFY(store.insertEvents(chunk));
+            }
+        }
+        stored += count;
+    }
+    qInfo("%s: %.0f events/s", QTest::currentDataTag(),
+          double(stored) * 1000.0 / qMax<qint64>(1, timer.elapsed()));
+}
+
+QTEST_GUILESS_MAIN(BenchEventStoreInsert)
+
+#include "bench_event_store_insert.moc"
@@ -0,0 +1,110 @@
+#include <QDateTime>
+#include <QTemporaryDir>
+#include <QTest>
+#include <QTimeZone>
+
+#include <map>
+
+#include "kpulse/db.hpp"
+
+#include "synthetic_events.hpp"
+
+using namespace kpulse;
+
+namespace {
+constexpr qint64 kStartMs = 1'700'000'000'000LL;
+constexpr qint64 kStepMs = 1000;
+constexpr int kInsertBatch = 10000;
+constexpr qint64 kHourMs = 60 * 60 * 1000;
+} // namespace
+
+// Range queries against databases of 10^5 (and, with KPULSE_BENCH_LARGE=1,
+// 10^6 and 10^7) events, one per second. With the time indexes their cost
+// depends on the rows returned, not on the size of the table.
+class BenchEventStoreQuery : public QObject
+{
+    Q_OBJECT
+private slots:
+    void query_data();
+    void query();
+
+private:
+    // Database with `rows` events, built on first use.
+    QString database(int rows);
+
+    QTemporaryDir dir_;
+    std::map<int, QString> databases_;
+};
+
+QString BenchEventStoreQuery::database(int rows)
+{
+    auto it = databases_.find(rows);
+    if (it != databases_.end()) {
+        return it->second;
+    }
+
+    const QString path = dir_.filePath(QStringLiteral("events-%1.db").arg(rows));
+    EventStore store(path);
+    if (!store.open() || !store.initSchema()) {
+        return QString();
+    }
+    for (int done = 0; done < rows; done += kInsertBatch) {
+        const int n = qMin(kInsertBatch, rows - done);
+        if (!store.insertEvents(syntheticEvents(n, kStartMs + done * kStepMs, kStepMs))) {
+            return QString();
+        }
+    }
+
+    databases_.emplace(rows, path);
+    return path;
+}
+
+void BenchEventStoreQuery::query_data()
+{
+    QTest::addColumn<int>("rows");
+    QTest::addColumn<QString>("kind");
+
+    QList<int> sizes{100'000};
+    if (qEnvironmentVariableIsSet("KPULSE_BENCH_LARGE")) {
+        sizes << 1'000'000 << 10'000'000;
+    }
+    for (int rows : sizes) {
+        for (const char *kind : {"hour", "page", "category-page"}) {
+            QTest::addRow("%d/%s", rows, kind) << rows << QString::fromLatin1(kind);
+        }
+    }
+}
+
+void BenchEventStoreQuery::query()
+{
+    QFETCH(int, rows);
+    QFETCH(QString, kind);
+
+    QVERIFY(dir_.isValid());
+    const QString path = database(rows);
+    QVERIFY(!path.isEmpty());
+
+    EventStore store(path);
+    QVERIFY(store.openReadOnly());
+
+    // An hour in the middle of the data.
+    const qint64 midMs = kStartMs + (rows / 2) * kStepMs;
+    const QDateTime from = QDateTime::fromMSecsSinceEpoch(midMs, QTimeZone::utc());
+    const QDateTime to = QDateTime::fromMSecsSinceEpoch(midMs + kHourMs, QTimeZone::utc());
+
+    QBENCHMARK {
+        std::vector<Event> events;
+        if (kind == QLatin1String("hour")) {
+            events = store.queryEvents(from, to);
+        } else if (kind == QLatin1String("page")) {
+            events = store.queryEventsPage(from, to, {}, std::nullopt, 500);
+        } else {
+            events = store.queryEventsPage(from, to, {Category::GPU}, std::nullopt, 500);
+        }
+        QVERIFY(!events.empty());
+    }
+}
+
+QTEST_GUILESS_MAIN(BenchEventStoreQuery)
+
+#include "bench_event_store_query.moc"
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QTimeZone>
+
+#include <vector>
+
+#include "kpulse/event.hpp"
+
+// Events shaped like real ingest: a few dozen recurring labels spread over
+// all categories, mostly warnings, with a message in details. Timestamps
+// start at startMs and advance by stepMs.
+inline std::vector<kpulse::Event> syntheticEvents(int count,
+                                                  qint64 startMs = 1'700'000'000'000LL,
+                                                  qint64 stepMs = 1000)
+{
+    constexpr int kLabels = 48;
+
+    std::vector<kpulse::Event> events;
+    events.reserve(static_cast<std::size_t>(count));
+    for (int i = 0; i < count; ++i) {
+        kpulse::Event ev;
+        ev.timestamp = QDateTime::fromMSecsSinceEpoch(startMs + i * stepMs, QTimeZone::utc());
+        ev.category = static_cast<kpulse::Category>(i % 6);
+        ev.severity = static_cast<kpulse::Severity>(i % 7 == 0 ? 2 : 1 + (i % 11 == 0));
+        ev.label = QStringLiteral("synthetic event %1").arg(i % kLabels);
+
+        QJsonObject details;
+        details.insert(QStringLiteral("message"),
+                       QStringLiteral("unit-%1.service: something happened (#%2)")
+                           .arg(i % kLabels).arg(i));
+        details.insert(QStringLiteral("priority"), 4);
+        ev.details = details;
+        events.push_back(std::move(ev));
+    }
+    return events;
+}
@@ -0,0 +1,120 @@
+#include <QRegularExpression>
+#include <QSqlDatabase>
+#include <QSqlQuery>
+#include <QTemporaryDir>
+#include <QTest>
+
+#include "kpulse/db.hpp"
+
+#include "synthetic_events.hpp"
+
+using namespace kpulse;
+
+// The statements below are the ones EventStore runs (queryRange(),
+// runRetentionStep(), histogramFrom()). Each must be answered by walking
+// an index, never by scanning the events table or sorting its rows.
+class TestEventStoreQueryPlan : public QObject
+{
+    Q_OBJECT
+private slots:
+    void initTestCase();
+    void cleanupTestCase();
+    void usesIndex_data();
+    void usesIndex();
+
+private:
+    QString plan(const QString &sql);
+
+    QTemporaryDir dir_;
+    QSqlDatabase db_;
+};
+
+void TestEventStoreQueryPlan::initTestCase()
+{
+    QVERIFY(dir_.isValid());
+    const QString path = dir_.filePath(QStringLiteral("events.db"));
+
+    {
+        EventStore store(path);
+        QVERIFY(store.open());
+        QVERIFY(store.initSchema());
+        QVERIFY(store.insertEvents(syntheticEvents(5000)));
+    }
+
+    db_ = QSqlDatabase::addDatabase(QStringLiteral("QSQLITE"), QStringLiteral("plan"));
+    db_.setDatabaseName(path);
+    QVERIFY(db_.open());
+}
+
+void TestEventStoreQueryPlan::cleanupTestCase()
+{
+    db_.close();
+    db_ = QSqlDatabase();
+    QSqlDatabase::removeDatabase(QStringLiteral("plan"));
+}
+
+QString TestEventStoreQueryPlan::plan(const QString &sql)
+{
+    QSqlQuery query(db_);
+    if (!query.exec(QStringLiteral("EXPLAIN QUERY PLAN ") + sql)) {
+        return QString();
+    }
+
+    QStringList details;
+    while (query.next()) {
+        details << query.value(3).toString();
+    }
+    return details.join(QStringLiteral("; "));
+}
+
+void TestEventStoreQueryPlan::usesIndex_data()
+{
+    QTest::addColumn<QString>("sql");
+    QTest::addColumn<QString>("index");
+    QTest::addColumn<bool>("sorted");   // the index must provide the order
+
+    const QString select = QStringLiteral(
+        "SELECT id, timestamp_ms, category, severity, label, details, window_id, "
+        "count, last_seen_ms FROM events WHERE timestamp_ms BETWEEN ? AND ?");
+
+    QTest::newRow("range")
+        << select + QStringLiteral(" ORDER BY timestamp_ms ASC, id ASC")
+        << QStringLiteral("idx_events_timestamp") << true;
+    QTest::newRow("keyset page")
+        << select + QStringLiteral(" AND (timestamp_ms, id) > (?, ?)"
+                                   " ORDER BY timestamp_ms ASC, id ASC LIMIT 501")
+        << QStringLiteral("idx_events_timestamp") << true;
+    QTest::newRow("category")
+        << select + QStringLiteral(" AND category IN (?)"
+                                   " ORDER BY timestamp_ms ASC, id ASC LIMIT 501")
+        << QStringLiteral("idx_events_category_timestamp") << true;
+    QTest::newRow("retention batch")
+        << QStringLiteral("SELECT id FROM events WHERE timestamp_ms < ? "
+                          "ORDER BY timestamp_ms, id LIMIT ?")
+        << QStringLiteral("idx_events_timestamp") << true;
+    QTest::newRow("histogram")
+        << QStringLiteral("SELECT (timestamp_ms - ?) / ? AS bucket, category, severity, "
+                          "SUM(count) FROM events WHERE timestamp_ms >= ? AND timestamp_ms < ? "
+                          "GROUP BY bucket, category, severity")
+        << QStringLiteral("COVERING INDEX idx_events_histogram") << false;
+}
+
+void TestEventStoreQueryPlan::usesIndex()
+{
+    QFETCH(QString, sql);
+    QFETCH(QString, index);
+    QFETCH(bool, sorted);
+
+    const QString details = plan(sql);
+    QVERIFY2(!details.isEmpty(), qPrintable(sql));
+    QVERIFY2(details.contains(index), qPrintable(details));
+    QVERIFY2(!details.contains(QRegularExpression(QStringLiteral("SCAN (TABLE )?events( |;|$)"))),
+             qPrintable(details));
+    if (sorted) {
+        QVERIFY2(!details.contains(QStringLiteral("TEMP B-TREE")), qPrintable(details));
+    }
+}
+
+QTEST_GUILESS_MAIN(TestEventStoreQueryPlan)
+
+#include "test_event_store_query_plan.moc"
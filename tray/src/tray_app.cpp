@@ -7,30 +7,12 @@
 #include <QIcon>
 #include <QMenu>
 #include <QProcess>
+#include <QSet>
 
 using kpulse::Event;
 using kpulse::Category;
 using kpulse::Severity;
 
-namespace {
-
-int severityRank(Severity s)
-{
-    switch (s) {
-    case Severity::Info:
-        return 0;
-    case Severity::Warning:
-        return 1;
-    case Severity::Error:
-        return 2;
-    case Severity::Critical:
-        return 3;
-    }
-    return 0;
-}
-
-} // namespace
-
 TrayApp::TrayApp(QObject *parent)
     : QObject(parent)
 {
@@ -49,53 +31,106 @@ TrayApp::TrayApp(QObject *parent)
 
     trayIcon_->setContextMenu(menu);
 
+    // The tray only reflects warnings and worse, so Info events need not be
+    // pushed at all.
+    ipc_.setSubscription(Severity::Warning, {});
     connect(&ipc_, &kpulse::IpcClient::eventReceived, this, &TrayApp::onEventReceived);
 
-    refreshTimer_.setInterval(30000);
-    refreshTimer_.setSingleShot(false);
-    connect(&refreshTimer_, &QTimer::timeout, this, &TrayApp::updateStatus);
-    refreshTimer_.start();
+    // Pushed events may have been missed while the daemon was away.
+    connect(&ipc_, &kpulse::IpcClient::connectionChanged, this, [this](bool connected) {
+        if (!connected) {
+            needsResync_ = true;
+        }
+    });
+    connect(&ipc_, &kpulse::IpcClient::daemonRegistered, this, &TrayApp::refreshFromDaemon);
+    connect(&ipc_, &kpulse::IpcClient::eventsReady, this, &TrayApp::onResyncReady);
+    connect(&ipc_, &kpulse::IpcClient::requestFailed, this, [this](quint64 requestId) {
+        if (requestId == resyncRequest_) {
+            resyncRequest_ = 0;
+            pushedDuringResync_.clear();
+            needsResync_ = true;
+        }
+    });
+
+    // A burst of pushed events results in a single repaint.
+    renderDebounce_.setInterval(250);
+    renderDebounce_.setSingleShot(true);
+    connect(&renderDebounce_, &QTimer::timeout, this, &TrayApp::renderHealth);
+
+    // Expire old buckets once per bucket width.
+    expiryTimer_.setInterval(static_cast<int>(health_.bucketMs()));
+    expiryTimer_.setSingleShot(false);
+    connect(&expiryTimer_, &QTimer::timeout, this, &TrayApp::updateStatus);
+    expiryTimer_.start();
 
     updateStatus();
 }
 
 void TrayApp::updateStatus()
 {
-    refreshFromDaemon();
+    health_.advance(QDateTime::currentMSecsSinceEpoch());
+
+    if (needsResync_ && resyncRequest_ == 0) {
+        refreshFromDaemon();
+    }
+    renderHealth();
 }
 
 void TrayApp::refreshFromDaemon()
 {
     const QDateTime now = QDateTime::currentDateTimeUtc();
-    const QDateTime from = now.addSecs(-5 * 60);
+    const QDateTime from = now.addMSecs(-health_.windowMs());
 
-    std::vector<Category> categories;
-    auto events = ipc_.getEvents(from, now, categories);
-    applyEvents(events);
+    needsResync_ = false;
+    pushedDuringResync_.clear();
 
+    std::vector<Category> categories;
+    resyncRequest_ = ipc_.requestEvents(from, now, categories);
     lastUpdate_ = now;
 }
 
-void TrayApp::applyEvents(const std::vector<Event> &events)
+void TrayApp::onResyncReady(quint64 requestId, const std::vector<Event> &events)
 {
-    if (events.empty()) {
-        trayIcon_->setIconByName(QStringLiteral("dialog-information"));
-        trayIcon_->setToolTipSubTitle(QStringLiteral("System healthy (no recent events)"));
+    if (requestId != resyncRequest_) {
         return;
     }
-
-    int maxRank = 0;
-    Severity worst = Severity::Info;
-    QString worstLabel;
-
+    resyncRequest_ = 0;
+
+    // Events pushed while the request was in flight may or may not be in
+    // the reply; the read runs on its own thread in the daemon, so only
+    // the ids tell. Counting those missing from it keeps fresh warnings
+    // without counting any event twice.
+    QSet<qint64> seen;
+    health_.clear();
+    health_.advance(QDateTime::currentMSecsSinceEpoch());
     for (const auto &ev : events) {
-        const int rank = severityRank(ev.severity);
-        if (rank >= maxRank) {
-            maxRank = rank;
-            worst = ev.severity;
-            worstLabel = ev.label;
+        if (ev.severity != Severity::Info) {
+            health_.add(ev, ev.count);
+            seen.insert(ev.id);
         }
     }
+    for (const auto &ev : pushedDuringResync_) {
+        if (!seen.contains(ev.id)) {
+            health_.add(ev, ev.count);
+        }
+    }
+    pushedDuringResync_.clear();
+
+    renderHealth();
+}
+
+void TrayApp::renderHealth()
+{
+    renderDebounce_.stop();
+
+    if (health_.total() == 0) {
+        trayIcon_->setIconByName(QStringLiteral("dialog-information"));
+        trayIcon_->setToolTipSubTitle(QStringLiteral("System healthy (no recent warnings)"));
+        return;
+    }
+
+    const Severity worst = health_.worst();
+    const QString worstLabel = health_.latestLabel(worst);
 
     QString iconName;
     QString subtitle;
@@ -129,8 +164,17 @@ void TrayApp::applyEvents(const std::vector<Event> &events)
 
 void TrayApp::onEventReceived(const Event &event)
 {
-    Q_UNUSED(event);
-    updateStatus();
+    if (event.severity == Severity::Info) {
+        return;
+    }
+
+    health_.add(event, event.count);
+    if (resyncRequest_ != 0) {
+        pushedDuringResync_.push_back(event);
+    }
+    if (!renderDebounce_.isActive()) {
+        renderDebounce_.start();
+    }
 }
 
 void TrayApp::openMainUi()
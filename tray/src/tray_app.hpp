@@ -6,6 +6,7 @@
 
 #include <KStatusNotifierItem>
 
+#include "kpulse/health.hpp"
 #include "kpulse/ipc_client.hpp"
 #include "kpulse/event.hpp"
 
@@ -21,11 +22,24 @@ private slots:
     void openMainUi();
 
 private:
+    // Rebuild health_ from the daemon. Only needed at startup and when the
+    // daemon (re)appears; afterwards pushed events keep it current.
     void refreshFromDaemon();
-    void applyEvents(const std::vector<kpulse::Event> &events);
+    void onResyncReady(quint64 requestId, const std::vector<kpulse::Event> &events);
+    void renderHealth();
 
     kpulse::IpcClient ipc_;
     KStatusNotifierItem *trayIcon_ = nullptr;
-    QTimer refreshTimer_;
+
+    // Warnings and worse over the last 5 minutes.
+    kpulse::HealthWindow health_;
+    QTimer expiryTimer_;
+    QTimer renderDebounce_;
+    bool needsResync_ = true;
+
+    // Resync in flight, and events pushed meanwhile that its result may
+    // not contain yet.
+    quint64 resyncRequest_ = 0;
+    std::vector<kpulse::Event> pushedDuringResync_;
     QDateTime lastUpdate_;
 };
@@ -20,8 +20,8 @@ int EventModel::columnCount(const QModelIndex &parent) const
 {
     if (parent.isValid())
         return 0;
-    // Timestamp, Category, Severity, Label
-    return 4;
+    // Timestamp, Category, Severity, Label, Count
+    return 5;
 }
 
 QVariant EventModel::data(const QModelIndex &index, int role) const
@@ -41,11 +41,23 @@ QVariant EventModel::data(const QModelIndex &index, int role) const
             return kpulse::severityToString(ev.severity);
         case 3:
             return ev.label;
+        case 4:
+            return ev.count > 1 ? QString::number(ev.count) : QString();
         default:
             break;
         }
     }
 
+    if (role == Qt::ToolTipRole && index.column() == 4 && ev.lastSeen.isValid()) {
+        return QStringLiteral("%1 occurrences, last at %2")
+            .arg(ev.count)
+            .arg(ev.lastSeen.toString(Qt::ISODateWithMs));
+    }
+
+    if (role == Qt::TextAlignmentRole && index.column() == 4) {
+        return int(Qt::AlignRight | Qt::AlignVCenter);
+    }
+
     return {};
 }
 
@@ -60,6 +72,7 @@ QVariant EventModel::headerData(int section, Qt::Orientation orientation,
     case 1: return QStringLiteral("Category");
     case 2: return QStringLiteral("Severity");
     case 3: return QStringLiteral("Label");
+    case 4: return QStringLiteral("Count");
     default: break;
     }
     return {};
@@ -69,8 +82,10 @@ void EventModel::setEvents(const std::vector<Event> &events)
 {
     beginResetModel();
     events_.clear();
+    rowById_.clear();
     events_.reserve(static_cast<int>(events.size()));
     for (const auto &ev : events) {
+        rowById_.insert(ev.id, events_.size());
         events_.push_back(ev);
     }
     endResetModel();
@@ -80,10 +95,39 @@ void EventModel::appendEvent(const Event &ev)
 {
     const int row = events_.size();
     beginInsertRows(QModelIndex(), row, row);
+    rowById_.insert(ev.id, row);
     events_.push_back(ev);
     endInsertRows();
 }
 
+void EventModel::appendEvents(const std::vector<Event> &events)
+{
+    if (events.empty())
+        return;
+
+    const int first = events_.size();
+    const int last = first + static_cast<int>(events.size()) - 1;
+    beginInsertRows(QModelIndex(), first, last);
+    events_.reserve(last + 1);
+    for (const auto &ev : events) {
+        rowById_.insert(ev.id, events_.size());
+        events_.push_back(ev);
+    }
+    endInsertRows();
+}
+
+int EventModel::updateEvent(const Event &ev)
+{
+    const auto it = rowById_.constFind(ev.id);
+    if (it == rowById_.constEnd())
+        return -1;
+
+    const int row = it.value();
+    events_[row] = ev;
+    emit dataChanged(index(row, 0), index(row, columnCount() - 1));
+    return row;
+}
+
 kpulse::Event EventModel::eventAt(int row) const
 {
     if (row < 0 || row >= events_.size())
@@ -3,6 +3,7 @@
 // Event model with clipboard/CSV helpers and append support for live updates.
 
 #include <QAbstractTableModel>
+#include <QHash>
 #include <QVector>
 
 #include "kpulse/event.hpp"
@@ -26,10 +27,21 @@ public:
     // Append a single event (for live updates).
     void appendEvent(const kpulse::Event &ev);
 
+    // Append a batch of events (one page of a progressive load).
+    void appendEvents(const std::vector<kpulse::Event> &events);
+
+    // Replace the event with the same id (a grown repeat count). Returns
+    // its row, or -1 if it is not in the model.
+    int updateEvent(const kpulse::Event &ev);
+
+    // Whether the event with this id is in the model.
+    bool contains(qint64 id) const { return rowById_.contains(id); }
+
     // Accessors used by MainWindow for clipboard/CSV export.
     kpulse::Event eventAt(int row) const;
     const QVector<kpulse::Event> &events() const { return events_; }
 
 private:
     QVector<kpulse::Event> events_;
+    QHash<qint64, int> rowById_;
 };
@@ -4,6 +4,7 @@
 #include <QClipboard>
 #include <QComboBox>
 #include <QDateTime>
+#include <QDebug>
 #include <QDialog>
 #include <QDir>
 #include <QFile>
@@ -29,6 +30,8 @@
 #include <QCoreApplication>
 #include <QTimeZone>
 
+#include <limits>
+
 #include <QtDBus/QDBusConnection>
 #include <QtDBus/QDBusConnectionInterface>
 
@@ -39,6 +42,15 @@ namespace {
 
 constexpr const char *kDaemonService = "org.kde.kpulse.Daemon";
 
+// Events per GetEventsPage round-trip while loading a range.
+constexpr int kLoadPageSize = 2000;
+
+// Visible ranges holding more events than this are shown as counts only.
+constexpr quint64 kMaxLoadedEvents = 20000;
+
+// Quiet time after a zoom/pan step before anything is fetched.
+constexpr int kViewSettleMs = 150;
+
 bool isDaemonRunning()
 {
     QDBusConnectionInterface *iface = QDBusConnection::sessionBus().interface();
@@ -157,14 +169,31 @@ MainWindow::MainWindow(QWidget *parent)
     connect(timelineView_, &TimelineView::eventHovered,
             this, &MainWindow::onTimelineEventHovered);
 
+    // Timeline zoom/pan → fetch what the new range needs
+    viewTimer_ = new QTimer(this);
+    viewTimer_->setSingleShot(true);
+    viewTimer_->setInterval(kViewSettleMs);
+    connect(viewTimer_, &QTimer::timeout, this, &MainWindow::refreshView);
+    connect(timelineView_, &TimelineView::viewRangeChanged,
+            viewTimer_, qOverload<>(&QTimer::start));
+
     connect(aboutButton_, &QToolButton::clicked, this, &MainWindow::showAboutDialog);
 
     // Initial connect to daemon
     ipcClient_->connectToDaemon();
 
-    // Live updates: when daemon broadcasts EventAdded → append to model/timeline
+    connect(ipcClient_, &kpulse::IpcClient::eventsPageReady,
+            this, &MainWindow::onEventsPageReady);
+    connect(ipcClient_, &kpulse::IpcClient::histogramReady,
+            this, &MainWindow::onHistogramReady);
+    connect(ipcClient_, &kpulse::IpcClient::requestFailed,
+            this, &MainWindow::onRequestFailed);
+
+    // Live updates: when daemon pushes new events → append to model/timeline
     connect(ipcClient_, &kpulse::IpcClient::eventReceived,
             this, &MainWindow::onEventReceived);
+    connect(ipcClient_, &kpulse::IpcClient::eventUpdated,
+            this, &MainWindow::onEventUpdated);
 
     // Initial load
     onRefreshClicked();
@@ -211,12 +240,156 @@ void MainWindow::loadEvents()
     QDateTime from, to;
     updateTimeRange(from, to);
 
-    std::vector<kpulse::Category> cats; // empty = all categories
-    const auto events = ipcClient_->getEvents(from, to, cats);
-    model_->setEvents(events);
+    // Nothing is loaded until the counts for the range say how much there
+    // is. Requesting the histogram or a first page supersedes any request
+    // of a previous load still in flight.
+    ipcClient_->cancelRequest();
+    pageRequest_ = 0;
+    pendingLive_.clear();
+    liveTail_ = false;
+    loadFrom_ = QDateTime();
+    loadTo_ = QDateTime();
+    model_->setEvents({});
+    timelineView_->setEvents(model_->events());
+    timelineView_->setEventsCoverage(0, 0);
+    timelineView_->setHistogram(kpulse::EventHistogram());
+    timelineView_->setRange(from.toMSecsSinceEpoch(), to.toMSecsSinceEpoch());
+
+    viewTimer_->stop();
+    refreshView();
+}
+
+void MainWindow::refreshView()
+{
+    const qint64 viewFrom = timelineView_->viewFromMs();
+    const qint64 viewTo = timelineView_->viewToMs();
+    const qint64 span = viewTo - viewFrom;
+    const qint64 bucketMs = timelineView_->preferredBucketMs();
+
+    // Counts are fetched for the neighbouring ranges too, so panning by up
+    // to half a screen needs no round-trip.
+    const qint64 fromMs = (viewFrom - span) / bucketMs * bucketMs;
+    const qint64 toMs = ((viewTo + span) / bucketMs + 1) * bucketMs;
+    const qint64 expectedBucketMs = kpulse::EventHistogram::effectiveBucketMs(fromMs, toMs, bucketMs);
+
+    const kpulse::EventHistogram &cached = timelineView_->histogram();
+    if (cached.isEmpty() || cached.bucketMs != expectedBucketMs ||
+        cached.fromMs > viewFrom - span / 2 || cached.toMs() < viewTo + span / 2) {
+        std::vector<kpulse::Category> cats; // empty = all categories
+        histogramRequest_ = ipcClient_->requestHistogram(
+            QDateTime::fromMSecsSinceEpoch(fromMs, QTimeZone::utc()),
+            QDateTime::fromMSecsSinceEpoch(toMs, QTimeZone::utc()),
+            bucketMs, cats);
+        return;
+    }
 
-    // Feed timeline with the same events
+    maybeLoadEvents();
+}
+
+void MainWindow::onHistogramReady(quint64 requestId, const kpulse::EventHistogram &histogram)
+{
+    if (requestId != histogramRequest_)
+        return;
+
+    timelineView_->setHistogram(histogram);
+    maybeLoadEvents();
+}
+
+void MainWindow::maybeLoadEvents()
+{
+    if (timelineView_->eventsCoverView())
+        return;
+
+    const kpulse::EventHistogram &histogram = timelineView_->histogram();
+    const qint64 viewFrom = timelineView_->viewFromMs();
+    const qint64 viewTo = timelineView_->viewToMs();
+    if (histogram.isEmpty() || histogram.fromMs > viewFrom || histogram.toMs() < viewTo)
+        return;
+
+    // Prefer loading half a screen either side as well, so small pans stay
+    // on loaded events.
+    const qint64 margin = (viewTo - viewFrom) / 2;
+    const qint64 wideFrom = qMax(histogram.fromMs, viewFrom - margin);
+    const qint64 wideTo = qMin(histogram.toMs(), viewTo + margin);
+    if (histogram.total(wideFrom, wideTo) <= kMaxLoadedEvents) {
+        loadRange(wideFrom, wideTo);
+    } else if (histogram.total(viewFrom, viewTo) <= kMaxLoadedEvents) {
+        loadRange(viewFrom, viewTo);
+    }
+}
+
+void MainWindow::loadRange(qint64 fromMs, qint64 toMs)
+{
+    const qint64 nowMs = QDateTime::currentMSecsSinceEpoch();
+    liveTail_ = toMs >= nowMs;
+    if (liveTail_) {
+        toMs = nowMs;
+    }
+
+    loadFrom_ = QDateTime::fromMSecsSinceEpoch(fromMs, QTimeZone::utc());
+    loadTo_ = QDateTime::fromMSecsSinceEpoch(toMs, QTimeZone::utc());
+
+    // Start from an empty view and stream pages in; the first page shows
+    // up after one small round-trip instead of after the whole range.
+    pendingLive_.clear();
+    model_->setEvents({});
     timelineView_->setEvents(model_->events());
+    timelineView_->setEventsCoverage(fromMs,
+                                     liveTail_ ? std::numeric_limits<qint64>::max() : toMs);
+
+    requestPage(QString());
+}
+
+void MainWindow::requestPage(const QString &pageToken)
+{
+    std::vector<kpulse::Category> cats; // empty = all categories
+    pageRequest_ = ipcClient_->requestEventsPage(loadFrom_, loadTo_, cats,
+                                                 pageToken, kLoadPageSize);
+}
+
+void MainWindow::onEventsPageReady(quint64 requestId, const kpulse::EventPage &page)
+{
+    if (requestId != pageRequest_)
+        return;
+
+    model_->appendEvents(page.events);
+    timelineView_->appendEvents(page.events);
+
+    if (!page.nextPageToken.isEmpty()) {
+        requestPage(page.nextPageToken);
+        return;
+    }
+
+    pageRequest_ = 0;
+    mergePendingLive();
+}
+
+void MainWindow::onRequestFailed(quint64 requestId, const QString &error)
+{
+    if (requestId != pageRequest_)
+        return;
+
+    // Keep what was loaded; live events go on from there.
+    qWarning() << "KPulse UI: loading events failed:" << error;
+    pageRequest_ = 0;
+    mergePendingLive();
+}
+
+void MainWindow::mergePendingLive()
+{
+    // A live event stored before its page was read comes in both ways.
+    std::vector<kpulse::Event> fresh;
+    fresh.reserve(pendingLive_.size());
+    for (const kpulse::Event &ev : pendingLive_) {
+        if (!model_->contains(ev.id))
+            fresh.push_back(ev);
+    }
+    pendingLive_.clear();
+
+    if (fresh.empty())
+        return;
+    model_->appendEvents(fresh);
+    timelineView_->appendEvents(fresh);
 }
 
 void MainWindow::onRefreshClicked()
@@ -317,17 +490,37 @@ void MainWindow::showAboutDialog()
 
 void MainWindow::onEventReceived(const kpulse::Event &ev)
 {
-    // Only show events that fall inside the current time range.
-    QDateTime from, to;
-    updateTimeRange(from, to);
+    timelineView_->countEvent(ev);
 
-    if (ev.timestamp < from || ev.timestamp > to)
+    // Only keep events that extend the loaded range.
+    if (!liveTail_ || ev.timestamp < loadFrom_)
         return;
 
+    // Appending now would put it ahead of the pages still to come.
+    if (pageRequest_ != 0) {
+        pendingLive_.push_back(ev);
+        return;
+    }
+
     model_->appendEvent(ev);
     timelineView_->appendEvent(ev);
 }
 
+void MainWindow::onEventUpdated(const kpulse::Event &ev)
+{
+    for (kpulse::Event &pending : pendingLive_) {
+        if (pending.id == ev.id) {
+            pending = ev;
+            return;
+        }
+    }
+
+    // Repeats of an event that is not shown are of no interest.
+    const int row = model_->updateEvent(ev);
+    if (row >= 0)
+        timelineView_->updateEvent(row, ev);
+}
+
 // ---------- Timeline hover → table selection ----------
 
 void MainWindow::onTimelineEventHovered(int index)
@@ -383,6 +576,11 @@ QString MainWindow::eventToText(const kpulse::Event &ev) const
     line += kpulse::severityToString(ev.severity);
     line += QStringLiteral(" | ");
     line += ev.label;
+    if (ev.count > 1) {
+        line += QStringLiteral(" (×%1, last %2)")
+                    .arg(ev.count)
+                    .arg(ev.lastSeen.toString(Qt::ISODateWithMs));
+    }
     return line;
 }
 
@@ -431,7 +629,7 @@ void MainWindow::exportCsv()
     }
 
     QTextStream out(&file);
-    out << "timestamp,category,severity,label\n";
+    out << "timestamp,category,severity,label,count,last_seen\n";
 
     const auto &events = model_->events();
     for (const kpulse::Event &ev : events) {
@@ -445,7 +643,9 @@ void MainWindow::exportCsv()
         out << "\"" << ts << "\","
             << "\"" << cat << "\","
             << "\"" << sev << "\","
-            << "\"" << safeLabel << "\"\n";
+            << "\"" << safeLabel << "\","
+            << "\"" << ev.count << "\","
+            << "\"" << ev.lastSeen.toString(Qt::ISODateWithMs) << "\"\n";
     }
 
     file.close();
@@ -8,6 +8,7 @@ class QComboBox;
 class QLabel;
 class QPushButton;
 class QTableView;
+class QTimer;
 
 #include "event_model.hpp"
 #include "kpulse/ipc_client.hpp"
@@ -32,8 +33,18 @@ private slots:
     void copyEventJson();
     void exportCsv();
 
+    // Pages of the current load, see requestPage()
+    void onEventsPageReady(quint64 requestId, const kpulse::EventPage &page);
+    void onRequestFailed(quint64 requestId, const QString &error);
+
+    // Zooming and panning: fetch counts for the visible range and load
+    // events once few enough are visible.
+    void refreshView();
+    void onHistogramReady(quint64 requestId, const kpulse::EventHistogram &histogram);
+
     // Live update from daemon
     void onEventReceived(const kpulse::Event &ev);
+    void onEventUpdated(const kpulse::Event &ev);
 
     // Hover from timeline
     void onTimelineEventHovered(int index);
@@ -46,6 +57,19 @@ private:
     void updateTimeRange(QDateTime &from, QDateTime &to) const;
     void loadEvents();
 
+    // Load the events of the visible range (and a margin around it) if
+    // the histogram says there are few enough.
+    void maybeLoadEvents();
+    void loadRange(qint64 fromMs, qint64 toMs);
+
+    // Ask for one page of the current load; onEventsPageReady() appends it
+    // and requests the next. Pages of a superseded load never arrive.
+    void requestPage(const QString &pageToken);
+
+    // Append the live events that arrived while pages were loading,
+    // skipping those a page already brought.
+    void mergePendingLive();
+
     QString eventToText(const kpulse::Event &ev) const;
     QString eventToJsonString(const kpulse::Event &ev) const;
 
@@ -64,4 +88,17 @@ private:
 
     // Last known selection row for context menu actions
     int contextRow_ = -1;
+
+    // Progressive loading state: the range being loaded and the id of the
+    // page request in flight (0 once the last page is in). With liveTail_
+    // the range extends to now and live events are appended to it; while
+    // pages are still loading they wait in pendingLive_.
+    QDateTime loadFrom_;
+    QDateTime loadTo_;
+    bool liveTail_ = false;
+    quint64 pageRequest_ = 0;
+    std::vector<kpulse::Event> pendingLive_;
+
+    quint64 histogramRequest_ = 0;
+    QTimer *viewTimer_ = nullptr;   // debounces viewRangeChanged
 };
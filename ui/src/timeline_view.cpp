@@ -6,32 +6,42 @@
 #include <QTimeZone>
 #include <QToolTip>
 #include <QCursor>
+#include <QWheelEvent>
 #include <algorithm>
+#include <cmath>
+#include <limits>
 
 using kpulse::Event;
+using kpulse::EventHistogram;
 using kpulse::Category;
 using kpulse::Severity;
 
+namespace {
+
+// Zoom limits and the zoom factor per wheel notch.
+constexpr qint64 kMinViewSpanMs = 10 * 1000;
+constexpr qint64 kMaxViewSpanMs = 400LL * 24 * 60 * 60 * 1000;
+constexpr double kZoomPerNotch = 0.8;
+
+// Histogram bucket widths preferredBucketMs() picks from; beyond the last
+// it uses whole days.
+constexpr qint64 kBucketSteps[] = {
+    1000, 2000, 5000, 10000, 15000, 30000,
+    60000, 2 * 60000, 5 * 60000, 10 * 60000, 15 * 60000, 30 * 60000,
+    3600000, 2 * 3600000, 3 * 3600000, 6 * 3600000, 12 * 3600000, 24 * 3600000,
+};
+
+} // namespace
+
 TimelineView::TimelineView(QWidget *parent)
     : QWidget(parent)
+    , coverFromMs_(std::numeric_limits<qint64>::min())
+    , coverToMs_(std::numeric_limits<qint64>::max())
 {
     setMinimumHeight(120);
     setMouseTracking(true);
 }
 
-void TimelineView::setEvents(const QVector<Event> &events)
-{
-    events_ = events;
-    hoveredIndex_ = -1;
-    update();
-}
-
-void TimelineView::appendEvent(const Event &ev)
-{
-    events_.push_back(ev);
-    update();
-}
-
 static int categoryIndex(Category c)
 {
     switch (c) {
@@ -44,6 +54,8 @@ static int categoryIndex(Category c)
     }
 }
 
+static constexpr int kLaneCount = 6;
+
 static QColor categoryColor(Category c)
 {
     switch (c) {
@@ -56,6 +68,19 @@ static QColor categoryColor(Category c)
     }
 }
 
+static QColor eventColor(Category c, Severity s)
+{
+    QColor color = categoryColor(c);
+
+    // Darker for more severe
+    if (s == Severity::Warning) {
+        color = color.darker(110);
+    } else if (s == Severity::Error || s == Severity::Critical) {
+        color = color.darker(140);
+    }
+    return color;
+}
+
 static QRect plotRectForTimeline(const QRect &outer, bool *hasLegend = nullptr)
 {
     const QRect full = outer.adjusted(8, 8, -8, -8);
@@ -77,83 +102,359 @@ static QRect plotRectForTimeline(const QRect &outer, bool *hasLegend = nullptr)
     return full;
 }
 
-void TimelineView::paintEvent(QPaintEvent *event)
+void TimelineView::setEvents(const QVector<Event> &events)
 {
-    Q_UNUSED(event);
+    events_ = events;
+    hoveredIndex_ = -1;
 
-    QPainter p(this);
-    p.setRenderHint(QPainter::Antialiasing, true);
+    points_.clear();
+    points_.reserve(static_cast<std::size_t>(events_.size()));
+    for (int i = 0; i < events_.size(); ++i) {
+        const Event &ev = events_.at(i);
+        points_.push_back({ev.timestamp.toMSecsSinceEpoch(), categoryIndex(ev.category), i});
+    }
+    std::sort(points_.begin(), points_.end(), [](const TimePoint &a, const TimePoint &b) {
+        return a.ms < b.ms || (a.ms == b.ms && a.index < b.index);
+    });
+    refreshBounds();
+    binsWidth_ = 0;
+    latestIndex_ = -1;
+
+    invalidateLayer();
+}
 
-    bool hasLegend = false;
-    const QRect plotRect = plotRectForTimeline(rect(), &hasLegend);
-    if (events_.isEmpty()) {
-        p.drawText(plotRect, Qt::AlignCenter, QStringLiteral("No events in range"));
+void TimelineView::appendEvent(const Event &ev)
+{
+    const QRect plotRect = plotRectForTimeline(rect());
+    const auto [firstBefore, lastBefore] = visiblePoints();
+    const bool hadVisible = firstBefore != lastBefore;
+    const bool wasDensity = lastBefore - firstBefore > qMax(0, plotRect.width());
+    const qint64 oldFromMs = viewFromMs();
+    const qint64 oldToMs = viewToMs();
+
+    events_.push_back(ev);
+    const int index = events_.size() - 1;
+    insertPoint(index);
+    refreshBounds();
+
+    const QRect oldMarker = markerRect(latestIndex_);
+    latestIndex_ = index;
+
+    // While showing the home range, follow live events past its end. The
+    // headroom lets the next ones fit without another full redraw.
+    const qint64 ms = ev.timestamp.toMSecsSinceEpoch();
+    if (homeToMs_ > homeFromMs_ && viewFromMs_ == homeFromMs_ && viewToMs_ == homeToMs_ &&
+        ms > homeToMs_) {
+        homeToMs_ = ms + (homeToMs_ - homeFromMs_) / 10;
+        setView(homeFromMs_, homeToMs_);
+    }
+
+    // With the view unchanged nothing else moves: draw just the new dot,
+    // or just the bin it lands in, into the cached layer. Otherwise every
+    // x shifts, so redraw it all.
+    const bool density = useDensity(plotRect);
+    if (!hadVisible || viewFromMs() != oldFromMs || viewToMs() != oldToMs ||
+        !eventsCoverView() || density != wasDensity) {
+        binsWidth_ = 0;
+        invalidateLayer();
         return;
     }
 
-    // Find time bounds
-    qint64 minMs = std::numeric_limits<qint64>::max();
-    qint64 maxMs = std::numeric_limits<qint64>::min();
+    if (density) {
+        addToBins(index, plotRect);
+    } else {
+        // Bins are not kept up to date while dots are drawn.
+        binsWidth_ = 0;
+        if (!layerValid_) {
+            invalidateLayer();
+            return;
+        }
+        if (ms >= oldFromMs && ms <= oldToMs) {
+            QPainter p(&layer_);
+            p.setRenderHint(QPainter::Antialiasing, true);
+            p.setPen(Qt::NoPen);
+            p.setBrush(eventColor(ev.category, ev.severity));
+            p.drawEllipse(markerCenter(index, plotRect), 4.0, 4.0);
+        }
+    }
+
+    update(oldMarker);
+    update(markerRect(index));
+}
+
+void TimelineView::appendEvents(const std::vector<Event> &events)
+{
+    if (events.empty())
+        return;
 
-    for (const Event &ev : events_) {
-        const qint64 ms = ev.timestamp.toMSecsSinceEpoch();
-        if (ms < minMs) minMs = ms;
-        if (ms > maxMs) maxMs = ms;
+    events_.reserve(events_.size() + static_cast<int>(events.size()));
+    points_.reserve(points_.size() + events.size());
+    for (const auto &ev : events) {
+        events_.push_back(ev);
+        insertPoint(events_.size() - 1);
     }
+    refreshBounds();
+    binsWidth_ = 0;
+    invalidateLayer();
+}
 
-    if (minMs == std::numeric_limits<qint64>::max() ||
-        maxMs == std::numeric_limits<qint64>::min()) {
-        p.drawText(plotRect, Qt::AlignCenter, QStringLiteral("No events in range"));
+void TimelineView::updateEvent(int index, const Event &ev)
+{
+    if (index < 0 || index >= events_.size())
+        return;
+
+    const qint64 oldMs = events_.at(index).timestamp.toMSecsSinceEpoch();
+    const int oldLane = categoryIndex(events_.at(index).category);
+    const Severity oldSeverity = events_.at(index).severity;
+    events_[index] = ev;
+
+    // Repeat counts do not show on the timeline; only the tooltip changes.
+    if (ev.timestamp.toMSecsSinceEpoch() == oldMs && categoryIndex(ev.category) == oldLane &&
+        ev.severity == oldSeverity) {
         return;
     }
 
-    if (maxMs == minMs) {
-        maxMs = minMs + 1000; // avoid div-by-zero
+    // Repeat updates keep the first timestamp, so the point usually stays.
+    if (ev.timestamp.toMSecsSinceEpoch() != oldMs || categoryIndex(ev.category) != oldLane) {
+        auto range = std::equal_range(points_.begin(), points_.end(), TimePoint{oldMs, 0, 0},
+                                      [](const TimePoint &a, const TimePoint &b) {
+                                          return a.ms < b.ms;
+                                      });
+        auto it = std::find_if(range.first, range.second, [index](const TimePoint &p) {
+            return p.index == index;
+        });
+        if (it != range.second) {
+            points_.erase(it);
+        }
+        insertPoint(index);
+        refreshBounds();
     }
+    binsWidth_ = 0;
+    invalidateLayer();
+}
 
-    const int lanes = 6;
-    const double laneHeight = plotRect.height() / double(lanes);
+void TimelineView::setRange(qint64 fromMs, qint64 toMs)
+{
+    homeFromMs_ = fromMs;
+    homeToMs_ = qMax(toMs, fromMs + 1);
+    setView(homeFromMs_, homeToMs_);
+}
 
-    // Draw lane lines
-    p.setPen(QPen(Qt::gray, 1, Qt::DashLine));
-    for (int i = 0; i < lanes; ++i) {
-        int y = int(plotRect.top() + laneHeight * (i + 0.5));
-        p.drawLine(plotRect.left(), y, plotRect.right(), y);
+qint64 TimelineView::viewFromMs() const
+{
+    return viewToMs_ > viewFromMs_ ? viewFromMs_ : minMs_;
+}
+
+qint64 TimelineView::viewToMs() const
+{
+    if (viewToMs_ > viewFromMs_)
+        return viewToMs_;
+    return maxMs_ > minMs_ ? maxMs_ : minMs_ + 1000; // avoid div-by-zero
+}
+
+void TimelineView::setEventsCoverage(qint64 fromMs, qint64 toMs)
+{
+    coverFromMs_ = fromMs;
+    coverToMs_ = toMs;
+    binsWidth_ = 0;
+    invalidateLayer();
+}
+
+bool TimelineView::eventsCoverView() const
+{
+    return coverFromMs_ <= viewFromMs() && coverToMs_ >= viewToMs();
+}
+
+void TimelineView::setHistogram(const EventHistogram &histogram)
+{
+    histogram_ = histogram;
+    if (!eventsCoverView()) {
+        binsWidth_ = 0;
+        invalidateLayer();
     }
+}
 
-    // Plot events as circles
-    for (int i = 0; i < events_.size(); ++i) {
-        const Event &ev = events_.at(i);
-        const qint64 ms = ev.timestamp.toMSecsSinceEpoch();
-        const double tNorm = double(ms - minMs) / double(maxMs - minMs);
-        const double x = plotRect.left() + tNorm * plotRect.width();
+void TimelineView::countEvent(const Event &ev)
+{
+    histogram_.add(ev.timestamp.toMSecsSinceEpoch(), ev.category, ev.severity,
+                   static_cast<quint32>(qMax(1, ev.count)));
+    if (!eventsCoverView()) {
+        binsWidth_ = 0;
+        invalidateLayer();
+    }
+}
 
-        const int idx = categoryIndex(ev.category);
-        const double y = plotRect.top() + laneHeight * (idx + 0.5);
+qint64 TimelineView::preferredBucketMs() const
+{
+    const int width = qMax(1, plotRectForTimeline(rect()).width());
+    const qint64 perPixel = (viewToMs() - viewFromMs() + width - 1) / width;
 
-        QColor color = categoryColor(ev.category);
+    for (qint64 step : kBucketSteps) {
+        if (step >= perPixel)
+            return step;
+    }
+    const qint64 day = std::end(kBucketSteps)[-1];
+    return (perPixel + day - 1) / day * day;
+}
 
-        // Darker for more severe
-        if (ev.severity == Severity::Warning) {
-            color = color.darker(110);
-        } else if (ev.severity == Severity::Error ||
-                   ev.severity == Severity::Critical) {
-            color = color.darker(140);
-        }
+void TimelineView::setView(qint64 fromMs, qint64 toMs)
+{
+    const qint64 span = qBound(kMinViewSpanMs, toMs - fromMs, kMaxViewSpanMs);
+    const qint64 center = fromMs + (toMs - fromMs) / 2;
+    if (toMs - fromMs != span) {
+        fromMs = center - span / 2;
+        toMs = fromMs + span;
+    }
+    if (fromMs == viewFromMs_ && toMs == viewToMs_)
+        return;
+
+    viewFromMs_ = fromMs;
+    viewToMs_ = toMs;
+    binsWidth_ = 0;
+    invalidateLayer();
+    emit viewRangeChanged(viewFromMs_, viewToMs_);
+}
+
+void TimelineView::zoomAt(int x, double factor)
+{
+    const QRect plotRect = plotRectForTimeline(rect());
+    if (plotRect.width() <= 0)
+        return;
+
+    const qint64 fromMs = viewFromMs();
+    const qint64 span = viewToMs() - fromMs;
+    const double anchor = qBound(0.0, double(x - plotRect.left()) / plotRect.width(), 1.0);
+    const qint64 anchorMs = fromMs + qint64(anchor * span);
+
+    const qint64 newSpan = qBound(kMinViewSpanMs, qint64(span * factor), kMaxViewSpanMs);
+    const qint64 newFrom = anchorMs - qint64(anchor * newSpan);
+    setView(newFrom, newFrom + newSpan);
+}
 
-        const bool hovered = (i == hoveredIndex_);
+void TimelineView::insertPoint(int index)
+{
+    const Event &ev = events_.at(index);
+    const TimePoint point{ev.timestamp.toMSecsSinceEpoch(), categoryIndex(ev.category), index};
+
+    // Live events arrive in time order, so this is almost always the end.
+    auto it = points_.end();
+    if (!points_.empty() && points_.back().ms > point.ms) {
+        it = std::upper_bound(points_.begin(), points_.end(), point,
+                              [](const TimePoint &a, const TimePoint &b) {
+                                  return a.ms < b.ms;
+                              });
+    }
+    points_.insert(it, point);
+}
+
+void TimelineView::refreshBounds()
+{
+    if (points_.empty()) {
+        minMs_ = maxMs_ = 0;
+        return;
+    }
+    minMs_ = points_.front().ms;
+    maxMs_ = points_.back().ms;
+}
+
+double TimelineView::xForTime(qint64 ms, const QRect &plotRect) const
+{
+    const qint64 fromMs = viewFromMs();
+    const qint64 span = viewToMs() - fromMs;
+    return plotRect.left() + double(ms - fromMs) / double(span) * plotRect.width();
+}
+
+std::pair<TimelineView::PointIterator, TimelineView::PointIterator>
+TimelineView::visiblePoints() const
+{
+    const qint64 fromMs = viewFromMs();
+    const qint64 toMs = viewToMs();
+    const auto first = std::lower_bound(points_.cbegin(), points_.cend(), fromMs,
+                                        [](const TimePoint &p, qint64 ms) { return p.ms < ms; });
+    const auto last = std::upper_bound(first, points_.cend(), toMs,
+                                       [](qint64 ms, const TimePoint &p) { return ms < p.ms; });
+    return {first, last};
+}
+
+void TimelineView::paintEvent(QPaintEvent *event)
+{
+    Q_UNUSED(event);
+
+    const qreal dpr = devicePixelRatioF();
+    if (!layerValid_ || layer_.size() != size() * dpr) {
+        renderLayer();
+    }
+
+    // Only the exposed region is actually blitted.
+    QPainter p(this);
+    p.drawImage(QPoint(0, 0), layer_);
+
+    // Overlay: markers that change without the data changing.
+    p.setRenderHint(QPainter::Antialiasing, true);
+    const QRect plotRect = plotRectForTimeline(rect());
+
+    if (!markerRect(latestIndex_).isEmpty()) {
+        p.setBrush(Qt::NoBrush);
+        p.setPen(QPen(palette().highlight().color(), 1.5));
+        p.drawEllipse(markerCenter(latestIndex_, plotRect), 7.0, 7.0);
+    }
+
+    if (!markerRect(hoveredIndex_).isEmpty()) {
+        const Event &ev = events_.at(hoveredIndex_);
+        const QPointF center = markerCenter(hoveredIndex_, plotRect);
 
         p.setPen(Qt::NoPen);
-        p.setBrush(color);
+        p.setBrush(eventColor(ev.category, ev.severity));
+        p.drawEllipse(center, 6.0, 6.0);
+
+        p.setBrush(Qt::NoBrush);
+        p.setPen(QPen(Qt::white, 1.0));
+        p.drawEllipse(center, 8.0, 8.0);
+    }
+}
+
+void TimelineView::renderLayer()
+{
+    const qreal dpr = devicePixelRatioF();
+    layer_ = QImage(size() * dpr, QImage::Format_ARGB32_Premultiplied);
+    layer_.setDevicePixelRatio(dpr);
+    layer_.fill(Qt::transparent);
+    layerValid_ = true;
 
-        double radius = hovered ? 6.0 : 4.0;
-        p.drawEllipse(QPointF(x, y), radius, radius);
+    QPainter p(&layer_);
+    p.setRenderHint(QPainter::Antialiasing, true);
 
-        if (hovered) {
-            p.setBrush(Qt::NoBrush);
-            p.setPen(QPen(Qt::white, 1.0));
-            p.drawEllipse(QPointF(x, y), radius + 2.0, radius + 2.0);
+    bool hasLegend = false;
+    const QRect plotRect = plotRectForTimeline(rect(), &hasLegend);
+
+    const bool showEvents = eventsCoverView();
+    if (showEvents) {
+        const auto [first, last] = visiblePoints();
+        if (first == last) {
+            p.drawText(plotRect, Qt::AlignCenter, QStringLiteral("No events in range"));
+            return;
         }
+    } else if (histogram_.isEmpty() || histogram_.toMs() <= viewFromMs() ||
+               histogram_.fromMs >= viewToMs()) {
+        p.drawText(plotRect, Qt::AlignCenter, QStringLiteral("Loading…"));
+        return;
+    } else if (histogram_.total(viewFromMs(), viewToMs()) == 0) {
+        p.drawText(plotRect, Qt::AlignCenter, QStringLiteral("No events in range"));
+        return;
+    }
+
+    const int lanes = kLaneCount;
+    const double laneHeight = plotRect.height() / double(lanes);
+
+    // Draw lane lines
+    for (int i = 0; i < lanes; ++i) {
+        paintLaneLine(p, i, plotRect, laneHeight);
+    }
+
+    if (!showEvents || useDensity(plotRect)) {
+        paintDensity(p, plotRect, laneHeight);
+    } else {
+        paintDots(p, plotRect, laneHeight);
     }
 
     if (hasLegend) {
@@ -203,44 +504,283 @@ void TimelineView::paintEvent(QPaintEvent *event)
     }
 }
 
-int TimelineView::hitTest(const QPoint &pos) const
+bool TimelineView::useDensity(const QRect &plotRect) const
 {
-    if (events_.isEmpty())
-        return -1;
+    const auto [first, last] = visiblePoints();
+    return last - first > qMax(0, plotRect.width());
+}
 
-    const QRect plotRect = plotRectForTimeline(rect());
+void TimelineView::rebuildBins(const QRect &plotRect)
+{
+    const int width = qMax(1, plotRect.width());
+    bins_.assign(static_cast<std::size_t>(width) * kLaneCount, Bin());
+    binsMaxCount_ = 0;
+    binsWidth_ = width;
+
+    if (!eventsCoverView()) {
+        binHistogram();
+        return;
+    }
+
+    const auto [first, last] = visiblePoints();
+    for (auto it = first; it != last; ++it) {
+        Bin &bin = bins_[static_cast<std::size_t>(it->lane) * width + binColumn(it->ms)];
+
+        const Event &ev = events_.at(it->index);
+        bin.category = ev.category;
+        if (bin.count == 0 || int(ev.severity) > int(bin.worst)) {
+            bin.worst = ev.severity;
+        }
+        binsMaxCount_ = qMax(binsMaxCount_, ++bin.count);
+    }
+}
+
+int TimelineView::binColumn(qint64 ms) const
+{
+    const qint64 fromMs = viewFromMs();
+    const qint64 span = viewToMs() - fromMs;
+    return qBound(0, int(double(ms - fromMs) / double(span) * binsWidth_), binsWidth_ - 1);
+}
+
+void TimelineView::addToBins(int index, const QRect &plotRect)
+{
+    // Stale bins are rebuilt, with this event, on the next paint.
+    if (binsWidth_ != qMax(1, plotRect.width())) {
+        invalidateLayer();
+        return;
+    }
 
-    // Find time bounds
-    qint64 minMs = std::numeric_limits<qint64>::max();
-    qint64 maxMs = std::numeric_limits<qint64>::min();
+    const Event &ev = events_.at(index);
+    const qint64 ms = ev.timestamp.toMSecsSinceEpoch();
+    if (ms < viewFromMs() || ms > viewToMs())
+        return;
+
+    const int lane = categoryIndex(ev.category);
+    const int column = binColumn(ms);
+    Bin &bin = bins_[static_cast<std::size_t>(lane) * binsWidth_ + column];
+    bin.category = ev.category;
+    if (bin.count == 0 || int(ev.severity) > int(bin.worst)) {
+        bin.worst = ev.severity;
+    }
+
+    // A new maximum changes the opacity scale of every bin.
+    if (++bin.count > binsMaxCount_) {
+        binsMaxCount_ = bin.count;
+        invalidateLayer();
+        return;
+    }
+    if (!layerValid_) {
+        update();
+        return;
+    }
+
+    // Redraw only this bin's cell of the lane: clear it, restore the lane
+    // line behind it and draw the bar again.
+    const double laneHeight = plotRect.height() / double(kLaneCount);
+    const QRectF bar = binRect(lane, column, plotRect, laneHeight);
+    const QRect cell = bar.toAlignedRect();
+
+    QPainter p(&layer_);
+    p.setClipRect(cell);
+    p.setCompositionMode(QPainter::CompositionMode_Source);
+    p.fillRect(cell, Qt::transparent);
+    p.setCompositionMode(QPainter::CompositionMode_SourceOver);
+    p.setRenderHint(QPainter::Antialiasing, true);
+    paintLaneLine(p, lane, plotRect, laneHeight);
+    p.setRenderHint(QPainter::Antialiasing, false);
+    p.fillRect(bar, binColor(bin));
+    p.end();
+
+    update(cell);
+}
+
+QRectF TimelineView::binRect(int lane, int column, const QRect &plotRect, double laneHeight) const
+{
+    const double barHeight = qMax(4.0, qMin(laneHeight * 0.6, 14.0));
+    const double y = plotRect.top() + laneHeight * (lane + 0.5) - barHeight / 2.0;
+    return QRectF(plotRect.left() + column, y, 1.0, barHeight);
+}
+
+QColor TimelineView::binColor(const Bin &bin) const
+{
+    // Opacity follows log(count), so a single event is still visible next
+    // to a burst of thousands.
+    const double scale = std::log1p(double(qMax(1, binsMaxCount_)));
+    QColor color = eventColor(bin.category, bin.worst);
+    color.setAlpha(80 + int(175.0 * std::log1p(double(bin.count)) / scale));
+    return color;
+}
+
+void TimelineView::paintLaneLine(QPainter &p, int lane, const QRect &plotRect, double laneHeight)
+{
+    p.setPen(QPen(Qt::gray, 1, Qt::DashLine));
+    const int y = int(plotRect.top() + laneHeight * (lane + 0.5));
+    p.drawLine(plotRect.left(), y, plotRect.right(), y);
+}
+
+void TimelineView::binHistogram()
+{
+    if (histogram_.isEmpty())
+        return;
 
-    for (const Event &ev : events_) {
-        const qint64 ms = ev.timestamp.toMSecsSinceEpoch();
-        if (ms < minMs) minMs = ms;
-        if (ms > maxMs) maxMs = ms;
+    const int width = binsWidth_;
+    const qint64 fromMs = viewFromMs();
+    const qint64 toMs = viewToMs();
+    const double pxPerMs = double(width) / double(toMs - fromMs);
+
+    const int firstBucket = int(qMax<qint64>(0, (fromMs - histogram_.fromMs) / histogram_.bucketMs));
+    const int lastBucket = int(qMin<qint64>(histogram_.bucketCount(),
+                                            (toMs - histogram_.fromMs) / histogram_.bucketMs + 1));
+
+    for (int b = firstBucket; b < lastBucket; ++b) {
+        const qint64 startMs = histogram_.fromMs + b * histogram_.bucketMs;
+
+        // A bucket wider than a pixel (zoomed in past the histogram's
+        // resolution) fills every column it spans.
+        const int c0 = qBound(0, int(std::floor((startMs - fromMs) * pxPerMs)), width - 1);
+        const int c1 = qBound(c0 + 1,
+                              int(std::floor((startMs + histogram_.bucketMs - fromMs) * pxPerMs)),
+                              width);
+
+        for (int c = 0; c < EventHistogram::kCategoryCount; ++c) {
+            const Category category = static_cast<Category>(c);
+            int count = 0;
+            Severity worst = Severity::Info;
+            for (int s = 0; s < EventHistogram::kSeverityCount; ++s) {
+                const quint32 n = histogram_.count(b, category, static_cast<Severity>(s));
+                if (n > 0) {
+                    count += int(qMin<quint32>(n, std::numeric_limits<int>::max() / 4));
+                    worst = static_cast<Severity>(s);
+                }
+            }
+            if (count == 0) {
+                continue;
+            }
+
+            Bin *row = bins_.data() + static_cast<std::size_t>(categoryIndex(category)) * width;
+            for (int column = c0; column < c1; ++column) {
+                Bin &bin = row[column];
+                bin.category = category;
+                if (bin.count == 0 || int(worst) > int(bin.worst)) {
+                    bin.worst = worst;
+                }
+                bin.count += count;
+                binsMaxCount_ = qMax(binsMaxCount_, bin.count);
+            }
+        }
     }
+}
 
-    if (maxMs == minMs) {
-        maxMs = minMs + 1000;
+void TimelineView::paintDensity(QPainter &p, const QRect &plotRect, double laneHeight)
+{
+    if (binsWidth_ != qMax(1, plotRect.width())) {
+        rebuildBins(plotRect);
     }
 
-    const int lanes = 6;
+    p.save();
+    p.setRenderHint(QPainter::Antialiasing, false);
+    p.setPen(Qt::NoPen);
+    for (int lane = 0; lane < kLaneCount; ++lane) {
+        const Bin *row = bins_.data() + static_cast<std::size_t>(lane) * binsWidth_;
+        for (int column = 0; column < binsWidth_; ++column) {
+            const Bin &bin = row[column];
+            if (bin.count == 0) {
+                continue;
+            }
+            p.fillRect(binRect(lane, column, plotRect, laneHeight), binColor(bin));
+        }
+    }
+    p.restore();
+}
+
+void TimelineView::paintDots(QPainter &p, const QRect &plotRect, double laneHeight)
+{
+    const auto [first, last] = visiblePoints();
+
+    p.setPen(Qt::NoPen);
+    for (auto it = first; it != last; ++it) {
+        const Event &ev = events_.at(it->index);
+        const double x = xForTime(it->ms, plotRect);
+        const double y = plotRect.top() + laneHeight * (it->lane + 0.5);
+
+        p.setBrush(eventColor(ev.category, ev.severity));
+        p.drawEllipse(QPointF(x, y), 4.0, 4.0);
+    }
+}
+
+QPointF TimelineView::markerCenter(int index, const QRect &plotRect) const
+{
+    const Event &ev = events_.at(index);
+    const double laneHeight = plotRect.height() / double(kLaneCount);
+    return QPointF(xForTime(ev.timestamp.toMSecsSinceEpoch(), plotRect),
+                   plotRect.top() + laneHeight * (categoryIndex(ev.category) + 0.5));
+}
+
+QRect TimelineView::markerRect(int index) const
+{
+    if (index < 0 || index >= events_.size() || !eventsCoverView())
+        return QRect();
+
+    const qint64 ms = events_.at(index).timestamp.toMSecsSinceEpoch();
+    if (ms < viewFromMs() || ms > viewToMs())
+        return QRect();
+
+    const QPointF center = markerCenter(index, plotRectForTimeline(rect()));
+    return QRectF(center - QPointF(10.0, 10.0), QSizeF(20.0, 20.0)).toAlignedRect();
+}
+
+void TimelineView::invalidateLayer()
+{
+    layerValid_ = false;
+    update();
+}
+
+void TimelineView::resizeEvent(QResizeEvent *event)
+{
+    layerValid_ = false;
+    QWidget::resizeEvent(event);
+}
+
+void TimelineView::changeEvent(QEvent *event)
+{
+    // The legend uses the palette and font.
+    if (event->type() == QEvent::PaletteChange || event->type() == QEvent::FontChange) {
+        invalidateLayer();
+    }
+    QWidget::changeEvent(event);
+}
+
+int TimelineView::hitTest(const QPoint &pos) const
+{
+    if (points_.empty() || !eventsCoverView())
+        return -1;
+
+    const QRect plotRect = plotRectForTimeline(rect());
+    if (plotRect.width() <= 0)
+        return -1;
+
+    const int lanes = kLaneCount;
     const double laneHeight = plotRect.height() / double(lanes);
 
     const double hitRadius = 7.0;
     const double hitRadiusSq = hitRadius * hitRadius;
 
+    // Only points within hitRadius pixels of the cursor horizontally can
+    // match; find that time window by binary search.
+    const qint64 viewFrom = viewFromMs();
+    const double msPerPixel = double(viewToMs() - viewFrom) / plotRect.width();
+    const qint64 fromMs = viewFrom + qint64(std::floor((pos.x() - hitRadius - plotRect.left()) * msPerPixel));
+    const qint64 toMs = viewFrom + qint64(std::ceil((pos.x() + hitRadius - plotRect.left()) * msPerPixel));
+
+    auto it = std::lower_bound(points_.begin(), points_.end(), fromMs,
+                               [](const TimePoint &p, qint64 ms) { return p.ms < ms; });
+
     int bestIndex = -1;
     double bestDistSq = std::numeric_limits<double>::max();
 
-    for (int i = 0; i < events_.size(); ++i) {
-        const Event &ev = events_.at(i);
-        const qint64 ms = ev.timestamp.toMSecsSinceEpoch();
-        const double tNorm = double(ms - minMs) / double(maxMs - minMs);
-        const double x = plotRect.left() + tNorm * plotRect.width();
-
-        const int idx = categoryIndex(ev.category);
-        const double y = plotRect.top() + laneHeight * (idx + 0.5);
+    for (; it != points_.end() && it->ms <= toMs; ++it) {
+        const double x = xForTime(it->ms, plotRect);
+        const double y = plotRect.top() + laneHeight * (it->lane + 0.5);
 
         const double dx = pos.x() - x;
         const double dy = pos.y() - y;
@@ -248,7 +788,7 @@ int TimelineView::hitTest(const QPoint &pos) const
 
         if (distSq <= hitRadiusSq && distSq < bestDistSq) {
             bestDistSq = distSq;
-            bestIndex = i;
+            bestIndex = it->index;
         }
     }
 
@@ -257,19 +797,34 @@ int TimelineView::hitTest(const QPoint &pos) const
 
 void TimelineView::mouseMoveEvent(QMouseEvent *event)
 {
+    if (dragging_) {
+        const QRect plotRect = plotRectForTimeline(rect());
+        if (plotRect.width() > 0) {
+            const double msPerPixel = double(dragToMs_ - dragFromMs_) / plotRect.width();
+            const qint64 shift = qint64((dragStartX_ - event->position().x()) * msPerPixel);
+            setView(dragFromMs_ + shift, dragToMs_ + shift);
+        }
+        QWidget::mouseMoveEvent(event);
+        return;
+    }
+
     const int idx = hitTest(event->pos());
     if (idx != hoveredIndex_) {
+        update(markerRect(hoveredIndex_));
         hoveredIndex_ = idx;
         emit eventHovered(hoveredIndex_);
-        update();
+        update(markerRect(hoveredIndex_));
 
         if (hoveredIndex_ >= 0 && hoveredIndex_ < events_.size()) {
             const Event &ev = events_.at(hoveredIndex_);
-            const QString text = QStringLiteral("%1 | %2 | %3 | %4")
-                                     .arg(ev.timestamp.toString(Qt::ISODateWithMs))
-                                     .arg(kpulse::categoryToString(ev.category))
-                                     .arg(kpulse::severityToString(ev.severity))
-                                     .arg(ev.label);
+            QString text = QStringLiteral("%1 | %2 | %3 | %4")
+                               .arg(ev.timestamp.toString(Qt::ISODateWithMs))
+                               .arg(kpulse::categoryToString(ev.category))
+                               .arg(kpulse::severityToString(ev.severity))
+                               .arg(ev.label);
+            if (ev.count > 1) {
+                text += QStringLiteral(" (×%1)").arg(ev.count);
+            }
             QToolTip::showText(QCursor::pos(), text, this);
         } else {
             QToolTip::hideText();
@@ -279,13 +834,56 @@ void TimelineView::mouseMoveEvent(QMouseEvent *event)
     QWidget::mouseMoveEvent(event);
 }
 
+void TimelineView::mousePressEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton) {
+        dragging_ = true;
+        dragStartX_ = qRound(event->position().x());
+        dragFromMs_ = viewFromMs();
+        dragToMs_ = viewToMs();
+        setCursor(Qt::ClosedHandCursor);
+        QToolTip::hideText();
+    }
+    QWidget::mousePressEvent(event);
+}
+
+void TimelineView::mouseReleaseEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton && dragging_) {
+        dragging_ = false;
+        unsetCursor();
+    }
+    QWidget::mouseReleaseEvent(event);
+}
+
+void TimelineView::mouseDoubleClickEvent(QMouseEvent *event)
+{
+    if (event->button() == Qt::LeftButton && homeToMs_ > homeFromMs_) {
+        setView(homeFromMs_, homeToMs_);
+    }
+    QWidget::mouseDoubleClickEvent(event);
+}
+
+void TimelineView::wheelEvent(QWheelEvent *event)
+{
+    const int delta = event->angleDelta().y();
+    if (delta == 0) {
+        QWidget::wheelEvent(event);
+        return;
+    }
+
+    // Wheel up zooms in; high-resolution wheels send fractions of a notch.
+    zoomAt(qRound(event->position().x()), std::pow(kZoomPerNotch, delta / 120.0));
+    event->accept();
+}
+
 void TimelineView::leaveEvent(QEvent *event)
 {
     Q_UNUSED(event);
     if (hoveredIndex_ != -1) {
+        update(markerRect(hoveredIndex_));
         hoveredIndex_ = -1;
         emit eventHovered(-1);
-        update();
         QToolTip::hideText();
     }
 }
@@ -1,10 +1,24 @@
 #pragma once
 
+#include <QImage>
 #include <QWidget>
 #include <QVector>
 
+#include <vector>
+
 #include "kpulse/event.hpp"
+#include "kpulse/histogram.hpp"
+
+class QPainter;
 
+// Events of a time range as dots in one lane per category. The wheel
+// zooms around the cursor, dragging pans and a double-click goes back to
+// the range given to setRange().
+//
+// Raw events are only drawn where they were loaded (setEventsCoverage());
+// elsewhere the view falls back to per-bucket counts from setHistogram(),
+// so the owner can keep wide ranges as counts and load events only for
+// narrow ones.
 class TimelineView : public QWidget
 {
     Q_OBJECT
@@ -17,18 +31,136 @@ public:
     // Append a single event.
     void appendEvent(const kpulse::Event &ev);
 
+    // Append a batch of events with a single repaint.
+    void appendEvents(const std::vector<kpulse::Event> &events);
+
+    // Replace the event at index (same order as the model).
+    void updateEvent(int index, const kpulse::Event &ev);
+
+    // Show [fromMs, toMs) and make it the range double-click returns to.
+    // Without a range the view spans the loaded events.
+    void setRange(qint64 fromMs, qint64 toMs);
+    qint64 viewFromMs() const;
+    qint64 viewToMs() const;
+
+    // Time span the events given to setEvents()/appendEvent(s) cover.
+    // Defaults to everything.
+    void setEventsCoverage(qint64 fromMs, qint64 toMs);
+    bool eventsCoverView() const;
+
+    // Counts drawn while the visible range is not covered by events.
+    void setHistogram(const kpulse::EventHistogram &histogram);
+    const kpulse::EventHistogram &histogram() const { return histogram_; }
+
+    // Add a live event to the histogram (it is not added to the events).
+    void countEvent(const kpulse::Event &ev);
+
+    // Histogram bucket width for the current zoom: about one pixel column,
+    // rounded up to a round step so nearby zoom levels share it.
+    qint64 preferredBucketMs() const;
+
+    // Index of the event whose dot is nearest to pos (within a few pixels),
+    // or -1. Used for hovering.
+    int hitTest(const QPoint &pos) const;
+
 signals:
     // Index in the current event list, or -1 when nothing is hovered.
     void eventHovered(int index);
 
+    // The visible range changed by zooming or panning.
+    void viewRangeChanged(qint64 fromMs, qint64 toMs);
+
 protected:
     void paintEvent(QPaintEvent *event) override;
     void mouseMoveEvent(QMouseEvent *event) override;
+    void mousePressEvent(QMouseEvent *event) override;
+    void mouseReleaseEvent(QMouseEvent *event) override;
+    void mouseDoubleClickEvent(QMouseEvent *event) override;
+    void wheelEvent(QWheelEvent *event) override;
     void leaveEvent(QEvent *event) override;
+    void resizeEvent(QResizeEvent *event) override;
+    void changeEvent(QEvent *event) override;
 
 private:
+    // One entry per event, kept sorted by time so hit tests and painting
+    // never have to convert or rescan the QDateTimes in events_.
+    struct TimePoint
+    {
+        qint64 ms;
+        int lane;
+        int index;   // into events_
+    };
+    using PointIterator = std::vector<TimePoint>::const_iterator;
+
+    // Density mode: per lane and pixel column, how many events fall there
+    // and the worst severity among them. Rebuilt only when the data, the
+    // view or the width changes, so a frame costs O(width) however many
+    // events there are.
+    struct Bin
+    {
+        int count = 0;
+        kpulse::Category category = kpulse::Category::System;
+        kpulse::Severity worst = kpulse::Severity::Info;
+    };
+
+    void insertPoint(int index);
+    void refreshBounds();
+    double xForTime(qint64 ms, const QRect &plotRect) const;
+    std::pair<PointIterator, PointIterator> visiblePoints() const;
+
+    // Change the visible range, clamped to a sane span.
+    void setView(qint64 fromMs, qint64 toMs);
+    void zoomAt(int x, double factor);
+
+    // Draw a heatmap instead of dots once events outnumber pixel columns.
+    bool useDensity(const QRect &plotRect) const;
+    void rebuildBins(const QRect &plotRect);
+    void binHistogram();
+    int binColumn(qint64 ms) const;
+
+    // Count a live event into bins_ and redraw just its cell of the layer.
+    void addToBins(int index, const QRect &plotRect);
+    QRectF binRect(int lane, int column, const QRect &plotRect, double laneHeight) const;
+    QColor binColor(const Bin &bin) const;
+    void paintLaneLine(QPainter &p, int lane, const QRect &plotRect, double laneHeight);
+    void paintDensity(QPainter &p, const QRect &plotRect, double laneHeight);
+    void paintDots(QPainter &p, const QRect &plotRect, double laneHeight);
+
+    // Lanes, dots or bins and the legend are rendered into layer_ and only
+    // redrawn after resize, zoom or data changes; paintEvent blits it and
+    // adds the hover and latest-event markers on top.
+    void renderLayer();
+    void invalidateLayer();
+    QPointF markerCenter(int index, const QRect &plotRect) const;
+    QRect markerRect(int index) const;   // widget area a marker covers
+
     QVector<kpulse::Event> events_;
+    std::vector<TimePoint> points_;
+    qint64 minMs_ = 0;
+    qint64 maxMs_ = 0;
     int hoveredIndex_ = -1;
+    int latestIndex_ = -1;    // last live-appended event
 
-    int hitTest(const QPoint &pos) const;
+    // Visible and home range; unset (0, 0) follows minMs_/maxMs_.
+    qint64 viewFromMs_ = 0;
+    qint64 viewToMs_ = 0;
+    qint64 homeFromMs_ = 0;
+    qint64 homeToMs_ = 0;
+
+    qint64 coverFromMs_;
+    qint64 coverToMs_;
+    kpulse::EventHistogram histogram_;
+
+    // Panning state while the left button is down.
+    bool dragging_ = false;
+    int dragStartX_ = 0;
+    qint64 dragFromMs_ = 0;
+    qint64 dragToMs_ = 0;
+
+    QImage layer_;
+    bool layerValid_ = false;
+
+    std::vector<Bin> bins_;   // lane-major, binsWidth_ columns per lane
+    int binsWidth_ = 0;       // 0 when bins_ is stale
+    int binsMaxCount_ = 0;
 };
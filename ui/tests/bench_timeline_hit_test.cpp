@@ -0,0 +1,99 @@
+#include <QTest>
+#include <QTimeZone>
+
+#include <utility>
+#include <vector>
+
+#include "timeline_view.hpp"
+
+using namespace kpulse;
+
+namespace {
+
+constexpr qint64 kStartMs = 1'700'000'000'000LL;
+constexpr qint64 kDayMs = 24LL * 60 * 60 * 1000;
+
+// Grid of cursor positions swept per benchmark iteration.
+constexpr int kColumns = 64;
+constexpr int kRows = 16;
+
+// n events spread evenly over one day, in all lanes.
+QVector<Event> spreadEvents(int n)
+{
+    const QString label = QStringLiteral("benchmark event");
+
+    QVector<Event> events;
+    events.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        Event ev;
+        ev.id = i + 1;
+        ev.timestamp = QDateTime::fromMSecsSinceEpoch(kStartMs + qint64(i) * kDayMs / n,
+                                                      QTimeZone::utc());
+        ev.category = static_cast<Category>(i % 6);
+        ev.severity = Severity::Warning;
+        ev.label = label;
+        events.push_back(std::move(ev));
+    }
+    return events;
+}
+
+} // namespace
+
+// TimelineView::hitTest() cost as the number of loaded events grows, at
+// the full-day zoom (many events per pixel) and zoomed in to a minute.
+class BenchTimelineHitTest : public QObject
+{
+    Q_OBJECT
+private slots:
+    void hitTest_data();
+    void hitTest();
+};
+
+void BenchTimelineHitTest::hitTest_data()
+{
+    QTest::addColumn<int>("events");
+    QTest::addColumn<qint64>("spanMs");
+
+    std::vector<int> sizes = {1000, 10000, 100000};
+    if (qEnvironmentVariableIsSet("KPULSE_BENCH_LARGE")) {
+        sizes.push_back(1000000);
+    }
+    for (int n : sizes) {
+        QTest::addRow("%d-day", n) << n << kDayMs;
+        QTest::addRow("%d-minute", n) << n << qint64(60 * 1000);
+    }
+}
+
+void BenchTimelineHitTest::hitTest()
+{
+    QFETCH(int, events);
+    QFETCH(qint64, spanMs);
+
+    TimelineView view;
+    view.resize(1200, 300);
+    view.setEvents(spreadEvents(events));
+    const qint64 fromMs = kStartMs + (kDayMs - spanMs) / 2;
+    view.setRange(fromMs, fromMs + spanMs);
+
+    std::vector<QPoint> positions;
+    positions.reserve(kColumns * kRows);
+    for (int c = 0; c < kColumns; ++c) {
+        for (int r = 0; r < kRows; ++r) {
+            positions.emplace_back(view.width() * (c + 1) / (kColumns + 1),
+                                   view.height() * (r + 1) / (kRows + 1));
+        }
+    }
+
+    int hits = 0;
+    QBENCHMARK {
+        hits = 0;
+        for (const QPoint &pos : positions) {
+            hits += view.hitTest(pos) >= 0;
+        }
+    }
+    qInfo("%s: %d of %zu positions hit", QTest::currentDataTag(), hits, positions.size());
+}
+
+QTEST_MAIN(BenchTimelineHitTest)
+
+#include "bench_timeline_hit_test.moc"